@@ -90,7 +90,7 @@ RenderingContext::RenderingContext(QObject* parent)
         auto geometry_service = std::make_unique<TileLoadService>("https://alpinemaps.cg.tuwien.ac.at/tiles/alpine_png/", TilePattern::ZXY, ".png");
         m->geometry = nucleus::tile::setup::geometry_scheduler(std::move(geometry_service), m->aabb_decorator, m->scheduler_thread.get());
         m->scheduler_director->check_in("geometry", m->geometry.scheduler);
-        m->data_querier = std::make_shared<DataQuerier>(&m->geometry.scheduler->ram_cache());
+        m->data_querier = std::make_shared<DataQuerier>(&m->geometry.scheduler->ram_cache(), m->geometry.scheduler->height_surfaces());
         auto ortho_service = std::make_unique<TileLoadService>("https://gataki.cg.tuwien.ac.at/raw/basemap/tiles/", TilePattern::ZYX_yPointingSouth, ".jpeg");
         // auto ortho_service = std::make_unique<TileLoadService>("https://mapsneu.wien.gv.at/basemap/bmaporthofoto30cm/normal/google3857/", TilePattern::ZYX_yPointingSouth, ".jpeg");
         m->ortho_texture = nucleus::tile::setup::texture_scheduler(std::move(ortho_service), m->aabb_decorator, m->scheduler_thread.get());
@@ -100,7 +100,12 @@ RenderingContext::RenderingContext(QObject* parent)
         m->scheduler_director->check_in("map_label", m->map_label.scheduler);
         // clang-format on
 
-        m->scheduler_director->visit([](nucleus::tile::Scheduler* sch) { nucleus::utils::thread::async_call(sch, [sch]() { sch->read_disk_cache(); }); });
+        m->scheduler_director->visit([](nucleus::tile::Scheduler* sch) {
+            nucleus::utils::thread::async_call(sch, [sch]() {
+                sch->read_disk_cache();
+                sch->resume_prefetch();
+            });
+        });
     }
     m->map_label.scheduler->set_geometry_ram_cache(&m->geometry.scheduler->ram_cache());
     m->geometry.scheduler->set_dataquerier(m->data_querier);
@@ -167,6 +172,11 @@ void RenderingContext::initialise()
     const auto texture_compression = gl_engine::Texture::compression_algorithm();
     nucleus::utils::thread::async_call(m->ortho_texture.scheduler.get(), [this, texture_compression]() {
         m->ortho_texture.scheduler->set_texture_compression_algorithm(texture_compression);
+#ifndef __EMSCRIPTEN__
+        auto texture_cache_settings = m->ortho_texture.scheduler->texture_cache().settings();
+        texture_cache_settings.disk_path = m->ortho_texture.scheduler->texture_cache_path();
+        m->ortho_texture.scheduler->texture_cache().set_settings(texture_cache_settings);
+#endif
         m->ortho_texture.scheduler->set_enabled(true);
     });
 
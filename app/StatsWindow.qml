@@ -644,6 +644,19 @@ Rectangle {
             Label {
                 text: "(" + map.tile_statistics.gpu.n_label_tiles_drawn + ")"
             }
+
+            Label {
+                text: qsTr("List reuse: ")
+            }
+            ProgressBar {
+                Layout.fillWidth: true
+                from: 0
+                to: 1
+                value: map.tile_statistics.gpu.draw_list_cache_hit_rate
+            }
+            Label {
+                text: "(" + Math.round(map.tile_statistics.gpu.draw_list_cache_hit_rate * 100) + "%)"
+            }
         }
     }
 
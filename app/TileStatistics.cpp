@@ -18,6 +18,8 @@
 
 #include "TileStatistics.h"
 
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QVariant>
 
 TileStatistics::TileStatistics(QObject* parent)
@@ -29,7 +31,7 @@ void TileStatistics::update_scheduler_stats(const QString& scheduler_name, const
 {
     auto current = scheduler_stats();
     for (const auto& [key, value] : new_stats.asKeyValueRange()) {
-        current[QString("%1_%2").arg(scheduler_name, key)] = value.toString();
+        current[QString("%1_%2").arg(scheduler_name, key)] = value;
     }
     set_scheduler_stats(current);
 }
@@ -53,3 +55,11 @@ void TileStatistics::set_scheduler_stats(const QVariantMap& new_scheduler_stats)
     m_scheduler_stats = new_scheduler_stats;
     emit scheduler_stats_changed(m_scheduler_stats);
 }
+
+QString TileStatistics::to_json() const
+{
+    QJsonObject o;
+    o["scheduler"] = QJsonObject::fromVariantMap(m_scheduler_stats);
+    o["gpu"] = QJsonObject::fromVariantMap(m_gpu_stats);
+    return QString::fromUtf8(QJsonDocument(o).toJson(QJsonDocument::Indented));
+}
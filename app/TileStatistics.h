@@ -33,6 +33,9 @@ public:
 
     [[nodiscard]] const QVariantMap& gpu_stats() const;
 
+    /// machine readable dump of all stats, e.g., for correlating stalls with server behaviour.
+    Q_INVOKABLE QString to_json() const;
+
 public slots:
     void set_gpu_stats(const QVariantMap& new_gpu_stats);
     void update_scheduler_stats(const QString& scheduler_name, const QVariantMap& stats);
@@ -28,7 +28,9 @@
 
 #include "RenderThreadNotifier.h"
 #include "RenderingContext.h"
+#include <algorithm>
 #include <gl_engine/Context.h>
+#include <nucleus/DataQuerier.h>
 
 TrackModel::TrackModel(QObject* parent)
     : QObject { parent }
@@ -99,6 +101,12 @@ void TrackModel::upload_track()
 
         std::unique_ptr<nucleus::track::Gpx> gpx = nucleus::track::parse(xmlReader);
         if (gpx != nullptr) {
+            const auto has_elevation = std::ranges::any_of(gpx->track, [](const auto& segment) {
+                return std::ranges::any_of(segment, [](const nucleus::track::Point& p) { return p.elevation != 0; });
+            });
+            const auto data_querier = RenderingContext::instance()->data_querier();
+            if (!has_elevation && data_querier)
+                nucleus::track::drape(gpx.get(), *data_querier);
             m_data.push_back(*gpx);
             emit tracks_changed(m_data);
         } else {
@@ -89,6 +89,16 @@ void TextureLayer::update_gpu_tiles(const std::vector<nucleus::tile::Id>& delete
         assert(tile.id.zoom_level < 100);
         assert(tile.texture);
 
+        if (tile.empty) {
+            // all empty quads share a layer, its content is uploaded only when it is (re)occupied
+            const auto layer = m_gpu_array_helper.add_empty_tile(tile.id);
+            if (layer.is_new) {
+                m_texture_array->upload(*tile.texture, layer.index);
+                m_layer_min_lod[layer.index] = 0;
+            }
+            continue;
+        }
+
         // find empty spot and upload texture
         const auto layer_index = m_gpu_array_helper.add_tile(tile.id);
         m_texture_array->upload(*tile.texture, layer_index);
@@ -198,6 +198,8 @@ void TileGeometry::update_gpu_tiles(const std::vector<radix::tile::Id>& deleted_
     if (!QOpenGLContext::currentContext()) // can happen during shutdown.
         return;
 
+    if (!deleted_tiles.empty() || !new_tiles.empty())
+        ++m_tile_set_version;
     for (const auto& id : deleted_tiles) {
         m_gpu_array_helper.remove_tile(id);
     }
@@ -206,6 +208,14 @@ void TileGeometry::update_gpu_tiles(const std::vector<radix::tile::Id>& deleted_
         assert(tile.id.zoom_level < 100);
         assert(tile.surface);
 
+        if (tile.empty) {
+            // all empty tiles share a layer, its content is uploaded only when it is (re)occupied
+            const auto layer = m_gpu_array_helper.add_empty_tile(tile.id);
+            if (layer.is_new)
+                m_dtm_textures->upload(*tile.surface, layer.index);
+            continue;
+        }
+
         // find empty spot and upload texture
         const auto layer_index = m_gpu_array_helper.add_tile(tile.id);
         m_dtm_textures->upload(*tile.surface, layer_index);
@@ -46,6 +46,8 @@ public:
     void draw(ShaderProgram* shader_program, const nucleus::camera::Definition& camera, const std::vector<nucleus::tile::TileBounds>& draw_list) const;
 
     unsigned int tile_count() const;
+    /// changes whenever tiles are added or removed
+    uint64_t tile_set_version() const;
 
 public slots:
     void update_gpu_tiles(const std::vector<nucleus::tile::Id>& deleted_tiles, const std::vector<nucleus::tile::GpuGeometryTile>& new_tiles);
@@ -66,5 +68,6 @@ private:
 
     nucleus::tile::GpuArrayHelper m_gpu_array_helper;
     nucleus::tile::utils::AabbDecoratorPtr m_aabb_decorator;
+    uint64_t m_tile_set_version = 0;
 };
 } // namespace gl_engine
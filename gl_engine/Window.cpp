@@ -44,7 +44,6 @@
 #include <QTimer>
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
-#include <nucleus/tile/drawing.h>
 #include <nucleus/timing/CpuTimer.h>
 #include <nucleus/timing/TimerManager.h>
 #include <nucleus/utils/bit_coding.h>
@@ -291,8 +290,7 @@ void Window::paint(QOpenGLFramebufferObject* framebuffer)
     m_atmosphere_shader->release();
     m_timer->stop_timer("atmosphere");
 
-    // Generate Draw-List
-    // Note: Could also just be done on camera change
+    // Generate Draw-List (reused if neither the camera nor the gpu tiles changed)
     m_timer->start_timer("draw_list");
     QVariantMap tile_stats;
     MapLabels::TileSet label_tile_set;
@@ -302,13 +300,14 @@ void Window::paint(QOpenGLFramebufferObject* framebuffer)
         tile_stats["n_label_tiles_drawn"] = unsigned(label_tile_set.size());
     }
 
-    const auto draw_list
-        = drawing::compute_bounds(drawing::limit(drawing::generate_list(m_camera, m_context->aabb_decorator(), 19), 1024u), m_context->aabb_decorator());
-    const auto culled_draw_list = drawing::sort(drawing::cull(draw_list, m_camera), m_camera.position());
+    const auto& cached_draw_list = m_draw_list_cache.get(m_camera, m_context->aabb_decorator(), m_context->tile_geometry()->tile_set_version());
+    const auto& draw_list = cached_draw_list.tiles;
+    const auto& culled_draw_list = cached_draw_list.visible;
 
     tile_stats["n_geometry_tiles_gpu"] = m_context->tile_geometry()->tile_count();
     tile_stats["n_ortho_tiles_gpu"] = m_context->ortho_layer()->tile_count();
     tile_stats["n_geometry_tiles_drawn"] = unsigned(culled_draw_list.size());
+    tile_stats["draw_list_cache_hit_rate"] = m_draw_list_cache.statistics().hit_rate();
     m_timer->stop_timer("draw_list");
 
     // DRAW SHADOWMAPS
@@ -36,6 +36,7 @@
 #include <nucleus/AbstractRenderWindow.h>
 #include <nucleus/camera/AbstractDepthTester.h>
 #include <nucleus/camera/Definition.h>
+#include <nucleus/tile/DrawListCache.h>
 #include <nucleus/timing/TimerManager.h>
 #include <nucleus/track/GPX.h>
 #include <string>
@@ -102,6 +103,7 @@ private:
     helpers::ScreenQuadGeometry m_screen_quad_geometry;
 
     nucleus::camera::Definition m_camera;
+    nucleus::tile::DrawListCache m_draw_list_cache { 19, 1024 };
 
     int m_frame = 0;
     bool m_initialised = false;
@@ -0,0 +1,176 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "CameraPathDriver.h"
+
+#include <QJsonArray>
+#include <nucleus/tile/Scheduler.h>
+#include <nucleus/tile/TileLoadService.h>
+
+namespace load_test {
+
+namespace {
+    int64_t msecs(const std::chrono::steady_clock::duration& d) { return std::chrono::duration_cast<std::chrono::milliseconds>(d).count(); }
+} // namespace
+
+CameraPathDriver::CameraPathDriver(std::vector<Waypoint> waypoints, std::vector<Layer> layers, const Settings& settings, QObject* parent)
+    : QObject { parent }
+    , m_waypoints(std::move(waypoints))
+    , m_layers(std::move(layers))
+    , m(settings)
+{
+    assert(!m_waypoints.empty());
+    assert(m.steps_between_waypoints > 0);
+    connect(&m_timer, &QTimer::timeout, this, &CameraPathDriver::tick);
+}
+
+void CameraPathDriver::start()
+{
+    m_start = Clock::now();
+    m_waypoint = 0;
+    m_step = 0;
+    m_results.clear();
+    // the first waypoint is a cold start, there is nothing to fly from.
+    send_camera(m_waypoints.front().camera);
+    m_arrival = Clock::now();
+    m_phase = Phase::Refining;
+    m_timer.start(int(m.step_interval_ms));
+}
+
+void CameraPathDriver::tick()
+{
+    const auto now = Clock::now();
+    switch (m_phase) {
+    case Phase::Moving: {
+        ++m_step;
+        const auto& from = m_waypoints[m_waypoint - 1].camera;
+        const auto& to = m_waypoints[m_waypoint].camera;
+        const auto t = double(m_step) / double(m.steps_between_waypoints);
+        const auto position = glm::mix(from.position(), to.position(), t);
+        const auto view_at = glm::mix(from.calculate_lookat_position(1000), to.calculate_lookat_position(1000), t);
+        auto camera = nucleus::camera::Definition(position, view_at);
+        camera.set_viewport_size(to.viewport_size());
+        send_camera(camera);
+        if (m_step == m.steps_between_waypoints) {
+            m_arrival = now;
+            m_phase = Phase::Refining;
+        }
+        break;
+    }
+    case Phase::Refining:
+        if (fully_refined()) {
+            finish_waypoint(false);
+        } else if (msecs(now - m_arrival) > int64_t(m.refinement_timeout_ms)) {
+            finish_waypoint(true);
+        } else if (msecs(now - m_last_camera_send) > int64_t(m.retry_interval_ms)) {
+            send_camera(m_current_camera);
+        }
+        break;
+    case Phase::Done:
+        break;
+    }
+}
+
+void CameraPathDriver::finish_waypoint(bool timed_out)
+{
+    const auto now = Clock::now();
+    WaypointResult result;
+    result.name = m_waypoints[m_waypoint].name;
+    result.time_to_full_refinement_ms = timed_out ? -1 : msecs(now - m_arrival);
+    result.n_requests = total_requests() - m_requests_at_waypoint_start;
+    result.n_bytes = total_bytes() - m_bytes_at_waypoint_start;
+    m_results.push_back(result);
+    m_requests_at_waypoint_start = total_requests();
+    m_bytes_at_waypoint_start = total_bytes();
+
+    ++m_waypoint;
+    m_step = 0;
+    if (m_waypoint < m_waypoints.size()) {
+        m_phase = Phase::Moving;
+        return;
+    }
+    m_phase = Phase::Done;
+    m_end = now;
+    m_timer.stop();
+    emit finished();
+}
+
+void CameraPathDriver::send_camera(const nucleus::camera::Definition& camera)
+{
+    m_current_camera = camera;
+    m_last_camera_send = Clock::now();
+    for (const auto& layer : m_layers)
+        layer.scheduler->update_camera(camera);
+}
+
+bool CameraPathDriver::fully_refined() const
+{
+    for (const auto& layer : m_layers) {
+        if (!layer.scheduler->missing_quads_for_current_camera().empty())
+            return false;
+    }
+    return true;
+}
+
+uint64_t CameraPathDriver::total_requests() const
+{
+    uint64_t n = 0;
+    for (const auto& layer : m_layers)
+        n += layer.tile_service->statistics().total().n_requests;
+    return n;
+}
+
+uint64_t CameraPathDriver::total_bytes() const
+{
+    uint64_t n = 0;
+    for (const auto& layer : m_layers)
+        n += layer.tile_service->statistics().total().n_bytes;
+    return n;
+}
+
+QJsonObject CameraPathDriver::report() const
+{
+    QJsonArray waypoints;
+    for (const auto& r : m_results) {
+        QJsonObject o;
+        o["name"] = r.name;
+        o["time_to_full_refinement_ms"] = qint64(r.time_to_full_refinement_ms);
+        o["n_requests"] = qint64(r.n_requests);
+        o["n_bytes"] = qint64(r.n_bytes);
+        waypoints.append(o);
+    }
+
+    QJsonObject layers;
+    for (const auto& layer : m_layers)
+        layers[layer.name] = layer.tile_service->statistics().to_json();
+
+    const auto end = (m_phase == Phase::Done) ? m_end : Clock::now();
+    const auto total_seconds = std::max(double(msecs(end - m_start)) / 1000.0, 0.001);
+
+    QJsonObject o;
+    o["waypoints"] = waypoints;
+    o["layers"] = layers;
+    o["total_time_ms"] = qint64(msecs(end - m_start));
+    o["n_requests"] = qint64(total_requests());
+    o["n_bytes"] = qint64(total_bytes());
+    o["throughput_requests_per_second"] = double(total_requests()) / total_seconds;
+    o["throughput_kilobytes_per_second"] = double(total_bytes()) / 1000.0 / total_seconds;
+    return o;
+}
+
+} // namespace load_test
@@ -0,0 +1,100 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <QJsonObject>
+#include <QObject>
+#include <QTimer>
+#include <chrono>
+#include <nucleus/camera/Definition.h>
+#include <vector>
+
+namespace nucleus::tile {
+class Scheduler;
+class TileLoadService;
+} // namespace nucleus::tile
+
+namespace load_test {
+
+/// Flies a camera along a list of waypoints. After arriving at each waypoint, it waits until all schedulers have every quad
+/// they need for that camera (full refinement) and records the time it took, as well as request counts and throughput.
+class CameraPathDriver : public QObject {
+    Q_OBJECT
+public:
+    struct Waypoint {
+        QString name;
+        nucleus::camera::Definition camera;
+    };
+    struct Layer {
+        QString name;
+        nucleus::tile::Scheduler* scheduler = nullptr;
+        nucleus::tile::TileLoadService* tile_service = nullptr;
+    };
+    struct Settings {
+        unsigned steps_between_waypoints = 20;
+        unsigned step_interval_ms = 50;
+        unsigned refinement_timeout_ms = 60'000;
+        unsigned retry_interval_ms = 1000; // camera is resent periodically, so quads that failed with network errors are requested again.
+    };
+
+    CameraPathDriver(std::vector<Waypoint> waypoints, std::vector<Layer> layers, const Settings& settings, QObject* parent = nullptr);
+
+    void start();
+    [[nodiscard]] QJsonObject report() const;
+
+signals:
+    void finished();
+
+private slots:
+    void tick();
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct WaypointResult {
+        QString name;
+        int64_t time_to_full_refinement_ms = -1; // -1: timed out
+        uint64_t n_requests = 0;
+        uint64_t n_bytes = 0;
+    };
+    enum class Phase { Moving, Refining, Done };
+
+    void send_camera(const nucleus::camera::Definition& camera);
+    [[nodiscard]] bool fully_refined() const;
+    [[nodiscard]] uint64_t total_requests() const;
+    [[nodiscard]] uint64_t total_bytes() const;
+    void finish_waypoint(bool timed_out);
+
+    std::vector<Waypoint> m_waypoints;
+    std::vector<Layer> m_layers;
+    Settings m;
+    QTimer m_timer;
+    Phase m_phase = Phase::Moving;
+    unsigned m_waypoint = 0;
+    unsigned m_step = 0;
+    nucleus::camera::Definition m_current_camera;
+    Clock::time_point m_start;
+    Clock::time_point m_arrival;
+    Clock::time_point m_last_camera_send;
+    Clock::time_point m_end;
+    uint64_t m_requests_at_waypoint_start = 0;
+    uint64_t m_bytes_at_waypoint_start = 0;
+    std::vector<WaypointResult> m_results;
+};
+
+} // namespace load_test
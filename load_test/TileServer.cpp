@@ -0,0 +1,284 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "TileServer.h"
+
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QImage>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace load_test {
+
+namespace {
+    QByteArray reason_phrase(int http_status)
+    {
+        switch (http_status) {
+        case 200:
+            return "OK";
+        case 404:
+            return "Not Found";
+        case 405:
+            return "Method Not Allowed";
+        case 503:
+            return "Service Unavailable";
+        default:
+            return "Unknown";
+        }
+    }
+
+    QByteArray content_type_for(const QString& path)
+    {
+        if (path.endsWith(".png"))
+            return "image/png";
+        if (path.endsWith(".jpeg") || path.endsWith(".jpg"))
+            return "image/jpeg";
+        return "application/octet-stream";
+    }
+
+    QByteArray encode(const QImage& image, const char* format)
+    {
+        QByteArray bytes;
+        QBuffer buffer(&bytes);
+        buffer.open(QIODevice::WriteOnly);
+        image.save(&buffer, format, 85);
+        return bytes;
+    }
+} // namespace
+
+TileServer::TileServer(const Settings& settings, QObject* parent)
+    : QObject { parent }
+    , m(settings)
+    , m_server(std::make_unique<QTcpServer>(this))
+    , m_random_engine(settings.random_seed)
+{
+    connect(m_server.get(), &QTcpServer::newConnection, this, &TileServer::accept_connections);
+}
+
+TileServer::~TileServer() = default;
+
+bool TileServer::listen(const QHostAddress& address, quint16 port) { return m_server->listen(address, port); }
+
+quint16 TileServer::port() const { return m_server->serverPort(); }
+
+QString TileServer::base_url() const { return QString("http://%1:%2/").arg(m_server->serverAddress().toString()).arg(port()); }
+
+const TileServer::Statistics& TileServer::statistics() const { return m_statistics; }
+
+const TileServer::Settings& TileServer::settings() const { return m; }
+
+void TileServer::accept_connections()
+{
+    while (m_server->hasPendingConnections()) {
+        QTcpSocket* socket = m_server->nextPendingConnection();
+        socket->setParent(this);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { read_requests(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            m_read_buffers.erase(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void TileServer::read_requests(QTcpSocket* socket)
+{
+    auto& buffer = m_read_buffers[socket];
+    buffer.append(socket->readAll());
+    while (true) {
+        const auto header_end = buffer.indexOf("\r\n\r\n");
+        if (header_end < 0)
+            return;
+        const auto header = QString::fromLatin1(buffer.left(header_end));
+        buffer.remove(0, header_end + 4);
+
+        const auto lines = header.split("\r\n");
+        const auto request_line = lines.front().split(' ');
+        Request request;
+        request.socket = socket;
+        if (request_line.size() >= 3) {
+            request.path = request_line[1];
+            request.keep_alive = request_line[2] != "HTTP/1.0";
+        }
+        for (const auto& line : lines) {
+            if (!line.startsWith("Connection:", Qt::CaseInsensitive))
+                continue;
+            const auto value = line.mid(int(std::strlen("Connection:"))).trimmed();
+            request.keep_alive = value.compare("close", Qt::CaseInsensitive) != 0;
+        }
+        ++m_statistics.n_requests;
+        if (request_line.size() < 3 || request_line[0] != "GET") {
+            ++m_n_active; // respond() releases the slot
+            respond(request, 405, {}, "text/plain");
+            continue;
+        }
+        enqueue(std::move(request));
+    }
+}
+
+void TileServer::enqueue(Request request)
+{
+    m_queue.push_back(std::move(request));
+    m_statistics.max_queue_length = std::max(m_statistics.max_queue_length, unsigned(m_queue.size()));
+    process_queue();
+}
+
+void TileServer::process_queue()
+{
+    while (!m_queue.empty() && (m.max_concurrent_requests == 0 || m_n_active < m.max_concurrent_requests)) {
+        auto request = std::move(m_queue.front());
+        m_queue.pop_front();
+        ++m_n_active;
+        m_statistics.max_concurrent_requests = std::max(m_statistics.max_concurrent_requests, m_n_active);
+        QTimer::singleShot(int(draw_latency()), this, [this, request]() { process(request); });
+    }
+}
+
+void TileServer::process(const Request& request)
+{
+    if (!request.socket) {
+        --m_n_active;
+        process_queue();
+        return;
+    }
+
+    int status = 200;
+    QByteArray body;
+    if (std::bernoulli_distribution(m.error_rate)(m_random_engine)) {
+        status = 503;
+    } else if (!m.root_directory.isEmpty()) {
+        const auto relative = QDir::cleanPath(request.path);
+        QFile file(QDir(m.root_directory).filePath(relative.mid(1)));
+        if (relative.contains("..") || !file.open(QIODevice::ReadOnly))
+            status = 404;
+        else
+            body = file.readAll();
+    } else {
+        body = generate_tile(request.path, m);
+        if (body.isEmpty())
+            status = 404;
+    }
+
+    auto delay = Clock::duration::zero();
+    if (m.bandwidth_bytes_per_second > 0) {
+        // all responses share one link. a response occupies it for size / bandwidth, responses queue up behind each other.
+        const auto now = Clock::now();
+        const auto transfer_time = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(double(body.size()) / double(m.bandwidth_bytes_per_second)));
+        m_link_free_at = std::max(now, m_link_free_at) + transfer_time;
+        delay = m_link_free_at - now;
+    }
+    const auto delay_msecs = int(std::chrono::duration_cast<std::chrono::milliseconds>(delay).count());
+    QTimer::singleShot(delay_msecs, this, [this, request, status, body]() { respond(request, status, body, content_type_for(request.path)); });
+}
+
+void TileServer::respond(const Request& request, int http_status, const QByteArray& body, const QByteArray& content_type)
+{
+    --m_n_active;
+    switch (http_status) {
+    case 200:
+        ++m_statistics.n_good;
+        break;
+    case 404:
+        ++m_statistics.n_not_found;
+        break;
+    default:
+        ++m_statistics.n_errors;
+        break;
+    }
+
+    if (request.socket && request.socket->state() == QAbstractSocket::ConnectedState) {
+        QByteArray response;
+        response.reserve(body.size() + 200);
+        response += "HTTP/1.1 " + QByteArray::number(http_status) + " " + reason_phrase(http_status) + "\r\n";
+        response += "Content-Type: " + content_type + "\r\n";
+        response += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+        response += "Access-Control-Allow-Origin: *\r\n";
+        response += QByteArray("Connection: ") + (request.keep_alive ? "keep-alive" : "close") + "\r\n\r\n";
+        response += body;
+        request.socket->write(response);
+        if (!request.keep_alive)
+            request.socket->disconnectFromHost();
+        m_statistics.n_bytes += uint64_t(body.size());
+    }
+    emit request_served(request.path, http_status, body.size());
+    process_queue();
+}
+
+unsigned TileServer::draw_latency()
+{
+    if (m.latency_jitter_ms == 0)
+        return m.latency_ms;
+    return m.latency_ms + std::uniform_int_distribution<unsigned>(0, m.latency_jitter_ms)(m_random_engine);
+}
+
+QByteArray TileServer::generate_tile(const QString& path, const Settings& settings)
+{
+    // expects .../<zoom>/<a>/<b>.<extension>. a and b are x and y in any order, the generated content only needs to be deterministic.
+    const auto parts = path.split('/', Qt::SkipEmptyParts);
+    if (parts.size() < 3)
+        return {};
+    const auto file_name = parts.back().split('.');
+    bool ok_zoom = false, ok_a = false, ok_b = false;
+    const auto zoom = parts[parts.size() - 3].toUInt(&ok_zoom);
+    const auto a = parts[parts.size() - 2].toUInt(&ok_a);
+    const auto b = file_name.front().toUInt(&ok_b);
+    if (!ok_zoom || !ok_a || !ok_b || file_name.size() != 2 || zoom > settings.max_zoom_level)
+        return {};
+    const auto& extension = file_name.back();
+
+    if (extension == "png") {
+        // alpine height encoding: red is 32m steps, green is 1/8m steps
+        const auto n = int(settings.height_tile_resolution);
+        QImage image(n, n, QImage::Format_RGBA8888);
+        const auto frequency = 0.3 / double(n) * std::pow(0.5, std::max(0, int(zoom) - 8));
+        for (int j = 0; j < n; ++j) {
+            auto* line = image.scanLine(j);
+            for (int i = 0; i < n; ++i) {
+                const auto x = (double(a) * (n - 1) + i) * frequency;
+                const auto y = (double(b) * (n - 1) + j) * frequency;
+                const auto height = 1500.0 + 1000.0 * std::sin(x) * std::cos(y);
+                line[i * 4 + 0] = uchar(std::clamp(int(height / 32.0), 0, 255));
+                line[i * 4 + 1] = uchar(std::clamp(int(std::fmod(height, 32.0) * 8), 0, 255));
+                line[i * 4 + 2] = 0;
+                line[i * 4 + 3] = 255;
+            }
+        }
+        return encode(image, "PNG");
+    }
+    if (extension == "jpeg" || extension == "jpg") {
+        const auto n = int(settings.ortho_tile_resolution);
+        QImage image(n, n, QImage::Format_RGB888);
+        for (int j = 0; j < n; ++j) {
+            auto* line = image.scanLine(j);
+            for (int i = 0; i < n; ++i) {
+                line[i * 3 + 0] = uchar((a * 37 + unsigned(i)) & 255);
+                line[i * 3 + 1] = uchar((b * 59 + unsigned(j)) & 255);
+                line[i * 3 + 2] = uchar((zoom * 16 + unsigned(i ^ j)) & 255);
+            }
+        }
+        return encode(image, "JPEG");
+    }
+    return {};
+}
+
+} // namespace load_test
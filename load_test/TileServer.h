@@ -0,0 +1,106 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <QHostAddress>
+#include <QObject>
+#include <QPointer>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <random>
+#include <unordered_map>
+
+class QTcpServer;
+class QTcpSocket;
+
+namespace load_test {
+
+/// Minimal HTTP/1.1 tile server for exercising the tile pipeline without public servers.
+/// Serves files from a directory, or generates tiles (png height tiles, jpeg ortho tiles) on the fly.
+/// Keep-alive is supported, pipelining is not (QNetworkAccessManager doesn't pipeline by default).
+class TileServer : public QObject {
+    Q_OBJECT
+public:
+    struct Settings {
+        QString root_directory; // empty: generate tiles
+        unsigned latency_ms = 0;
+        unsigned latency_jitter_ms = 0;
+        uint64_t bandwidth_bytes_per_second = 0; // 0: unlimited. otherwise all responses share one link of that bandwidth.
+        double error_rate = 0; // fraction of requests, that are answered with 503
+        unsigned max_concurrent_requests = 0; // 0: unlimited. otherwise further requests are queued.
+        unsigned max_zoom_level = 18; // generated tiles only. deeper tiles are answered with 404.
+        unsigned height_tile_resolution = 65;
+        unsigned ortho_tile_resolution = 256;
+        uint32_t random_seed = 42;
+    };
+    struct Statistics {
+        uint64_t n_requests = 0;
+        uint64_t n_good = 0;
+        uint64_t n_not_found = 0;
+        uint64_t n_errors = 0;
+        uint64_t n_bytes = 0;
+        unsigned max_concurrent_requests = 0;
+        unsigned max_queue_length = 0;
+    };
+
+    explicit TileServer(const Settings& settings, QObject* parent = nullptr);
+    ~TileServer() override;
+
+    bool listen(const QHostAddress& address = QHostAddress::LocalHost, quint16 port = 0);
+    [[nodiscard]] quint16 port() const;
+    /// e.g., "http://127.0.0.1:4321/". append the layer name and use it as base url in TileLoadService.
+    [[nodiscard]] QString base_url() const;
+    [[nodiscard]] const Statistics& statistics() const;
+    [[nodiscard]] const Settings& settings() const;
+
+    [[nodiscard]] static QByteArray generate_tile(const QString& path, const Settings& settings);
+
+signals:
+    void request_served(const QString& path, int http_status, qint64 n_bytes);
+
+private slots:
+    void accept_connections();
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Request {
+        QPointer<QTcpSocket> socket;
+        QString path;
+        bool keep_alive = true;
+    };
+
+    void read_requests(QTcpSocket* socket);
+    void enqueue(Request request);
+    void process_queue();
+    void process(const Request& request);
+    void respond(const Request& request, int http_status, const QByteArray& body, const QByteArray& content_type);
+    [[nodiscard]] unsigned draw_latency();
+
+    Settings m;
+    Statistics m_statistics;
+    std::unique_ptr<QTcpServer> m_server;
+    std::unordered_map<QTcpSocket*, QByteArray> m_read_buffers;
+    std::deque<Request> m_queue;
+    unsigned m_n_active = 0;
+    Clock::time_point m_link_free_at = {};
+    std::mt19937 m_random_engine;
+};
+
+} // namespace load_test
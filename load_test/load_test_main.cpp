@@ -0,0 +1,166 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QThread>
+#include <limits>
+#include <nucleus/camera/PositionStorage.h>
+#include <nucleus/tile/setup.h>
+#include <nucleus/utils/thread.h>
+
+#include "CameraPathDriver.h"
+#include "TileServer.h"
+
+using namespace nucleus::tile;
+using TilePattern = TileLoadService::UrlPattern;
+
+namespace {
+QJsonObject to_json(const load_test::TileServer::Statistics& s)
+{
+    QJsonObject o;
+    o["n_requests"] = qint64(s.n_requests);
+    o["n_good"] = qint64(s.n_good);
+    o["n_not_found"] = qint64(s.n_not_found);
+    o["n_errors"] = qint64(s.n_errors);
+    o["n_bytes"] = qint64(s.n_bytes);
+    o["max_concurrent_requests"] = qint64(s.max_concurrent_requests);
+    o["max_queue_length"] = qint64(s.max_queue_length);
+    return o;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("alp_load_test");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Flies a camera along stored positions and measures how long the tile pipeline takes to fully refine at each of them.\n"
+                                     "Unless --url is given, a local tile server is started in-process.");
+    parser.addHelpOption();
+    // clang-format off
+    parser.addOptions({
+        { "url",           "Base url of an external tile server (must serve geometry/ and ortho/).",  "url"                           },
+        { "latency",       "Local server: latency per request in milliseconds.",                      "msecs",     "0"                },
+        { "jitter",        "Local server: random additional latency in milliseconds.",                "msecs",     "0"                },
+        { "bandwidth",     "Local server: shared bandwidth in kilobytes per second (0: unlimited).",  "kB/s",      "0"                },
+        { "error-rate",    "Local server: fraction of requests answered with 503 (0..1).",            "rate",      "0"                },
+        { "concurrency",   "Local server: maximum concurrently processed requests (0: unlimited).",   "n",         "0"                },
+        { "path",          "Comma separated list of stored camera positions.",                        "names",     "wien,schneeberg,grossglockner,karwendel" },
+        { "steps",         "Number of camera updates between two waypoints.",                         "n",         "20"               },
+        { "step-interval", "Time between camera updates in milliseconds.",                            "msecs",     "50"               },
+        { "timeout",       "Give up waiting for full refinement at a waypoint after this many msecs.", "msecs",    "60000"            },
+        { "output",        "Write the json report to this file instead of stdout.",                   "file"                          },
+    });
+    // clang-format on
+    parser.process(app);
+
+    std::unique_ptr<load_test::TileServer> server;
+    QThread server_thread;
+    QString base_url = parser.value("url");
+    if (base_url.isEmpty()) {
+        load_test::TileServer::Settings settings;
+        settings.latency_ms = parser.value("latency").toUInt();
+        settings.latency_jitter_ms = parser.value("jitter").toUInt();
+        settings.bandwidth_bytes_per_second = parser.value("bandwidth").toULongLong() * 1000;
+        settings.error_rate = parser.value("error-rate").toDouble();
+        settings.max_concurrent_requests = parser.value("concurrency").toUInt();
+        server = std::make_unique<load_test::TileServer>(settings);
+        // the server gets its own thread, so that decoding and scheduling on the main thread doesn't distort latency and bandwidth.
+        server->moveToThread(&server_thread);
+        server_thread.start();
+        const auto listening = nucleus::utils::thread::sync_call(server.get(), [&]() { return server->listen(); });
+        if (!listening) {
+            qCritical() << "Could not start the local tile server.";
+            server_thread.quit();
+            server_thread.wait();
+            return 1;
+        }
+        base_url = server->base_url();
+    }
+    if (!base_url.endsWith('/'))
+        base_url += '/';
+
+    std::vector<load_test::CameraPathDriver::Waypoint> waypoints;
+    for (const auto& name : parser.value("path").split(',', Qt::SkipEmptyParts)) {
+        const auto& positions = nucleus::camera::PositionStorage::instance()->positions();
+        const auto it = positions.find(name.trimmed().toStdString());
+        if (it == positions.end()) {
+            qCritical() << "Unknown camera position" << name << ". Available:" << nucleus::camera::PositionStorage::instance()->getPositionList();
+            return 1;
+        }
+        auto camera = it->second;
+        camera.set_viewport_size({ 1920, 1080 });
+        waypoints.push_back({ name.trimmed(), camera });
+    }
+    if (waypoints.empty()) {
+        qCritical() << "The camera path is empty.";
+        return 1;
+    }
+
+    const auto aabb_decorator = setup::aabb_decorator();
+    auto geometry = setup::geometry_scheduler(std::make_unique<TileLoadService>(base_url + "geometry/", TilePattern::ZXY, ".png"), aabb_decorator);
+    auto ortho = setup::texture_scheduler(std::make_unique<TileLoadService>(base_url + "ortho/", TilePattern::ZYX_yPointingSouth, ".jpeg"), aabb_decorator);
+    for (Scheduler* scheduler : std::initializer_list<Scheduler*> { geometry.scheduler.get(), ortho.scheduler.get() }) {
+        // every run should start cold and must not pollute the disk cache of the app.
+        scheduler->set_persist_timeout(std::numeric_limits<unsigned>::max());
+        scheduler->set_enabled(true);
+    }
+    geometry.scheduler->set_name("geometry");
+    ortho.scheduler->set_name("ortho");
+
+    load_test::CameraPathDriver::Settings driver_settings;
+    driver_settings.steps_between_waypoints = std::max(1u, parser.value("steps").toUInt());
+    driver_settings.step_interval_ms = parser.value("step-interval").toUInt();
+    driver_settings.refinement_timeout_ms = parser.value("timeout").toUInt();
+    load_test::CameraPathDriver driver(std::move(waypoints),
+        { { "geometry", geometry.scheduler.get(), geometry.tile_service.get() }, { "ortho", ortho.scheduler.get(), ortho.tile_service.get() } },
+        driver_settings);
+
+    QObject::connect(&driver, &load_test::CameraPathDriver::finished, &app, &QCoreApplication::quit);
+    driver.start();
+    QCoreApplication::exec();
+
+    auto report = driver.report();
+    report["base_url"] = base_url;
+    if (server) {
+        report["server"] = to_json(nucleus::utils::thread::sync_call(server.get(), [&]() { return server->statistics(); }));
+        server_thread.quit();
+        server_thread.wait();
+        server.reset();
+    }
+
+    const auto json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet("output")) {
+        QFile file(parser.value("output"));
+        if (!file.open(QIODevice::WriteOnly)) {
+            qCritical() << "Could not open" << parser.value("output") << "for writing.";
+            return 1;
+        }
+        file.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+
+#include "TileServer.h"
+
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("alp_tile_server");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Local stand-in tile server for testing the AlpineMaps tile pipeline.\n"
+                                     "Without --root, png (height) and jpeg (ortho) tiles are generated, e.g., http://127.0.0.1:8765/geometry/12/2200/1300.png");
+    parser.addHelpOption();
+    // clang-format off
+    parser.addOptions({
+        { "port",        "TCP port to listen on (default 8765).",                                  "port",      "8765" },
+        { "root",        "Serve files from this directory instead of generating tiles.",           "directory"         },
+        { "latency",     "Latency per request in milliseconds.",                                   "msecs",     "0"    },
+        { "jitter",      "Random additional latency per request in milliseconds.",                 "msecs",     "0"    },
+        { "bandwidth",   "Bandwidth in kilobytes per second, shared by all requests (0: unlimited).", "kB/s",   "0"    },
+        { "error-rate",  "Fraction of requests answered with 503 (0..1).",                         "rate",      "0"    },
+        { "concurrency", "Maximum number of concurrently processed requests (0: unlimited).",      "n",         "0"    },
+        { "max-zoom",    "Generated tiles deeper than this zoom level are answered with 404.",     "zoom",      "18"   },
+    });
+    // clang-format on
+    parser.process(app);
+
+    load_test::TileServer::Settings settings;
+    settings.root_directory = parser.value("root");
+    settings.latency_ms = parser.value("latency").toUInt();
+    settings.latency_jitter_ms = parser.value("jitter").toUInt();
+    settings.bandwidth_bytes_per_second = parser.value("bandwidth").toULongLong() * 1000;
+    settings.error_rate = parser.value("error-rate").toDouble();
+    settings.max_concurrent_requests = parser.value("concurrency").toUInt();
+    settings.max_zoom_level = parser.value("max-zoom").toUInt();
+
+    load_test::TileServer server(settings);
+    if (!server.listen(QHostAddress::LocalHost, quint16(parser.value("port").toUInt()))) {
+        qCritical() << "Could not listen on port" << parser.value("port");
+        return 1;
+    }
+    qInfo() << "Serving tiles on" << server.base_url();
+    return QCoreApplication::exec();
+}
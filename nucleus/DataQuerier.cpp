@@ -18,13 +18,162 @@
 
 #include "DataQuerier.h"
 
+#include <algorithm>
+
 #include <nucleus/tile/cache_quieries.h>
+#include <nucleus/utils/bit_coding.h>
+
+namespace {
+// queries are quantised to a grid of 2^cGridLevel cells per axis (~15cm at the equator) and sorted along the
+// z-order curve of that grid. every tile up to zoom level cGridLevel covers one contiguous range of that order.
+constexpr unsigned cGridLevel = 28;
+
+using nucleus::utils::bit_coding::z_order;
+
+struct Query {
+    uint64_t key;
+    uint32_t index;
+};
+
+// range of queries inside the given tile
+std::pair<size_t, size_t> query_range(const std::vector<Query>& sorted_queries, const nucleus::tile::Id& id)
+{
+    if (id.zoom_level > cGridLevel)
+        return { 0, 0 };
+    const auto shift = cGridLevel - id.zoom_level;
+    const auto first_key = z_order(glm::uvec2(id.coords.x << shift, id.coords.y << shift));
+    const auto end_key = first_key + (uint64_t(1) << (2 * shift));
+    const auto less = [](const Query& q, uint64_t key) { return q.key < key; };
+    const auto first = std::lower_bound(sorted_queries.begin(), sorted_queries.end(), first_key, less);
+    const auto end = std::lower_bound(first, sorted_queries.end(), end_key, less);
+    return { size_t(first - sorted_queries.begin()), size_t(end - sorted_queries.begin()) };
+}
+} // namespace
 
-nucleus::DataQuerier::DataQuerier(tile::MemoryCache* cache)
+nucleus::DataQuerier::DataQuerier(tile::MemoryCache* cache, std::shared_ptr<tile::HeightSurfaceRegistry> height_surfaces, unsigned max_decoded_tiles)
     : m_memory_cache(cache)
+    , m_height_surfaces(height_surfaces ? std::move(height_surfaces) : std::make_shared<tile::HeightSurfaceRegistry>())
+    , m_max_decoded_tiles(max_decoded_tiles)
 {}
 
 tl::expected<float, QString> nucleus::DataQuerier::get_altitude(const glm::dvec2& lat_long) const
 {
-    return tile::cache_queries::query_altitude(m_memory_cache, lat_long);
+    const auto world_space = srs::lat_long_to_world(lat_long);
+    const auto altitude = get_altitudes_world(std::span(&world_space, 1)).front();
+    if (!altitude)
+        return tl::unexpected(QString("Couldn't find altitude for %1/%2").arg(lat_long.x).arg(lat_long.y));
+    return altitude.value();
+}
+
+std::vector<std::optional<float>> nucleus::DataQuerier::get_altitudes(std::span<const glm::dvec2> lat_longs) const
+{
+    std::vector<glm::dvec2> world_space_positions;
+    world_space_positions.reserve(lat_longs.size());
+    std::transform(lat_longs.begin(), lat_longs.end(), std::back_inserter(world_space_positions), srs::lat_long_to_world);
+    return get_altitudes_world(world_space_positions);
+}
+
+std::vector<std::optional<float>> nucleus::DataQuerier::get_altitudes_world(std::span<const glm::dvec2> world_space_positions) const
+{
+    std::vector<std::optional<float>> altitudes(world_space_positions.size());
+
+    static const auto world_bounds = srs::tile_bounds(tile::Id { 0, { 0, 0 } });
+    constexpr auto n_cells = double(1u << cGridLevel);
+    std::vector<Query> queries;
+    queries.reserve(world_space_positions.size());
+    for (uint32_t i = 0; i < world_space_positions.size(); ++i) {
+        const auto cell = (world_space_positions[i] - world_bounds.min) / world_bounds.size() * n_cells;
+        if (!(cell.x >= 0 && cell.y >= 0 && cell.x <= n_cells && cell.y <= n_cells)) // also catches nan
+            continue;
+        queries.push_back({ z_order(glm::min(glm::uvec2(cell), glm::uvec2((1u << cGridLevel) - 1))), i });
+    }
+    if (queries.empty())
+        return altitudes;
+    std::sort(queries.begin(), queries.end(), [](const Query& a, const Query& b) { return a.key < b.key; });
+
+    // one walk through the cache. children are visited after their parents, so finer tiles overwrite coarser ones.
+    constexpr auto no_tile = uint32_t(-1);
+    std::vector<tile::Data> tiles;
+    std::vector<uint32_t> tile_of_query(queries.size(), no_tile);
+    m_memory_cache->visit([&](const tile::DataQuad& quad) {
+        if (const auto [first, end] = query_range(queries, quad.id); first == end)
+            return false;
+        for (unsigned i = 0; i < quad.n_tiles; ++i) {
+            const auto& tile = quad.tiles[i];
+            if (tile.network_info.status != tile::NetworkInfo::Status::Good || !tile.data || tile.data->isEmpty())
+                continue;
+            const auto [first, end] = query_range(queries, tile.id);
+            if (first == end)
+                continue;
+            std::fill(tile_of_query.begin() + first, tile_of_query.begin() + end, uint32_t(tiles.size()));
+            tiles.push_back(tile);
+        }
+        return true;
+    });
+
+    std::vector<DecodedRaster> rasters(tiles.size());
+    std::vector<bool> decode_attempted(tiles.size(), false);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto tile_index = tile_of_query[i];
+        if (tile_index == no_tile)
+            continue;
+        if (!decode_attempted[tile_index]) {
+            rasters[tile_index] = decoded(tiles[tile_index]);
+            decode_attempted[tile_index] = true;
+        }
+        if (!rasters[tile_index])
+            continue;
+        const auto index = queries[i].index;
+        altitudes[index] = tile::cache_queries::sample_altitude(*rasters[tile_index], tiles[tile_index].id, world_space_positions[index]);
+    }
+    return altitudes;
+}
+
+nucleus::DataQuerier::DecodedRaster nucleus::DataQuerier::decoded(const tile::Data& tile) const
+{
+    {
+        std::scoped_lock lock(m_mutex);
+        auto it = m_decoded.find(tile.id);
+        if (it != m_decoded.end() && it->second.source == tile.data) {
+            m_statistics.n_hits++;
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru_position);
+            return it->second.raster;
+        }
+        m_statistics.n_misses++;
+    }
+
+    // without holding the lock, other threads may query different tiles meanwhile
+    const auto raster = m_height_surfaces->get_or_decode(tile.id, tile.data);
+    if (!raster)
+        return {};
+
+    std::scoped_lock lock(m_mutex);
+    auto it = m_decoded.find(tile.id);
+    if (it != m_decoded.end()) { // stale (the quad was replaced in the memory cache), or decoded by another thread
+        it->second.source = tile.data;
+        it->second.raster = raster;
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru_position);
+        return raster;
+    }
+    if (m_max_decoded_tiles == 0)
+        return raster;
+    if (m_decoded.size() >= m_max_decoded_tiles) {
+        m_decoded.erase(m_lru.back());
+        m_lru.pop_back();
+    }
+    m_lru.push_front(tile.id);
+    m_decoded.emplace(tile.id, DecodedTile { tile.data, raster, m_lru.begin() });
+    return raster;
+}
+
+nucleus::DataQuerier::Statistics nucleus::DataQuerier::statistics() const
+{
+    std::scoped_lock lock(m_mutex);
+    return m_statistics;
+}
+
+unsigned nucleus::DataQuerier::n_decoded_tiles() const
+{
+    std::scoped_lock lock(m_mutex);
+    return unsigned(m_decoded.size());
 }
@@ -19,19 +19,59 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
 
+#include <nucleus/Raster.h>
 #include <nucleus/tile/Cache.h>
+#include <nucleus/tile/HeightSurfaceRegistry.h>
 
 namespace nucleus {
 
+/// Thread safe. Keeps the most recently queried height tiles decoded, so that repeated queries within a tile (e.g. the
+/// pois of a vector tile) cost a lookup instead of a png decode. An entry is stale as soon as the memory cache holds
+/// different data for its tile (the quad was replaced), it is decoded again then.
+/// Altitudes are sampled bilinearly from the finest cached tile.
+/// Surfaces are shared through height_surfaces, pass GeometryScheduler::height_surfaces() to reuse what the renderer decoded.
 class DataQuerier
 {
-    tile::MemoryCache* m_memory_cache = nullptr;
-
 public:
-    DataQuerier(tile::MemoryCache* cache);
+    struct Statistics {
+        uint64_t n_hits = 0;
+        uint64_t n_misses = 0;
+    };
+
+    explicit DataQuerier(tile::MemoryCache* cache, std::shared_ptr<tile::HeightSurfaceRegistry> height_surfaces = {}, unsigned max_decoded_tiles = 128);
 
     [[nodiscard]] tl::expected<float, QString> get_altitude(const glm::dvec2& lat_long) const;
+    /// results are in input order, std::nullopt where no terrain is cached. prefer this over repeated get_altitude calls:
+    /// the cache is walked once, and every needed tile is decoded (or looked up) once.
+    [[nodiscard]] std::vector<std::optional<float>> get_altitudes(std::span<const glm::dvec2> lat_longs) const;
+    [[nodiscard]] std::vector<std::optional<float>> get_altitudes_world(std::span<const glm::dvec2> world_space_positions) const;
+
+    [[nodiscard]] Statistics statistics() const;
+    [[nodiscard]] unsigned n_decoded_tiles() const;
+
+private:
+    using DecodedRaster = tile::HeightSurfaceRegistry::Surface;
+    [[nodiscard]] DecodedRaster decoded(const tile::Data& tile) const;
+
+    struct DecodedTile {
+        std::shared_ptr<QByteArray> source; // identifies the data the raster was decoded from
+        DecodedRaster raster;
+        std::list<tile::Id>::iterator lru_position;
+    };
+
+    tile::MemoryCache* m_memory_cache = nullptr;
+    std::shared_ptr<tile::HeightSurfaceRegistry> m_height_surfaces;
+    unsigned m_max_decoded_tiles = 0;
+    mutable std::mutex m_mutex;
+    mutable std::list<tile::Id> m_lru; // most recently used first
+    mutable std::unordered_map<tile::Id, DecodedTile, tile::Id::Hasher> m_decoded;
+    mutable Statistics m_statistics;
 };
 
 } // namespace nucleus
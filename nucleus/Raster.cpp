@@ -0,0 +1,162 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include "Raster.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ALP_RASTER_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ALP_RASTER_NEON
+#endif
+
+// All kernels compute floor((a + b + c + d) / 4) per channel, bit exact with detail::avg.
+
+namespace nucleus::detail {
+
+#if defined(ALP_RASTER_SSE2)
+namespace {
+    // 8 bit channels, n_channels channels per pixel. Consumes 32 bytes of both rows, writes 16 bytes.
+    template <unsigned n_channels> inline __m128i downsample_u8_block(const uint8_t* upper, const uint8_t* lower)
+    {
+        static_assert(n_channels == 2 || n_channels == 4);
+        const __m128i zero = _mm_setzero_si128();
+        const auto half = [&](__m128i u, __m128i l, bool high) {
+            // widen to 16 bit and add vertically
+            const __m128i v = high ? _mm_add_epi16(_mm_unpackhi_epi8(u, zero), _mm_unpackhi_epi8(l, zero))
+                                   : _mm_add_epi16(_mm_unpacklo_epi8(u, zero), _mm_unpacklo_epi8(l, zero));
+            // add horizontally neighbouring pixels, results end up in the lower half of each 64 bit lane
+            __m128i h;
+            if constexpr (n_channels == 4)
+                h = _mm_add_epi16(v, _mm_srli_si128(v, 8));
+            else
+                h = _mm_add_epi16(v, _mm_srli_epi64(v, 32));
+            h = _mm_srli_epi16(h, 2);
+            // move the results into the lower 64 bits
+            if constexpr (n_channels == 2)
+                h = _mm_shuffle_epi32(h, _MM_SHUFFLE(3, 1, 2, 0));
+            return h;
+        };
+        const auto compacted = [&](const uint8_t* u_ptr, const uint8_t* l_ptr) {
+            const __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u_ptr));
+            const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(l_ptr));
+            return _mm_unpacklo_epi64(half(u, l, false), half(u, l, true));
+        };
+        return _mm_packus_epi16(compacted(upper, lower), compacted(upper + 16, lower + 16));
+    }
+
+    template <typename T> unsigned downsample_u8_row(const T* upper, const T* lower, T* out, unsigned n_out)
+    {
+        constexpr unsigned n_channels = sizeof(T);
+        constexpr unsigned n_out_per_block = 16 / n_channels;
+        unsigned i = 0;
+        for (; i + n_out_per_block <= n_out; i += n_out_per_block) {
+            const auto* u = reinterpret_cast<const uint8_t*>(upper + i * 2);
+            const auto* l = reinterpret_cast<const uint8_t*>(lower + i * 2);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), downsample_u8_block<n_channels>(u, l));
+        }
+        return i;
+    }
+} // namespace
+
+unsigned DownsampleRow<glm::u8vec4>::run(const glm::u8vec4* upper, const glm::u8vec4* lower, glm::u8vec4* out, unsigned n_out)
+{
+    return downsample_u8_row(upper, lower, out, n_out);
+}
+
+unsigned DownsampleRow<glm::u8vec2>::run(const glm::u8vec2* upper, const glm::u8vec2* lower, glm::u8vec2* out, unsigned n_out)
+{
+    return downsample_u8_row(upper, lower, out, n_out);
+}
+
+unsigned DownsampleRow<uint16_t>::run(const uint16_t* upper, const uint16_t* lower, uint16_t* out, unsigned n_out)
+{
+    // The sum of four uint16_t doesn't fit into 16 bits. Add quarters and remainders separately:
+    // floor((a + b + c + d) / 4) == (a >> 2) + (b >> 2) + (c >> 2) + (d >> 2) + (((a & 3) + (b & 3) + (c & 3) + (d & 3)) >> 2)
+    const __m128i three = _mm_set1_epi16(3);
+    const auto block = [&](const uint16_t* u_ptr, const uint16_t* l_ptr) {
+        const __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u_ptr));
+        const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(l_ptr));
+        const __m128i q = _mm_add_epi16(_mm_srli_epi16(u, 2), _mm_srli_epi16(l, 2));
+        const __m128i r = _mm_add_epi16(_mm_and_si128(u, three), _mm_and_si128(l, three));
+        const __m128i qh = _mm_add_epi16(q, _mm_srli_epi32(q, 16));
+        const __m128i rh = _mm_add_epi16(r, _mm_srli_epi32(r, 16));
+        const __m128i v = _mm_add_epi16(qh, _mm_srli_epi16(rh, 2));
+        // results are in the lower 16 bits of each 32 bit lane. sign extend, so that the saturating pack keeps all bits.
+        return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+    };
+    unsigned i = 0;
+    for (; i + 8 <= n_out; i += 8) {
+        const __m128i a = block(upper + i * 2, lower + i * 2);
+        const __m128i b = block(upper + i * 2 + 8, lower + i * 2 + 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(a, b));
+    }
+    return i;
+}
+
+#elif defined(ALP_RASTER_NEON)
+
+unsigned DownsampleRow<glm::u8vec4>::run(const glm::u8vec4* upper, const glm::u8vec4* lower, glm::u8vec4* out, unsigned n_out)
+{
+    unsigned i = 0;
+    for (; i + 8 <= n_out; i += 8) {
+        const uint8x16x4_t u = vld4q_u8(reinterpret_cast<const uint8_t*>(upper + i * 2));
+        const uint8x16x4_t l = vld4q_u8(reinterpret_cast<const uint8_t*>(lower + i * 2));
+        uint8x8x4_t r;
+        for (int c = 0; c < 4; ++c)
+            r.val[c] = vshrn_n_u16(vpadalq_u8(vpaddlq_u8(u.val[c]), l.val[c]), 2);
+        vst4_u8(reinterpret_cast<uint8_t*>(out + i), r);
+    }
+    return i;
+}
+
+unsigned DownsampleRow<glm::u8vec2>::run(const glm::u8vec2* upper, const glm::u8vec2* lower, glm::u8vec2* out, unsigned n_out)
+{
+    unsigned i = 0;
+    for (; i + 8 <= n_out; i += 8) {
+        const uint8x16x2_t u = vld2q_u8(reinterpret_cast<const uint8_t*>(upper + i * 2));
+        const uint8x16x2_t l = vld2q_u8(reinterpret_cast<const uint8_t*>(lower + i * 2));
+        uint8x8x2_t r;
+        for (int c = 0; c < 2; ++c)
+            r.val[c] = vshrn_n_u16(vpadalq_u8(vpaddlq_u8(u.val[c]), l.val[c]), 2);
+        vst2_u8(reinterpret_cast<uint8_t*>(out + i), r);
+    }
+    return i;
+}
+
+unsigned DownsampleRow<uint16_t>::run(const uint16_t* upper, const uint16_t* lower, uint16_t* out, unsigned n_out)
+{
+    unsigned i = 0;
+    for (; i + 4 <= n_out; i += 4) {
+        const uint32x4_t sum = vpadalq_u16(vpaddlq_u16(vld1q_u16(upper + i * 2)), vld1q_u16(lower + i * 2));
+        vst1_u16(out + i, vshrn_n_u32(sum, 2));
+    }
+    return i;
+}
+
+#else
+
+unsigned DownsampleRow<glm::u8vec4>::run(const glm::u8vec4*, const glm::u8vec4*, glm::u8vec4*, unsigned) { return 0; }
+unsigned DownsampleRow<glm::u8vec2>::run(const glm::u8vec2*, const glm::u8vec2*, glm::u8vec2*, unsigned) { return 0; }
+unsigned DownsampleRow<uint16_t>::run(const uint16_t*, const uint16_t*, uint16_t*, unsigned) { return 0; }
+
+#endif
+
+} // namespace nucleus::detail
@@ -23,15 +23,29 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <glm/glm.hpp>
 #include <glm/gtx/component_wise.hpp>
+#include <memory>
+#include <span>
+#include <utility>
 #include <vector>
 
+#include "RasterView.h"
+
 namespace nucleus {
 
+/// Raster storage is either an owning std::vector (the default) or an adopted buffer, that was allocated elsewhere
+/// (e.g. by an image decoder or a pool) and is handed back through a custom deleter once the raster is destroyed.
+/// Adopting avoids copying decoder output into a vector. Copies of a raster always own a std::vector.
 template <typename T>
 class Raster {
+public:
+    using Deleter = std::function<void(T*)>;
+
+private:
     std::vector<T> m_data;
+    std::unique_ptr<T[], Deleter> m_adopted;
     unsigned m_width = 0;
     unsigned m_height = 0;
 
@@ -62,29 +76,68 @@ public:
         , m_height(size.y)
     {
     }
+    /// adopts buffer (size.x * size.y elements). deleter is called exactly once, when the raster releases the buffer.
+    Raster(const glm::uvec2& size, T* buffer, Deleter deleter)
+        : m_adopted(buffer, std::move(deleter))
+        , m_width(size.x)
+        , m_height(size.y)
+    {
+        assert(buffer != nullptr || size.x * size.y == 0);
+    }
+    Raster(const Raster& other)
+        : m_data(other.begin(), other.end())
+        , m_width(other.m_width)
+        , m_height(other.m_height)
+    {
+    }
+    Raster(Raster&& other) noexcept
+        : m_data(std::move(other.m_data))
+        , m_adopted(std::move(other.m_adopted))
+        , m_width(std::exchange(other.m_width, 0))
+        , m_height(std::exchange(other.m_height, 0))
+    {
+    }
+    Raster& operator=(const Raster& other)
+    {
+        if (this != &other)
+            *this = Raster(other);
+        return *this;
+    }
+    Raster& operator=(Raster&& other) noexcept
+    {
+        m_data = std::move(other.m_data);
+        m_adopted = std::move(other.m_adopted);
+        m_width = std::exchange(other.m_width, 0);
+        m_height = std::exchange(other.m_height, 0);
+        return *this;
+    }
+    ~Raster() = default;
 
-    [[nodiscard]] const std::vector<T>& buffer() const { return m_data; }
-    [[nodiscard]] std::vector<T>& buffer() { return m_data; }
+    [[nodiscard]] bool is_adopted() const { return bool(m_adopted); }
+    [[nodiscard]] std::span<const T> buffer() const { return { data(), buffer_length() }; }
+    [[nodiscard]] std::span<T> buffer() { return { data(), buffer_length() }; }
     [[nodiscard]] unsigned width() const { return m_width; }
     [[nodiscard]] unsigned height() const { return m_height; }
     [[nodiscard]] glm::uvec2 size() const { return { m_width, m_height }; }
-    [[nodiscard]] size_t size_in_bytes() const { return m_data.size() * sizeof(T); }
+    [[nodiscard]] size_t size_in_bytes() const { return buffer_length() * sizeof(T); }
     [[nodiscard]] size_t size_per_line() const { return m_width * sizeof(T); }
-    [[nodiscard]] size_t buffer_length() const { return m_data.size(); }
+    [[nodiscard]] size_t buffer_length() const { return size_t(m_width) * m_height; }
     [[nodiscard]] const T& pixel(const glm::uvec2& position) const
     {
         assert(position.x < m_width);
         assert(position.y < m_height);
-        return m_data[position.x + m_width * position.y];
+        return data()[position.x + m_width * position.y];
     }
     [[nodiscard]] T& pixel(const glm::uvec2& position)
     {
         assert(position.x < m_width);
         assert(position.y < m_height);
-        return m_data[position.x + m_width * position.y];
+        return data()[position.x + m_width * position.y];
     }
-    [[nodiscard]] const uint8_t* bytes() const { return reinterpret_cast<const uint8_t*>(m_data.data()); }
-    [[nodiscard]] uint8_t* bytes() { return reinterpret_cast<uint8_t*>(m_data.data()); }
+    [[nodiscard]] RasterView<const T> view() const { return { data(), size() }; }
+    [[nodiscard]] RasterView<T> view() { return { data(), size() }; }
+    [[nodiscard]] const uint8_t* bytes() const { return reinterpret_cast<const uint8_t*>(data()); }
+    [[nodiscard]] uint8_t* bytes() { return reinterpret_cast<uint8_t*>(data()); }
 
     void fill(const T& value) { std::fill(begin(), end(), value); }
 
@@ -96,21 +149,25 @@ public:
         if (other.width() != width())
             return;
 
+        if (m_adopted) {
+            m_data.assign(begin(), end());
+            m_adopted.reset();
+        }
         m_height += other.height();
 
         m_data.reserve(m_data.size() + (other.width() * other.height()));
-        m_data.insert(end(), other.begin(), other.end());
+        m_data.insert(m_data.end(), other.begin(), other.end());
     }
 
-    auto begin() { return m_data.begin(); }
-    auto end() { return m_data.end(); }
-    auto begin() const { return m_data.begin(); }
-    auto end() const { return m_data.end(); }
-    auto cbegin() const { return m_data.cbegin(); }
-    auto cend() const { return m_data.cend(); }
+    T* begin() { return data(); }
+    T* end() { return data() + buffer_length(); }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + buffer_length(); }
+    const T* cbegin() const { return data(); }
+    const T* cend() const { return data() + buffer_length(); }
 
-    const T* data() const { return m_data.data(); }
-    T* data() { return m_data.data(); }
+    const T* data() const { return m_adopted ? m_adopted.get() : m_data.data(); }
+    T* data() { return m_adopted ? m_adopted.get() : m_data.data(); }
 };
 
 namespace detail {
@@ -124,9 +181,40 @@ namespace detail {
         return r;
     }
     template <typename T> T avg(const T& a, const T& b, const T& c, const T& d) { return (a + b + c + d) / 4; }
+
+    /// Vectorised 2x2 downsampling of one output row. Specialisations process a prefix of the row and return the
+    /// number of output pixels written, the caller finishes the rest with avg(). The primary template does nothing.
+    /// Implemented in Raster.cpp (SSE2 or NEON, depending on the target).
+    template <typename T> struct DownsampleRow {
+        static unsigned run(const T*, const T*, T*, unsigned) { return 0; }
+    };
+    template <> struct DownsampleRow<glm::u8vec4> {
+        static unsigned run(const glm::u8vec4* upper, const glm::u8vec4* lower, glm::u8vec4* out, unsigned n_out);
+    };
+    template <> struct DownsampleRow<glm::u8vec2> {
+        static unsigned run(const glm::u8vec2* upper, const glm::u8vec2* lower, glm::u8vec2* out, unsigned n_out);
+    };
+    template <> struct DownsampleRow<uint16_t> {
+        static unsigned run(const uint16_t* upper, const uint16_t* lower, uint16_t* out, unsigned n_out);
+    };
 } // namespace detail
 
-template <typename T> std::vector<Raster<T>> generate_mipmap(Raster<T> raster)
+/// averages 2x2 blocks of source into target. target must be half the size of source (rounded down).
+template <typename T> void downsample(RasterView<const T> source, RasterView<T> target)
+{
+    assert(target.size() == source.size() / 2u);
+    for (unsigned j = 0u; j < target.height(); ++j) {
+        const T* upper = source.row(j * 2);
+        const T* lower = source.row(j * 2 + 1);
+        T* out = target.row(j);
+        for (unsigned i = detail::DownsampleRow<T>::run(upper, lower, out, target.width()); i < target.width(); ++i) {
+            out[i] = detail::avg(upper[i * 2], lower[i * 2], upper[i * 2 + 1], lower[i * 2 + 1]);
+        }
+    }
+}
+
+/// allocate_level(size) provides the storage of each level below the first (e.g. from a pool), its content is overwritten.
+template <typename T, typename Allocate> std::vector<Raster<T>> generate_mipmap(Raster<T> raster, const Allocate& allocate_level)
 {
     assert(raster.width() == raster.height()); // this code is not tested for differing sizes
     assert(raster.width() > 1); // also not tested
@@ -143,23 +231,17 @@ template <typename T> std::vector<Raster<T>> generate_mipmap(Raster<T> raster)
     mipmap.push_back(std::move(raster));
     while (glm::compMax(resolution) > 1) {
         resolution = resolution / 2u;
-        Raster<T>& u = mipmap.back();
-        mipmap.push_back(Raster<T>(resolution));
-        Raster<T>& r = mipmap.back();
-        for (unsigned i = 0u; i < resolution.x; ++i) {
-            for (unsigned j = 0u; j < resolution.y; ++j) {
-                // clang-format off
-                r.pixel({ i, j }) = detail::avg(u.pixel({ i * 2, j * 2 }),
-                                                u.pixel({ i * 2, j * 2 + 1 }),
-                                                u.pixel({ i * 2 + 1, j * 2 }),
-                                                u.pixel({ i * 2 + 1, j * 2 + 1 }));
-                // clang-format on
-            }
-        }
+        mipmap.push_back(allocate_level(resolution));
+        downsample<T>(mipmap[mipmap.size() - 2].view(), mipmap.back().view());
     }
     return mipmap;
 }
 
+template <typename T> std::vector<Raster<T>> generate_mipmap(Raster<T> raster)
+{
+    return generate_mipmap(std::move(raster), [](const glm::uvec2& size) { return Raster<T>(size); });
+}
+
 template <typename T> Raster<T> resize(const Raster<T>& raster, const glm::uvec2& new_size, T fill)
 {
     Raster<T> n = Raster<T>(new_size, fill);
@@ -185,4 +267,23 @@ template <typename T> Raster<T> concatenate_horizontally(const Raster<T>& a, con
     }
     return r;
 }
+
+/// copies source into target. both must have the same size, strides may differ.
+template <typename T> void copy(RasterView<const T> source, RasterView<T> target)
+{
+    assert(source.size() == target.size());
+    if (source.is_contiguous() && target.is_contiguous()) {
+        std::copy_n(source.data(), size_t(source.width()) * source.height(), target.data());
+        return;
+    }
+    for (auto l = 0u; l < source.height(); ++l) {
+        std::copy_n(source.row(l), source.width(), target.row(l));
+    }
+}
+
+/// copies source into target, with the top left corner of source at offset. source must fit.
+template <typename T> void copy_into(Raster<T>& target, const Raster<T>& source, const glm::uvec2& offset)
+{
+    copy<T>(source.view(), target.view().sub_view(offset, source.size()));
+}
 }
@@ -0,0 +1,85 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <type_traits>
+
+namespace nucleus {
+
+/// Non-owning view into row major pixel data. stride is the distance between two rows in elements, which
+/// allows views into a sub rectangle of a larger raster (e.g. one quadrant of a quad texture).
+/// Use RasterView<const T> for read only access.
+template <typename T> class RasterView {
+    T* m_data = nullptr;
+    unsigned m_width = 0;
+    unsigned m_height = 0;
+    size_t m_stride = 0;
+
+public:
+    RasterView() = default;
+    RasterView(T* data, const glm::uvec2& size, size_t stride)
+        : m_data(data)
+        , m_width(size.x)
+        , m_height(size.y)
+        , m_stride(stride)
+    {
+        assert(stride >= size.x);
+    }
+    RasterView(T* data, const glm::uvec2& size)
+        : RasterView(data, size, size.x)
+    {
+    }
+    // RasterView<T> -> RasterView<const T>
+    template <typename U>
+        requires(std::is_const_v<T> && std::is_same_v<std::remove_const_t<T>, U>)
+    RasterView(const RasterView<U>& other)
+        : RasterView(other.data(), other.size(), other.stride())
+    {
+    }
+
+    [[nodiscard]] unsigned width() const { return m_width; }
+    [[nodiscard]] unsigned height() const { return m_height; }
+    [[nodiscard]] glm::uvec2 size() const { return { m_width, m_height }; }
+    [[nodiscard]] size_t stride() const { return m_stride; }
+    [[nodiscard]] bool is_contiguous() const { return m_stride == m_width; }
+    [[nodiscard]] T* data() const { return m_data; }
+    [[nodiscard]] T* row(unsigned y) const
+    {
+        assert(y < m_height);
+        return m_data + y * m_stride;
+    }
+    [[nodiscard]] T& pixel(const glm::uvec2& position) const
+    {
+        assert(position.x < m_width);
+        assert(position.y < m_height);
+        return m_data[position.x + m_stride * position.y];
+    }
+    [[nodiscard]] RasterView sub_view(const glm::uvec2& offset, const glm::uvec2& size) const
+    {
+        assert(offset.x + size.x <= m_width);
+        assert(offset.y + size.y <= m_height);
+        return { m_data + offset.x + m_stride * offset.y, size, m_stride };
+    }
+};
+
+} // namespace nucleus
@@ -64,6 +64,9 @@ SchedulerHolder scheduler(TileLoadServicePtr tile_service, const tile::utils::Aa
 
         QObject::connect(qa, &QuadAssembler::quad_loaded, sl, &SlotLimiter::deliver_quad);
         QObject::connect(sl, &SlotLimiter::quad_delivered, sch, &nucleus::map_label::Scheduler::receive_quad);
+
+        QObject::connect(tile_service.get(), &TileLoadService::stats_ready, sch, &Scheduler::relay_stats);
+        QObject::connect(qa, &QuadAssembler::stats_ready, sch, &Scheduler::relay_stats);
     }
     if (QNetworkInformation::loadDefaultBackend() && QNetworkInformation::instance()) {
         QNetworkInformation* n = QNetworkInformation::instance();
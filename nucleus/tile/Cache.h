@@ -22,7 +22,9 @@
 #include <QFile>
 #include <algorithm>
 #include <filesystem>
+#include <limits>
 #include <mutex>
+#include <nucleus/utils/FileLock.h>
 #include <nucleus/utils/lang.h>
 #include <shared_mutex>
 #include <tl/expected.hpp>
@@ -49,6 +51,9 @@ constexpr auto serialize(auto & archive, glm::vec<2, T> & vec)
 namespace nucleus::tile {
 
 /// This class is thread safe. be careful with the visit method as it writes the cache and therefore locks an internal mutex.
+/// The disk cache can be shared between processes: writers hold an exclusive file lock and merge their tiles into the index
+/// written by the others, readers hold a shared lock. load_from_disk picks up tiles written by other processes.
+/// The shared index is capped by the capacity given to write_to_disk, least recently visited tiles are dropped first.
 template<NamedTile T>
 class Cache
 {
@@ -64,7 +69,10 @@ class Cache
 
     std::unordered_map<tile::Id, CacheObject, tile::Id::Hasher> m_data;
     mutable std::shared_mutex m_data_mutex;
-    std::unordered_map<tile::Id, MetaData, tile::Id::Hasher> m_disk_cached;
+    using DiskIndex = std::unordered_map<tile::Id, MetaData, tile::Id::Hasher>;
+    DiskIndex m_disk_cached; // tiles this cache wrote or read
+    DiskIndex m_shared_index; // all tiles on disk, last time we looked
+    std::filesystem::file_time_type m_shared_index_time = {};
     mutable std::shared_mutex m_disk_cached_mutex;
 
 public:
@@ -78,8 +86,13 @@ public:
     const T& peak_at(const tile::Id& id) const;
     std::vector<T> purge(unsigned remaining_capacity);
 
-    [[nodiscard]] tl::expected<void, QString> write_to_disk(const std::filesystem::path& path);
-    [[nodiscard]] tl::expected<void, QString> read_from_disk(const std::filesystem::path& path);
+    /// keeps at most capacity tiles on disk (the most recently visited ones, written by any process).
+    [[nodiscard]] tl::expected<void, QString> write_to_disk(const std::filesystem::path& path, unsigned capacity = std::numeric_limits<unsigned>::max());
+    /// reads at most capacity tiles (the most recently visited ones).
+    [[nodiscard]] tl::expected<void, QString> read_from_disk(const std::filesystem::path& path, unsigned capacity = std::numeric_limits<unsigned>::max());
+    /// loads the given tiles, if they are on disk (e.g., written by another process). returns the ids of the loaded tiles.
+    /// the index is only re-read if its modification time changed, and tile files are read without blocking access to the cache.
+    [[nodiscard]] tl::expected<std::vector<tile::Id>, QString> load_from_disk(const std::filesystem::path& path, const std::vector<tile::Id>& ids);
 
 private:
     template<typename VisitorFunction>
@@ -97,6 +110,17 @@ private:
     {
         return base_path / "meta_info.alp";
     }
+
+    static std::filesystem::path lock_path(const std::filesystem::path& base_path) { return base_path / "lock"; }
+
+    using VersionInformation = std::remove_cvref_t<decltype(T::version_information)>;
+    static tl::expected<void, QString> check_version(VersionInformation version_info, const std::filesystem::path& path);
+    static tl::expected<DiskIndex, QString> read_index(const std::filesystem::path& base_path);
+    /// removes the least recently visited entries from index, so that at most capacity remain. returns the removed ids.
+    static std::vector<tile::Id> prune(DiskIndex* index, unsigned capacity);
+    static tl::expected<T, QString> read_tile(const std::filesystem::path& path);
+    /// writes to a temporary file first, so that readers in other processes never see half written files.
+    static tl::expected<void, QString> write_atomically(const std::vector<char>& bytes, const std::filesystem::path& path);
 };
 
 using MemoryCache = nucleus::tile::Cache<nucleus::tile::DataQuad>;
@@ -132,7 +156,105 @@ const T& Cache<T>::peak_at(const tile::Id& id) const
     return m_data.at(id).data;
 }
 
-template <NamedTile T> tl::expected<void, QString> Cache<T>::write_to_disk(const std::filesystem::path& base_path)
+template <NamedTile T> tl::expected<void, QString> Cache<T>::check_version(VersionInformation version_info, const std::filesystem::path& path)
+{
+    if (version_info != T::version_information) {
+        version_info[version_info.size() - 1] = 0; // make sure that the string is 0 terminated.
+
+        return tl::unexpected(QString("Cache file '%1' has incompatible version! Disk "
+                                      "version is '%2', but we expected '%3'.")
+                                  .arg(QString::fromStdString(path.string()))
+                                  .arg(version_info.data())
+                                  .arg(T::version_information.data()));
+    }
+    return {};
+}
+
+template <NamedTile T> tl::expected<typename Cache<T>::DiskIndex, QString> Cache<T>::read_index(const std::filesystem::path& base_path)
+{
+    const auto path = meta_info_path(base_path);
+    QFile file(path);
+    if (!file.open(QIODeviceBase::ReadOnly))
+        return tl::unexpected(QString("Couldn't open file '%1' for reading!").arg(QString::fromStdString(path.string())));
+    const auto bytes = file.readAll();
+    zpp::bits::in in(bytes);
+    {
+        VersionInformation version_info = {};
+        const auto r = in(version_info);
+        if (failure(r))
+            return tl::unexpected(QString::fromStdString(std::make_error_code(r).message()));
+        const auto v = check_version(version_info, path);
+        if (!v.has_value())
+            return tl::unexpected(v.error());
+    }
+    DiskIndex index;
+    const auto r = in(index);
+    if (failure(r))
+        return tl::unexpected(QString::fromStdString(std::make_error_code(r).message()));
+    return index;
+}
+
+template <NamedTile T> std::vector<tile::Id> Cache<T>::prune(DiskIndex* index, unsigned capacity)
+{
+    if (index->size() <= capacity)
+        return {};
+    std::vector<std::pair<tile::Id, uint64_t>> entries;
+    entries.reserve(index->size());
+    std::transform(index->cbegin(), index->cend(), std::back_inserter(entries), [](const auto& entry) { return std::make_pair(entry.first, entry.second.visited); });
+    const auto nth_iter = entries.begin() + capacity;
+    std::nth_element(entries.begin(), nth_iter, entries.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+    std::vector<tile::Id> removed;
+    removed.reserve(entries.size() - capacity);
+    std::for_each(nth_iter, entries.end(), [&](const auto& v) {
+        index->erase(v.first);
+        removed.push_back(v.first);
+    });
+    return removed;
+}
+
+template <NamedTile T> tl::expected<T, QString> Cache<T>::read_tile(const std::filesystem::path& path)
+{
+    QFile file(path);
+    if (!file.open(QIODeviceBase::ReadOnly))
+        return tl::unexpected(QString("Couldn't open file '%1' for reading!").arg(QString::fromStdString(path.string())));
+    const auto bytes = file.readAll();
+    zpp::bits::in in(bytes);
+    {
+        VersionInformation version_info = {};
+        const auto r = in(version_info);
+        if (failure(r))
+            return tl::unexpected(QString::fromStdString(std::make_error_code(r).message()));
+        const auto v = check_version(version_info, path);
+        if (!v.has_value())
+            return tl::unexpected(v.error());
+    }
+    T tile;
+    const auto r = in(tile);
+    if (failure(r))
+        return tl::unexpected(QString::fromStdString(std::make_error_code(r).message()));
+    return tile;
+}
+
+template <NamedTile T> tl::expected<void, QString> Cache<T>::write_atomically(const std::vector<char>& bytes, const std::filesystem::path& path)
+{
+    // writers hold the exclusive lock, so a fixed name for the temporary file is fine.
+    auto temp_path = path;
+    temp_path += ".tmp";
+    {
+        QFile file(temp_path);
+        if (!file.open(QIODeviceBase::WriteOnly))
+            return tl::unexpected<QString>(QString("Couldn't open file '%1' for writing!").arg(QString::fromStdString(temp_path.string())));
+        if (file.write(bytes.data(), qint64(bytes.size())) != qint64(bytes.size()))
+            return tl::unexpected<QString>(QString("Couldn't write file '%1'!").arg(QString::fromStdString(temp_path.string())));
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec)
+        return tl::unexpected(QString::fromStdString(ec.message()));
+    return {};
+}
+
+template <NamedTile T> tl::expected<void, QString> Cache<T>::write_to_disk(const std::filesystem::path& base_path, unsigned capacity)
 {
     const auto unexpected_error = [](const auto& e) { return tl::unexpected(QString::fromStdString(std::make_error_code(e).message())); };
     static_assert(SerialisableTile<T>);
@@ -143,58 +265,56 @@ template <NamedTile T> tl::expected<void, QString> Cache<T>::write_to_disk(const
         data = m_data; // copies only metadata and references to tiles
     }
     auto locker = std::scoped_lock(m_disk_cached_mutex);
+    const auto file_lock = utils::FileLock::acquire(lock_path(base_path), utils::FileLock::Mode::Exclusive);
+    if (!file_lock.has_value())
+        return tl::unexpected(file_lock.error());
 
-    const auto write = [](const auto& bytes, const auto& path) -> tl::expected<void, QString> {
-        QFile file(path);
-        const auto success = file.open(QIODeviceBase::WriteOnly);
-        if (!success)
-            return tl::unexpected<QString>(QString("Couldn't open file '%1' for writing!").arg(QString::fromStdString(path.string())));
-        file.write(bytes.data(), qint64(bytes.size()));
-        return {};
-    };
-
-    std::unordered_map<tile::Id, MetaData, tile::Id::Hasher> disk_cached_old;
-    std::swap(m_disk_cached, disk_cached_old);
-    m_disk_cached.reserve(data.size());
+    // other processes might have written tiles since we last looked. an unreadable index is simply replaced.
+    DiskIndex disk_index = read_index(base_path).value_or(DiskIndex {});
 
-    // removing disk cache items, that were removed or updated in ram
-    for (const auto& item : disk_cached_old) {
+    // removing disk cache items, that were removed or updated in ram. unless another process replaced them in the meanwhile.
+    for (const auto& item : m_disk_cached) {
         const tile::Id& id = item.first;
         const MetaData& meta = item.second;
-        if (data.contains(id) && data.at(id).meta.created == meta.created) {
+        if (data.contains(id) && data.at(id).meta.created == meta.created)
             continue;
-        }
+        const auto on_disk = disk_index.find(id);
+        if (on_disk == disk_index.end() || on_disk->second.created != meta.created)
+            continue;
+        disk_index.erase(on_disk);
         std::filesystem::remove(tile_path(base_path, id));
     }
+    m_disk_cached.clear();
+    m_disk_cached.reserve(data.size());
 
-        // write new or updated items to disk
-        for (const auto& item : data) {
-            const tile::Id& id = item.first;
-            const CacheObject& cache_object = item.second;
-            m_disk_cached[id] = cache_object.meta;
+    // merge new or updated items into the index
+    std::vector<tile::Id> to_write;
+    for (const auto& item : data) {
+        const tile::Id& id = item.first;
+        const CacheObject& cache_object = item.second;
 
-            if (disk_cached_old.contains(id) && disk_cached_old.at(id).created == cache_object.meta.created)
-                continue;
-
-            std::vector<char> bytes;
-            zpp::bits::out out(bytes);
-            const std::remove_cvref_t<decltype(T::version_information)> version = T::version_information;
-            {
-                const auto r = out(version);
-                if (failure(r))
-                    return unexpected_error(r);
-            }
-            {
-                const auto r = out(cache_object.data);
-                if (failure(r))
-                    return unexpected_error(r);
-            }
-            {
-                const auto r = write(bytes, tile_path(base_path, id));
-                if (!r.has_value())
-                    return r;
-            }
+        const auto on_disk = disk_index.find(id);
+        if (on_disk != disk_index.end() && on_disk->second.created >= cache_object.meta.created) {
+            on_disk->second.visited = std::max(on_disk->second.visited, cache_object.meta.visited);
+            m_disk_cached[id] = cache_object.meta;
+            continue;
         }
+        disk_index[id] = cache_object.meta;
+        to_write.push_back(id);
+    }
+
+    // the index is shared by all processes, so it would grow without bound otherwise
+    for (const auto& id : prune(&disk_index, capacity)) {
+        std::error_code ec;
+        std::filesystem::remove(tile_path(base_path, id), ec);
+    }
+
+    // write new or updated items to disk
+    for (const auto& id : to_write) {
+        if (!disk_index.contains(id))
+            continue;
+        const CacheObject& cache_object = data.at(id);
+        m_disk_cached[id] = cache_object.meta;
 
         std::vector<char> bytes;
         zpp::bits::out out(bytes);
@@ -204,114 +324,151 @@ template <NamedTile T> tl::expected<void, QString> Cache<T>::write_to_disk(const
             if (failure(r))
                 return unexpected_error(r);
         }
-
         {
-            const auto r = out(m_disk_cached);
+            const auto r = out(cache_object.data);
             if (failure(r))
                 return unexpected_error(r);
         }
+        {
+            const auto r = write_atomically(bytes, tile_path(base_path, id));
+            if (!r.has_value())
+                return r;
+        }
+    }
+    std::erase_if(m_disk_cached, [&disk_index](const auto& item) { return !disk_index.contains(item.first); });
 
-        const auto r = write(bytes, meta_info_path(base_path));
-        if (!r.has_value())
-            return r;
+    std::vector<char> bytes;
+    zpp::bits::out out(bytes);
+    const std::remove_cvref_t<decltype(T::version_information)> version = T::version_information;
+    {
+        const auto r = out(version);
+        if (failure(r))
+            return unexpected_error(r);
+    }
 
-        return {};
+    {
+        const auto r = out(disk_index);
+        if (failure(r))
+            return unexpected_error(r);
+    }
+
+    const auto r = write_atomically(bytes, meta_info_path(base_path));
+    if (!r.has_value())
+        return r;
+
+    m_shared_index = std::move(disk_index);
+    std::error_code ec;
+    m_shared_index_time = std::filesystem::last_write_time(meta_info_path(base_path), ec);
+    return {};
 }
 
-template <NamedTile T> tl::expected<void, QString> Cache<T>::read_from_disk(const std::filesystem::path& base_path)
+template <NamedTile T> tl::expected<void, QString> Cache<T>::read_from_disk(const std::filesystem::path& base_path, unsigned capacity)
 {
-    const auto unexpected_error = [](const auto& e) { return tl::unexpected(QString::fromStdString(std::make_error_code(e).message())); };
     auto locker = std::scoped_lock(m_data_mutex, m_disk_cached_mutex);
     assert(SerialisableTile<T>);
-    const auto check_version = [&unexpected_error](auto* in, const auto& path) -> tl::expected<void, QString> {
-        std::remove_cvref_t<decltype(T::version_information)> version_info = {};
-        {
-            const auto r = (*in)(version_info);
-            if (failure(r))
-                return unexpected_error(r);
-        }
-        if (version_info != T::version_information) {
-            version_info[version_info.size() - 1] = 0;  // make sure that the string is 0 terminated.
-
-            return tl::unexpected(QString("Cache file '%1' has incompatible version! Disk "
-                                          "version is '%2', but we expected '%3'.")
-                                      .arg(QString::fromStdString(path.string()))
-                                      .arg(version_info.data())
-                                      .arg(T::version_information.data()));
-        }
-        return {};
-    };
-    const auto read_all = [](const auto& path) -> tl::expected<QByteArray, QString> {
-        QFile file(path);
-        const auto success = file.open(QIODeviceBase::ReadOnly);
-        if (!success)
-            return tl::unexpected(QString("Couldn't open file '%1' for reading!").arg(QString::fromStdString(path.string())));
-        return file.readAll();
-    };
     const auto clean_up = [&]() {
         m_disk_cached.clear();
+        m_shared_index.clear();
+        m_shared_index_time = {};
         m_data.clear();
     };
 
     clean_up();
+    const auto file_lock = utils::FileLock::acquire(lock_path(base_path), utils::FileLock::Mode::Shared);
+    if (!file_lock.has_value())
+        return tl::unexpected(file_lock.error());
     {
-        const auto path = meta_info_path(base_path);
-        const auto bytes = read_all(path);
-        if (!bytes.has_value()) {
+        auto index = read_index(base_path);
+        if (!index.has_value()) {
             clean_up();
-            return tl::unexpected(bytes.error());
-        }
-        zpp::bits::in in(bytes.value());
-        {
-            const auto r = check_version(&in, path);
-            if (!r.has_value()) {
-                clean_up();
-                return r;
-            }
-        }
-        {
-            const auto r = in(m_disk_cached);
-            if (failure(r)) {
-                clean_up();
-                return unexpected_error(r);
-            }
+            return tl::unexpected(index.error());
         }
+        m_shared_index = std::move(index.value());
     }
+    // only what we hold in ram counts as ours, otherwise write_to_disk would remove the rest from disk.
+    m_disk_cached = m_shared_index;
+    prune(&m_disk_cached, capacity);
 
     for (const auto& entry : m_disk_cached) {
         const tile::Id& id = entry.first;
         const MetaData& meta = entry.second;
 
-        const auto path = tile_path(base_path, id);
-        const auto bytes = read_all(path);
-        if (!bytes.has_value()) {
+        auto tile = read_tile(tile_path(base_path, id));
+        if (!tile.has_value()) {
             clean_up();
-            return tl::unexpected(bytes.error());
-        }
-        zpp::bits::in in(bytes.value());
-        {
-            const auto r = check_version(&in, path);
-            if (!r.has_value()) {
-                clean_up();
-                return r;
-            }
+            return tl::unexpected(tile.error());
         }
-
         CacheObject d;
-        {
-            const auto r = in(d.data);
-            if (failure(r)) {
-                clean_up();
-                return unexpected_error(r);
-            }
-        }
+        d.data = std::move(tile.value());
         d.meta = meta;
         m_data[d.data.id] = d;
     }
+    std::error_code ec;
+    m_shared_index_time = std::filesystem::last_write_time(meta_info_path(base_path), ec);
 
     return {};
 }
 
+template <NamedTile T>
+tl::expected<std::vector<tile::Id>, QString> Cache<T>::load_from_disk(const std::filesystem::path& base_path, const std::vector<tile::Id>& ids)
+{
+    std::vector<std::pair<tile::Id, MetaData>> candidates;
+    {
+        auto locker = std::scoped_lock(m_disk_cached_mutex);
+        // the index is only re-read, when another process wrote it. a missing index means there is no disk cache (yet).
+        std::error_code ec;
+        const auto index_time = std::filesystem::last_write_time(meta_info_path(base_path), ec);
+        if (ec)
+            return std::vector<tile::Id> {};
+        if (index_time != m_shared_index_time) {
+            const auto file_lock = utils::FileLock::acquire(lock_path(base_path), utils::FileLock::Mode::Shared);
+            if (!file_lock.has_value())
+                return tl::unexpected(file_lock.error());
+            auto index = read_index(base_path);
+            if (!index.has_value())
+                return tl::unexpected(index.error());
+            m_shared_index = std::move(index.value());
+            m_shared_index_time = index_time;
+        }
+        for (const auto& id : ids) {
+            const auto on_disk = m_shared_index.find(id);
+            if (on_disk != m_shared_index.end())
+                candidates.emplace_back(id, on_disk->second);
+        }
+    }
+
+    // no locks are held while reading. tile files are replaced atomically, and removed ones are simply skipped.
+    std::vector<std::pair<T, MetaData>> tiles;
+    tiles.reserve(candidates.size());
+    for (const auto& [id, meta] : candidates) {
+        if (contains(id))
+            continue;
+        auto tile = read_tile(tile_path(base_path, id));
+        if (!tile.has_value() || tile->id != id)
+            continue; // the index we have might be outdated (file time resolution), that's not an error.
+        tiles.emplace_back(std::move(tile.value()), meta);
+    }
+    if (tiles.empty())
+        return std::vector<tile::Id> {};
+
+    std::vector<tile::Id> loaded;
+    loaded.reserve(tiles.size());
+    auto locker = std::scoped_lock(m_data_mutex, m_disk_cached_mutex);
+    const auto time_stamp = nucleus::utils::time_since_epoch();
+    for (auto& [tile, meta] : tiles) {
+        const auto id = tile.id;
+        if (m_data.contains(id))
+            continue; // arrived through another path in the meanwhile
+        auto& object = m_data[id];
+        object.data = std::move(tile);
+        object.meta.created = meta.created;
+        object.meta.visited = time_stamp * 100 - id.zoom_level;
+        m_disk_cached[id] = meta;
+        loaded.push_back(id);
+    }
+    return loaded;
+}
+
 template <NamedTile T>
 template <typename VisitorFunction>
 void Cache<T>::visit(const VisitorFunction& functor)
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include "DrawListCache.h"
+
+#include "drawing.h"
+
+namespace nucleus::tile {
+
+DrawListCache::DrawListCache(unsigned max_zoom_level, unsigned max_n_tiles)
+    : m_max_zoom_level(max_zoom_level)
+    , m_max_n_tiles(max_n_tiles)
+{
+}
+
+const DrawListCache::DrawList& DrawListCache::get(const camera::Definition& camera, const utils::AabbDecoratorPtr& aabb_decorator, uint64_t tile_set_version)
+{
+    // camera equality covers position, orientation, projection and viewport, but not the error threshold
+    if (m_key && m_key->camera == camera && m_key->pixel_error_threshold == camera.pixel_error_threshold() && m_key->aabb_decorator == aabb_decorator
+        && m_key->tile_set_version == tile_set_version) {
+        ++m_statistics.n_hits;
+        return m_draw_list;
+    }
+    ++m_statistics.n_misses;
+    m_key = Key { camera, camera.pixel_error_threshold(), aabb_decorator, tile_set_version };
+
+    const auto list = drawing::limit(drawing::generate_list(camera, aabb_decorator, m_max_zoom_level), m_max_n_tiles, camera, aabb_decorator);
+    m_draw_list.tiles = drawing::compute_bounds(list, aabb_decorator);
+    m_draw_list.visible = drawing::sort(drawing::cull(m_draw_list.tiles, camera), camera.position());
+    return m_draw_list;
+}
+
+void DrawListCache::invalidate() { m_key.reset(); }
+
+const DrawListCache::Statistics& DrawListCache::statistics() const { return m_statistics; }
+
+} // namespace nucleus::tile
@@ -0,0 +1,64 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#pragma once
+
+#include "types.h"
+#include "utils.h"
+#include <nucleus/camera/Definition.h>
+#include <optional>
+
+namespace nucleus::tile {
+
+// Keeps the geometry draw list of the last frame. The list only depends on the camera and on the aabb decorator, whose heights
+// change when the gpu tile set changes. Frames that change neither (label uploads, timer ticks, ..) reuse the list.
+class DrawListCache {
+public:
+    struct DrawList {
+        std::vector<TileBounds> tiles; // limited, with bounds
+        std::vector<TileBounds> visible; // culled and sorted front to back
+    };
+    struct Statistics {
+        unsigned n_hits = 0;
+        unsigned n_misses = 0;
+        [[nodiscard]] float hit_rate() const { return (n_hits + n_misses) ? float(n_hits) / float(n_hits + n_misses) : 0.f; }
+    };
+
+    DrawListCache(unsigned max_zoom_level, unsigned max_n_tiles);
+
+    // returns the cached list, if camera, decorator and tile set version are unchanged, otherwise generates a new one
+    const DrawList& get(const camera::Definition& camera, const utils::AabbDecoratorPtr& aabb_decorator, uint64_t tile_set_version);
+    void invalidate();
+    [[nodiscard]] const Statistics& statistics() const;
+
+private:
+    struct Key {
+        camera::Definition camera;
+        float pixel_error_threshold = 0;
+        utils::AabbDecoratorPtr aabb_decorator; // keeps it alive, so that a new decorator can't reuse the address
+        uint64_t tile_set_version = 0;
+    };
+    unsigned m_max_zoom_level;
+    unsigned m_max_n_tiles;
+    std::optional<Key> m_key;
+    DrawList m_draw_list;
+    Statistics m_statistics;
+};
+
+} // namespace nucleus::tile
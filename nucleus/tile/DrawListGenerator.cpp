@@ -20,7 +20,7 @@
 #include "DrawListGenerator.h"
 
 #include "radix/iterator.h"
-#include "radix/quad_tree.h"
+#include "traversal.h"
 
 using TileSet = nucleus::tile::DrawListGenerator::TileSet;
 using namespace nucleus::tile;
@@ -60,7 +60,7 @@ DrawListGenerator::TileSet DrawListGenerator::generate_for(const nucleus::camera
         return all && tile_refine_functor(tile);
     };
 
-    const auto all_leaves = radix::quad_tree::onTheFlyTraverse(tile::Id { 0, { 0, 0 } }, draw_refine_functor, [](const tile::Id& v) { return v.children(); });
+    const auto all_leaves = parallel_traverse(tile::Id { 0, { 0, 0 } }, draw_refine_functor).leaves;
 
     TileSet tileset;
     tileset.reserve(all_leaves.size());
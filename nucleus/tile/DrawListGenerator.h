@@ -19,6 +19,7 @@
 
 #pragma once
 
+#include "FrustumCuller.h"
 #include "radix/iterator.h"
 #include "utils.h"
 #include <nucleus/camera/Definition.h>
@@ -43,11 +44,22 @@ public:
         TileSet visible_leaves;
         visible_leaves.reserve(tileset.size());
 
-        const auto is_visible = [frustum, this](const tile::Id& tile) {
-            return tile::utils::camera_frustum_contains_tile(frustum, m_aabb_decorator->aabb(tile));
-        };
+        const FrustumCuller culler(frustum);
+        std::vector<TileBounds> tiles;
+        tiles.reserve(tileset.size());
+        CameraRelativeBounds relative_bounds(culler.origin());
+        relative_bounds.reserve(tileset.size());
+        for (const auto& id : tileset) {
+            tiles.push_back({ id, m_aabb_decorator->aabb(id) });
+            relative_bounds.push_back(tiles.back().bounds);
+        }
 
-        std::copy_if(tileset.begin(), tileset.end(), radix::unordered_inserter(visible_leaves), is_visible);
+        std::vector<FrustumCuller::Result> results;
+        culler.classify(relative_bounds, &results);
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            if (culler.resolve(results[i], tiles[i].bounds))
+                visible_leaves.insert(tiles[i].id);
+        }
         return visible_leaves;
     }
 
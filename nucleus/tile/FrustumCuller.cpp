@@ -0,0 +1,235 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include "FrustumCuller.h"
+
+#include "utils.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ALP_FRUSTUM_CULLER_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ALP_FRUSTUM_CULLER_NEON
+#endif
+
+namespace nucleus::tile {
+
+namespace {
+    // relative error bound of the float plane distance, in units of the magnitude of the box coordinates and plane distance.
+    // the conversion to float, the 3 products and 3 sums add up to less than 8 float epsilons (2^-23 each), |normal|_1 <= sqrt(3).
+    constexpr float relative_tolerance = 1.0f / (1 << 19);
+    // absolute slack for rounding in the exact test, which works in world coordinates (~1e7 metres)
+    constexpr float absolute_tolerance = 1.0f / (1 << 10);
+
+    struct ScalarLanes {
+        static constexpr unsigned width = 1;
+        using Float = float;
+        using Mask = bool;
+        static Float load(const float* p) { return *p; }
+        static Float splat(float v) { return v; }
+        static Float add(Float a, Float b) { return a + b; }
+        static Float mul(Float a, Float b) { return a * b; }
+        static Float max(Float a, Float b) { return std::max(a, b); }
+        static Float abs(Float a) { return std::abs(a); }
+        static Float neg(Float a) { return -a; }
+        static Mask less(Float a, Float b) { return a < b; }
+        static Mask none() { return false; }
+        static Mask all() { return true; }
+        static Mask bit_or(Mask a, Mask b) { return a || b; }
+        static Mask bit_and(Mask a, Mask b) { return a && b; }
+        static unsigned bits(Mask m) { return m ? 1u : 0u; }
+    };
+
+#if defined(ALP_FRUSTUM_CULLER_SSE2)
+    struct SimdLanes {
+        static constexpr unsigned width = 4;
+        using Float = __m128;
+        using Mask = __m128;
+        static Float load(const float* p) { return _mm_loadu_ps(p); }
+        static Float splat(float v) { return _mm_set1_ps(v); }
+        static Float add(Float a, Float b) { return _mm_add_ps(a, b); }
+        static Float mul(Float a, Float b) { return _mm_mul_ps(a, b); }
+        static Float max(Float a, Float b) { return _mm_max_ps(a, b); }
+        static Float abs(Float a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+        static Float neg(Float a) { return _mm_xor_ps(_mm_set1_ps(-0.0f), a); }
+        static Mask less(Float a, Float b) { return _mm_cmplt_ps(a, b); }
+        static Mask none() { return _mm_setzero_ps(); }
+        static Mask all() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+        static Mask bit_or(Mask a, Mask b) { return _mm_or_ps(a, b); }
+        static Mask bit_and(Mask a, Mask b) { return _mm_and_ps(a, b); }
+        static unsigned bits(Mask m) { return unsigned(_mm_movemask_ps(m)); }
+    };
+#elif defined(ALP_FRUSTUM_CULLER_NEON)
+    struct SimdLanes {
+        static constexpr unsigned width = 4;
+        using Float = float32x4_t;
+        using Mask = uint32x4_t;
+        static Float load(const float* p) { return vld1q_f32(p); }
+        static Float splat(float v) { return vdupq_n_f32(v); }
+        static Float add(Float a, Float b) { return vaddq_f32(a, b); }
+        static Float mul(Float a, Float b) { return vmulq_f32(a, b); }
+        static Float max(Float a, Float b) { return vmaxq_f32(a, b); }
+        static Float abs(Float a) { return vabsq_f32(a); }
+        static Float neg(Float a) { return vnegq_f32(a); }
+        static Mask less(Float a, Float b) { return vcltq_f32(a, b); }
+        static Mask none() { return vdupq_n_u32(0); }
+        static Mask all() { return vdupq_n_u32(~0u); }
+        static Mask bit_or(Mask a, Mask b) { return vorrq_u32(a, b); }
+        static Mask bit_and(Mask a, Mask b) { return vandq_u32(a, b); }
+        static unsigned bits(Mask m)
+        {
+            std::array<uint32_t, 4> lanes;
+            vst1q_u32(lanes.data(), m);
+            return (lanes[0] & 1u) | (lanes[1] & 2u) | (lanes[2] & 4u) | (lanes[3] & 8u);
+        }
+    };
+#else
+    using SimdLanes = ScalarLanes;
+#endif
+
+    // classifies boxes [i, i + Lanes::width). a box is outside, if its most positive corner is clearly behind one of the planes,
+    // and inside, if its most negative corner is clearly in front of all planes. everything else is ambiguous.
+    template <class Lanes, class Planes>
+    void classify_lanes(const CameraRelativeBounds& b, std::size_t i, const Planes& planes, FrustumCuller::Result* out)
+    {
+        using L = Lanes;
+        using Float = typename L::Float;
+        const Float min[3] = { L::load(b.min_x.data() + i), L::load(b.min_y.data() + i), L::load(b.min_z.data() + i) };
+        const Float max[3] = { L::load(b.max_x.data() + i), L::load(b.max_y.data() + i), L::load(b.max_z.data() + i) };
+
+        Float magnitude = L::abs(min[0]);
+        for (unsigned d = 0; d < 3; ++d)
+            magnitude = L::max(magnitude, L::max(L::abs(min[d]), L::abs(max[d])));
+        const auto scaled_magnitude = L::mul(magnitude, L::splat(2 * relative_tolerance));
+
+        auto outside = L::none();
+        auto inside = L::all();
+        for (const auto& p : planes) {
+            auto positive_distance = L::splat(p.distance);
+            auto negative_distance = L::splat(p.distance);
+            for (unsigned d = 0; d < 3; ++d) {
+                const auto n = L::splat(p.normal[d]);
+                positive_distance = L::add(positive_distance, L::mul(n, p.positive[d] ? max[d] : min[d]));
+                negative_distance = L::add(negative_distance, L::mul(n, p.positive[d] ? min[d] : max[d]));
+            }
+            const auto tolerance = L::add(scaled_magnitude, L::splat(p.tolerance));
+            outside = L::bit_or(outside, L::less(positive_distance, L::neg(tolerance)));
+            inside = L::bit_and(inside, L::less(tolerance, negative_distance));
+        }
+
+        const auto outside_bits = L::bits(outside);
+        const auto inside_bits = L::bits(inside);
+        for (unsigned l = 0; l < L::width; ++l) {
+            if ((outside_bits >> l) & 1u)
+                out[i + l] = FrustumCuller::Result::Outside;
+            else if ((inside_bits >> l) & 1u)
+                out[i + l] = FrustumCuller::Result::Inside;
+            else
+                out[i + l] = FrustumCuller::Result::Ambiguous;
+        }
+    }
+} // namespace
+
+CameraRelativeBounds::CameraRelativeBounds(const glm::dvec3& origin)
+    : origin(origin)
+{
+}
+
+void CameraRelativeBounds::reserve(std::size_t n)
+{
+    for (auto* v : { &min_x, &min_y, &min_z, &max_x, &max_y, &max_z })
+        v->reserve(n);
+}
+
+void CameraRelativeBounds::clear()
+{
+    for (auto* v : { &min_x, &min_y, &min_z, &max_x, &max_y, &max_z })
+        v->clear();
+}
+
+void CameraRelativeBounds::push_back(const SrsAndHeightBounds& bounds)
+{
+    const auto min = bounds.min - origin;
+    const auto max = bounds.max - origin;
+    min_x.push_back(float(min.x));
+    min_y.push_back(float(min.y));
+    min_z.push_back(float(min.z));
+    max_x.push_back(float(max.x));
+    max_y.push_back(float(max.y));
+    max_z.push_back(float(max.z));
+}
+
+FrustumCuller::FrustumCuller(const camera::Frustum& frustum, const glm::dvec3& origin)
+    : m_frustum(frustum)
+    , m_origin(origin)
+{
+    for (unsigned i = 0; i < m_planes.size(); ++i) {
+        const auto& p = frustum.clipping_planes[i];
+        // dot(n, x) + d == dot(n, x - origin) + (d + dot(n, origin))
+        const auto distance = float(p.distance + glm::dot(p.normal, origin));
+        m_planes[i] = Plane {
+            .normal = glm::vec3(p.normal),
+            .distance = distance,
+            .tolerance = relative_tolerance * std::abs(distance) + absolute_tolerance,
+            .positive = { p.normal.x > 0, p.normal.y > 0, p.normal.z > 0 },
+        };
+    }
+}
+
+FrustumCuller::FrustumCuller(const camera::Definition& camera)
+    : FrustumCuller(camera.frustum(), camera.position())
+{
+}
+
+FrustumCuller::FrustumCuller(const camera::Frustum& frustum)
+    : FrustumCuller(frustum, (frustum.corners[0] + frustum.corners[1] + frustum.corners[2] + frustum.corners[3]) * 0.25)
+{
+}
+
+void FrustumCuller::classify(const CameraRelativeBounds& bounds, std::vector<Result>* out) const
+{
+    assert(bounds.origin == m_origin);
+    out->resize(bounds.size());
+    const auto n = bounds.size();
+    const auto n_simd = n - n % SimdLanes::width;
+    std::size_t i = 0;
+    for (; i < n_simd; i += SimdLanes::width)
+        classify_lanes<SimdLanes>(bounds, i, m_planes, out->data());
+    for (; i < n; ++i)
+        classify_lanes<ScalarLanes>(bounds, i, m_planes, out->data());
+}
+
+bool FrustumCuller::resolve(Result result, const SrsAndHeightBounds& bounds) const
+{
+    switch (result) {
+    case Result::Outside:
+        return false;
+    case Result::Inside:
+        return true;
+    case Result::Ambiguous:
+        break;
+    }
+    return utils::camera_frustum_contains_tile(m_frustum, bounds);
+}
+
+} // namespace nucleus::tile
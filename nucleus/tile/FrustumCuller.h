@@ -0,0 +1,82 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#pragma once
+
+#include "types.h"
+#include <array>
+#include <cstdint>
+#include <nucleus/camera/Definition.h>
+#include <vector>
+
+namespace nucleus::tile {
+
+// Tile bounds in structure-of-arrays layout, relative to an origin (usually the camera position) and in float.
+// Converting to camera relative coordinates first keeps float precision where it matters, i.e., close to the camera.
+struct CameraRelativeBounds {
+    glm::dvec3 origin = {};
+    std::vector<float> min_x;
+    std::vector<float> min_y;
+    std::vector<float> min_z;
+    std::vector<float> max_x;
+    std::vector<float> max_y;
+    std::vector<float> max_z;
+
+    explicit CameraRelativeBounds(const glm::dvec3& origin = {});
+    void reserve(std::size_t n);
+    void clear();
+    void push_back(const tile::SrsAndHeightBounds& bounds);
+    [[nodiscard]] std::size_t size() const { return min_x.size(); }
+};
+
+// Tests many tile bounds against the frustum at once. classify() runs 4 boxes per step (SSE or NEON, scalar otherwise)
+// in camera relative float, with an error margin that makes the result conservative: boxes that are clearly inside
+// or outside are decided there, and only boxes within the margin of a plane are left to the exact (double) test.
+// classify() followed by resolve() gives the same answer as utils::camera_frustum_contains_tile for every box.
+class FrustumCuller {
+public:
+    enum class Result : uint8_t { Outside, Inside, Ambiguous };
+
+    FrustumCuller(const camera::Frustum& frustum, const glm::dvec3& origin);
+    explicit FrustumCuller(const camera::Definition& camera);
+    // uses the centre of the near plane as origin
+    explicit FrustumCuller(const camera::Frustum& frustum);
+
+    [[nodiscard]] const glm::dvec3& origin() const { return m_origin; }
+    [[nodiscard]] const camera::Frustum& frustum() const { return m_frustum; }
+
+    // bounds must have been built with the same origin. out is resized to bounds.size().
+    void classify(const CameraRelativeBounds& bounds, std::vector<Result>* out) const;
+    // runs the exact test for ambiguous results, bounds are the original (double) bounds of the classified box.
+    [[nodiscard]] bool resolve(Result result, const tile::SrsAndHeightBounds& bounds) const;
+
+private:
+    struct Plane {
+        glm::vec3 normal;
+        float distance; // relative to origin
+        float tolerance; // constant part of the error margin
+        std::array<bool, 3> positive;
+    };
+
+    camera::Frustum m_frustum;
+    glm::dvec3 m_origin;
+    std::array<Plane, 6> m_planes;
+};
+
+} // namespace nucleus::tile
@@ -20,15 +20,17 @@
 
 #include "utils.h"
 #include <QDebug>
-#include <nucleus/tile/conversion.h>
-#include <nucleus/utils/error.h>
+#include <algorithm>
+#include <nucleus/srs.h>
 #include <nucleus/utils/image_loader.h>
+#include <radix/height_encoding.h>
 
 namespace nucleus::tile {
 
 GeometryScheduler::GeometryScheduler(const Settings& settings, unsigned int height_map_size)
     : nucleus::tile::Scheduler(settings)
-    , m_default_raster(glm::uvec2(height_map_size), uint16_t(0))
+    , m_empty_surface(std::make_shared<const Raster<uint16_t>>(glm::uvec2(height_map_size), uint16_t(0)))
+    , m_height_surfaces(std::make_shared<HeightSurfaceRegistry>())
 {
 }
 
@@ -36,6 +38,16 @@ GeometryScheduler::~GeometryScheduler() = default;
 
 void GeometryScheduler::transform_and_emit(const std::vector<tile::DataQuad>& new_quads, const std::vector<tile::Id>& deleted_quads)
 {
+    std::vector<tile::Id> deleted_tiles;
+    deleted_tiles.reserve(deleted_quads.size() * 4);
+    for (const auto& id : deleted_quads) {
+        for (const auto& chid : id.children()) {
+            deleted_tiles.push_back(chid);
+            if (m_gpu_surfaces.erase(chid) && aabb_decorator())
+                aabb_decorator()->remove_loaded_heights(chid);
+        }
+    }
+
     // Tested larger geometry tiles (129x129) and switched back to smaller ones (65x65) for performance reasons (smaller ones are twice as fast).
     std::vector<GpuGeometryTile> new_gpu_tiles;
     new_gpu_tiles.reserve(new_quads.size() * 4);
@@ -45,27 +57,67 @@ void GeometryScheduler::transform_and_emit(const std::vector<tile::DataQuad>& ne
             GpuGeometryTile gpu_tile;
             gpu_tile.id = tile.id;
             if (tile.data->size()) {
-                // tile is available
-                using namespace nucleus::utils;
-                gpu_tile.surface = std::make_shared<const nucleus::Raster<uint16_t>>(
-                    image_loader::rgba8(*tile.data).and_then(error::wrap_to_expected(conversion::to_u16raster)).value_or(m_default_raster));
-            } else {
-                // tile is not available (use default tile)
-                gpu_tile.surface = std::make_shared<const nucleus::Raster<uint16_t>>(m_default_raster);
+                // tile is available (and maybe decoded already by another consumer)
+                gpu_tile.surface = m_height_surfaces->get_or_decode(tile.id, tile.data);
+                if (gpu_tile.surface) {
+                    m_gpu_surfaces[tile.id] = gpu_tile.surface;
+                    if (aabb_decorator()) {
+                        const auto [min_height, max_height] = height_range(tile.id, *gpu_tile.surface);
+                        aabb_decorator()->add_loaded_heights(tile.id, min_height, max_height);
+                        aabb_decorator()->set_geometric_error(tile.id, geometric_error(*gpu_tile.surface));
+                    }
+                }
+            }
+            if (!gpu_tile.surface) {
+                // tile is not available or broken (all of them share the empty surface)
+                gpu_tile.surface = m_empty_surface;
+                gpu_tile.empty = true;
             }
             new_gpu_tiles.push_back(gpu_tile);
         }
     }
 
-    std::vector<tile::Id> deleted_tiles;
-    deleted_tiles.reserve(deleted_quads.size() * 4);
-    for (const auto& id : deleted_quads) {
-        for (const auto& chid : id.children()) {
-            deleted_tiles.push_back(chid);
+    emit gpu_tiles_updated(deleted_tiles, new_gpu_tiles);
+}
+
+std::pair<float, float> GeometryScheduler::height_range(const tile::Id& id, const Raster<uint16_t>& surface)
+{
+    const auto [min_it, max_it] = std::minmax_element(surface.begin(), surface.end());
+    const auto to_altitude = [](uint16_t v) { return radix::height_encoding::to_float(glm::u8vec3(v >> 8, v & 255, 0)); };
+    // the finer terrain between the samples can stick out. allow for a rise of half the sample spacing.
+    const auto sample_spacing = float(srs::tile_bounds(id).size().x) / float(std::max(surface.width(), 2u) - 1);
+    const auto margin = 0.5f * sample_spacing;
+    return { to_altitude(*min_it) - margin, to_altitude(*max_it) + margin };
+}
+
+float GeometryScheduler::geometric_error(const Raster<uint16_t>& surface)
+{
+    // the parent renders this tile with every other sample (the parent's own), interpolated linearly in between.
+    const auto width = surface.width();
+    const auto height = surface.height();
+    std::vector<float> altitudes;
+    altitudes.reserve(surface.buffer_length());
+    std::transform(surface.begin(), surface.end(), std::back_inserter(altitudes), [](uint16_t v) { return radix::height_encoding::to_float(glm::u8vec3(v >> 8, v & 255, 0)); });
+    const auto altitude = [&](unsigned x, unsigned y) { return altitudes[y * width + x]; };
+
+    float max_error = 0;
+    for (unsigned y = 0; y < height; ++y) {
+        const auto y0 = y & ~1u;
+        const auto y1 = std::min(y0 + 2, height - 1);
+        for (unsigned x = 0; x < width; ++x) {
+            if (x % 2 == 0 && y % 2 == 0)
+                continue;
+            const auto x0 = x & ~1u;
+            const auto x1 = std::min(x0 + 2, width - 1);
+            const auto fx = (x1 == x0) ? 0.f : float(x - x0) / float(x1 - x0);
+            const auto fy = (y1 == y0) ? 0.f : float(y - y0) / float(y1 - y0);
+            const auto interpolated = glm::mix(glm::mix(altitude(x0, y0), altitude(x1, y0), fx), glm::mix(altitude(x0, y1), altitude(x1, y1), fx), fy);
+            max_error = std::max(max_error, std::abs(altitude(x, y) - interpolated));
         }
     }
-
-    emit gpu_tiles_updated(deleted_tiles, new_gpu_tiles);
+    return max_error;
 }
 
+const std::shared_ptr<HeightSurfaceRegistry>& GeometryScheduler::height_surfaces() const { return m_height_surfaces; }
+
 } // namespace nucleus::tile
@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include "HeightSurfaceRegistry.h"
 #include "Scheduler.h"
 #include "types.h"
 
@@ -31,6 +32,13 @@ public:
 
     void set_texture_compression_algorithm(nucleus::utils::ColourTexture::Format compression_algorithm);
     static Raster<uint16_t> to_raster(const tile::DataQuad& data_quad, const Raster<uint16_t>& default_raster);
+    /// surfaces of the tiles on the gpu stay registered, so other consumers (e.g. DataQuerier) can reuse them.
+    [[nodiscard]] const std::shared_ptr<HeightSurfaceRegistry>& height_surfaces() const;
+    /// altitude range of a decoded surface, widened for the terrain between the samples. fed into the aabb decorator.
+    [[nodiscard]] static std::pair<float, float> height_range(const tile::Id& id, const Raster<uint16_t>& surface);
+    /// largest vertical deviation (metres) of the surface from the parent's, which has half the resolution over this tile.
+    /// fed into the aabb decorator for geometric error refinement.
+    [[nodiscard]] static float geometric_error(const Raster<uint16_t>& surface);
 
 signals:
     void gpu_tiles_updated(const std::vector<tile::Id>& deleted_tiles, const std::vector<GpuGeometryTile>& new_tiles);
@@ -39,7 +47,9 @@ protected:
     void transform_and_emit(const std::vector<tile::DataQuad>& new_quads, const std::vector<tile::Id>& deleted_quads) override;
 
 private:
-    Raster<uint16_t> m_default_raster;
+    std::shared_ptr<const Raster<uint16_t>> m_empty_surface;
+    std::shared_ptr<HeightSurfaceRegistry> m_height_surfaces;
+    tile::IdMap<HeightSurfaceRegistry::Surface> m_gpu_surfaces; // keeps the registered surfaces of gpu tiles alive
 };
 
 } // namespace nucleus::tile
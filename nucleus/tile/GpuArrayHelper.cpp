@@ -35,10 +35,33 @@ unsigned GpuArrayHelper::add_tile(const tile::Id& id)
     return layer;
 }
 
+GpuArrayHelper::SharedLayer GpuArrayHelper::add_empty_tile(const tile::Id& id)
+{
+    assert(!m_id_to_layer.contains(id));
+    const auto is_new = m_n_empty == 0;
+    if (is_new) {
+        const auto t = std::find(m_array.begin(), m_array.end(), tile::Id { unsigned(-1), {} });
+        assert(t != m_array.end());
+        *t = tile::Id { unsigned(-2), {} }; // marks the shared layer as taken
+        m_empty_layer = unsigned(t - m_array.begin());
+    }
+    ++m_n_empty;
+    m_id_to_layer.emplace(id, m_empty_layer);
+    return { m_empty_layer, is_new };
+}
+
 void GpuArrayHelper::remove_tile(const tile::Id& tile_id)
 {
     assert(m_id_to_layer.contains(tile_id));
+    const auto layer = m_id_to_layer.at(tile_id);
     m_id_to_layer.erase(tile_id);
+    if (m_n_empty > 0 && layer == m_empty_layer) {
+        if (--m_n_empty == 0) {
+            m_array[m_empty_layer] = tile::Id { unsigned(-1), {} };
+            m_empty_layer = unsigned(-1);
+        }
+        return;
+    }
     const auto t = std::find(m_array.begin(), m_array.end(), tile_id);
     assert(t != m_array.end()); // removing a tile that's not here. likely there is a race.
     *t = tile::Id { unsigned(-1), {} };
@@ -55,6 +78,8 @@ unsigned GpuArrayHelper::size() const { return unsigned(m_array.size()); }
 
 unsigned GpuArrayHelper::n_occupied() const { return unsigned(m_id_to_layer.size()); }
 
+unsigned GpuArrayHelper::n_empty() const { return m_n_empty; }
+
 GpuArrayHelper::LayerInfo GpuArrayHelper::layer(Id tile_id) const
 {
     while (!m_id_to_layer.contains(tile_id) && tile_id.zoom_level > 0)
@@ -36,18 +36,29 @@ public:
 
     GpuArrayHelper();
 
+    struct SharedLayer {
+        unsigned index;
+        bool is_new; // content has to be uploaded
+    };
+
     /// returns index in texture array
     unsigned add_tile(const tile::Id& tile_id);
+    /// Tiles without data share a single layer. It takes a free slot while at least one of them is on the gpu, so the
+    /// tile limit still holds. Remove them with remove_tile as usual.
+    SharedLayer add_empty_tile(const tile::Id& tile_id);
     void remove_tile(const tile::Id& tile_id);
     void set_tile_limit(unsigned new_limit);
     unsigned size() const;
     unsigned int n_occupied() const;
+    unsigned n_empty() const;
     Dictionary generate_dictionary() const;
     LayerInfo layer(Id tile_id) const;
 
 private:
     std::vector<tile::Id> m_array;
     tile::IdMap<unsigned> m_id_to_layer;
+    unsigned m_empty_layer = unsigned(-1);
+    unsigned m_n_empty = 0;
 };
 
 } // namespace nucleus::tile
@@ -0,0 +1,92 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include "HeightSurfaceRegistry.h"
+
+#include <QDebug>
+#include <algorithm>
+#include <nucleus/utils/image_loader.h>
+
+namespace nucleus::tile {
+
+HeightSurfaceRegistry::Surface HeightSurfaceRegistry::find(const tile::Id& id, const std::shared_ptr<QByteArray>& data) const
+{
+    std::scoped_lock lock(m_mutex);
+    return find_locked(id, data);
+}
+
+HeightSurfaceRegistry::Surface HeightSurfaceRegistry::get_or_decode(const tile::Id& id, const std::shared_ptr<QByteArray>& data)
+{
+    if (auto surface = find(id, data)) {
+        std::scoped_lock lock(m_mutex);
+        m_statistics.n_shared++;
+        return surface;
+    }
+    // decode without holding the lock. if two consumers race for the same tile, both decode, but only one surface is kept.
+    auto raster = nucleus::utils::image_loader::height_u16(*data);
+    if (!raster) {
+        qWarning() << "HeightSurfaceRegistry: decoding height tile failed:" << raster.error();
+        return {};
+    }
+    {
+        std::scoped_lock lock(m_mutex);
+        m_statistics.n_decoded++;
+    }
+    return insert(id, data, std::make_shared<const Raster<uint16_t>>(std::move(raster.value())));
+}
+
+HeightSurfaceRegistry::Surface HeightSurfaceRegistry::insert(const tile::Id& id, const std::shared_ptr<QByteArray>& data, const Surface& surface)
+{
+    std::scoped_lock lock(m_mutex);
+    if (auto registered = find_locked(id, data))
+        return registered;
+    m_entries[id] = Entry { data, surface };
+    if (m_entries.size() > m_prune_threshold)
+        prune_locked();
+    return surface;
+}
+
+unsigned HeightSurfaceRegistry::n_alive() const
+{
+    std::scoped_lock lock(m_mutex);
+    return unsigned(std::count_if(m_entries.cbegin(), m_entries.cend(), [](const auto& entry) { return !entry.second.surface.expired(); }));
+}
+
+HeightSurfaceRegistry::Statistics HeightSurfaceRegistry::statistics() const
+{
+    std::scoped_lock lock(m_mutex);
+    return m_statistics;
+}
+
+HeightSurfaceRegistry::Surface HeightSurfaceRegistry::find_locked(const tile::Id& id, const std::shared_ptr<QByteArray>& data) const
+{
+    const auto it = m_entries.find(id);
+    if (it == m_entries.end() || it->second.source.lock() != data)
+        return {};
+    return it->second.surface.lock();
+}
+
+void HeightSurfaceRegistry::prune_locked()
+{
+    std::erase_if(m_entries, [](const auto& entry) { return entry.second.surface.expired() || entry.second.source.expired(); });
+    // amortised: the next prune happens after the map has doubled
+    m_prune_threshold = std::max<size_t>(256, m_entries.size() * 2);
+}
+
+} // namespace nucleus::tile
@@ -0,0 +1,67 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#pragma once
+
+#include "types.h"
+#include <QByteArray>
+#include <memory>
+#include <mutex>
+#include <nucleus/Raster.h>
+
+namespace nucleus::tile {
+
+/// Thread safe. Decoded height tiles (see image_loader::height_u16), so that every height tile is decoded at most once,
+/// no matter how many consumers need it (GeometryScheduler, DataQuerier).
+/// The registry doesn't own the surfaces. Consumers keep them alive through their shared_ptr, and an entry is gone
+/// together with the last of them. Entries are matched by tile id and the identity of the source data, so a
+/// replaced tile is never served a stale surface.
+class HeightSurfaceRegistry {
+public:
+    using Surface = std::shared_ptr<const Raster<uint16_t>>;
+    struct Statistics {
+        uint64_t n_decoded = 0;
+        uint64_t n_shared = 0;
+    };
+
+    /// surface that was decoded from data, nullptr if there is none (anymore)
+    [[nodiscard]] Surface find(const tile::Id& id, const std::shared_ptr<QByteArray>& data) const;
+    /// returns the registered surface, or decodes and registers it. nullptr if data can't be decoded.
+    [[nodiscard]] Surface get_or_decode(const tile::Id& id, const std::shared_ptr<QByteArray>& data);
+    /// returns the surface that ends up registered, which is an earlier one, if another consumer was faster.
+    Surface insert(const tile::Id& id, const std::shared_ptr<QByteArray>& data, const Surface& surface);
+
+    [[nodiscard]] unsigned n_alive() const;
+    [[nodiscard]] Statistics statistics() const;
+
+private:
+    struct Entry {
+        std::weak_ptr<QByteArray> source;
+        std::weak_ptr<const Raster<uint16_t>> surface;
+    };
+    [[nodiscard]] Surface find_locked(const tile::Id& id, const std::shared_ptr<QByteArray>& data) const;
+    void prune_locked();
+
+    mutable std::mutex m_mutex;
+    tile::IdMap<Entry> m_entries;
+    size_t m_prune_threshold = 256;
+    Statistics m_statistics;
+};
+
+} // namespace nucleus::tile
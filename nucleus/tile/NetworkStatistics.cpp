@@ -0,0 +1,175 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "NetworkStatistics.h"
+
+#include <QJsonArray>
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+
+namespace nucleus::tile::network {
+
+void Histogram::add(uint64_t value)
+{
+    const auto bucket = std::min(unsigned(std::bit_width(value)), n_buckets - 1);
+    ++m_buckets[bucket];
+    ++m_count;
+    m_sum += value;
+    m_max = std::max(m_max, value);
+}
+
+double Histogram::mean() const
+{
+    if (m_count == 0)
+        return 0;
+    return double(m_sum) / double(m_count);
+}
+
+uint64_t Histogram::quantile(double q) const
+{
+    if (m_count == 0)
+        return 0;
+    const auto target = uint64_t(std::ceil(std::clamp(q, 0.0, 1.0) * double(m_count)));
+    uint64_t accumulated = 0;
+    for (unsigned i = 0; i < n_buckets; ++i) {
+        accumulated += m_buckets[i];
+        if (accumulated >= std::max(target, uint64_t(1)))
+            return std::min(bucket_upper_bound(i), m_max);
+    }
+    return m_max;
+}
+
+uint64_t Histogram::bucket_upper_bound(unsigned bucket)
+{
+    if (bucket == 0)
+        return 0;
+    return (uint64_t(1) << bucket) - 1;
+}
+
+QJsonObject Histogram::to_json() const
+{
+    QJsonArray buckets;
+    for (const auto b : m_buckets)
+        buckets.append(qint64(b));
+
+    QJsonObject o;
+    o["count"] = qint64(m_count);
+    o["sum"] = qint64(m_sum);
+    o["max"] = qint64(m_max);
+    o["mean"] = mean();
+    o["p50"] = qint64(quantile(0.5));
+    o["p90"] = qint64(quantile(0.9));
+    o["p99"] = qint64(quantile(0.99));
+    o["buckets"] = buckets;
+    return o;
+}
+
+QJsonObject Counters::to_json() const
+{
+    QJsonObject o;
+    o["n_requests"] = qint64(n_requests);
+    o["n_good"] = qint64(n_good);
+    o["n_not_found"] = qint64(n_not_found);
+    o["n_network_error"] = qint64(n_network_error);
+    o["n_from_cache"] = qint64(n_from_cache);
+    o["n_bytes"] = qint64(n_bytes);
+    o["n_in_flight"] = qint64(n_in_flight);
+    o["latency_ms"] = latency_ms.to_json();
+    o["time_to_first_byte_ms"] = time_to_first_byte_ms.to_json();
+    o["size_bytes"] = size_bytes.to_json();
+    return o;
+}
+
+void Counters::write_to(QVariantMap* map, const QString& prefix) const
+{
+    auto& m = *map;
+    m[prefix + "n_requests"] = qulonglong(n_requests);
+    m[prefix + "n_good"] = qulonglong(n_good);
+    m[prefix + "n_not_found"] = qulonglong(n_not_found);
+    m[prefix + "n_network_error"] = qulonglong(n_network_error);
+    m[prefix + "n_from_cache"] = qulonglong(n_from_cache);
+    m[prefix + "n_bytes"] = qulonglong(n_bytes);
+    m[prefix + "n_in_flight"] = n_in_flight;
+    m[prefix + "latency_p50_ms"] = qulonglong(latency_ms.quantile(0.5));
+    m[prefix + "latency_p90_ms"] = qulonglong(latency_ms.quantile(0.9));
+    m[prefix + "latency_max_ms"] = qulonglong(latency_ms.max());
+    m[prefix + "ttfb_p50_ms"] = qulonglong(time_to_first_byte_ms.quantile(0.5));
+    m[prefix + "ttfb_p90_ms"] = qulonglong(time_to_first_byte_ms.quantile(0.9));
+}
+
+void Statistics::request_started(const QString& host)
+{
+    ++m_total.n_requests;
+    ++m_total.n_in_flight;
+    auto& h = m_per_host[host];
+    ++h.n_requests;
+    ++h.n_in_flight;
+}
+
+void Statistics::request_finished(const QString& host, const Finished& info)
+{
+    const auto update = [&info](Counters* c) {
+        assert(c->n_in_flight > 0);
+        --c->n_in_flight;
+        switch (info.status) {
+        case NetworkInfo::Status::Good:
+            ++c->n_good;
+            break;
+        case NetworkInfo::Status::NotFound:
+            ++c->n_not_found;
+            break;
+        case NetworkInfo::Status::NetworkError:
+            ++c->n_network_error;
+            break;
+        }
+        if (info.from_cache)
+            ++c->n_from_cache;
+        c->n_bytes += info.n_bytes;
+        c->latency_ms.add(info.latency_ms);
+        c->time_to_first_byte_ms.add(info.time_to_first_byte_ms);
+        if (info.status == NetworkInfo::Status::Good)
+            c->size_bytes.add(info.n_bytes);
+    };
+    update(&m_total);
+    update(&m_per_host[host]);
+}
+
+QVariantMap Statistics::to_variant_map() const
+{
+    QVariantMap map;
+    m_total.write_to(&map, "net_total_");
+    for (const auto& [host, counters] : m_per_host)
+        counters.write_to(&map, QString("net_%1_").arg(host));
+    return map;
+}
+
+QJsonObject Statistics::to_json() const
+{
+    QJsonObject hosts;
+    for (const auto& [host, counters] : m_per_host)
+        hosts[host] = counters.to_json();
+
+    QJsonObject o;
+    o["total"] = m_total.to_json();
+    o["hosts"] = hosts;
+    return o;
+}
+
+} // namespace nucleus::tile::network
@@ -0,0 +1,98 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+#include <QVariantMap>
+#include <array>
+#include <map>
+
+#include "types.h"
+
+namespace nucleus::tile::network {
+
+/// Histogram with power of two buckets. Bucket 0 counts zeros, bucket i counts values in [2^(i-1), 2^i).
+/// Cheap enough to be updated for every request, quantiles are approximate (upper bound of the bucket).
+class Histogram {
+public:
+    static constexpr unsigned n_buckets = 32;
+
+    void add(uint64_t value);
+    [[nodiscard]] uint64_t count() const { return m_count; }
+    [[nodiscard]] uint64_t sum() const { return m_sum; }
+    [[nodiscard]] uint64_t max() const { return m_max; }
+    [[nodiscard]] double mean() const;
+    /// q in [0, 1]
+    [[nodiscard]] uint64_t quantile(double q) const;
+    [[nodiscard]] const std::array<uint64_t, n_buckets>& buckets() const { return m_buckets; }
+    [[nodiscard]] static uint64_t bucket_upper_bound(unsigned bucket);
+
+    [[nodiscard]] QJsonObject to_json() const;
+
+private:
+    std::array<uint64_t, n_buckets> m_buckets = {};
+    uint64_t m_count = 0;
+    uint64_t m_sum = 0;
+    uint64_t m_max = 0;
+};
+
+struct Counters {
+    uint64_t n_requests = 0;
+    uint64_t n_good = 0;
+    uint64_t n_not_found = 0;
+    uint64_t n_network_error = 0;
+    uint64_t n_from_cache = 0;
+    uint64_t n_bytes = 0;
+    unsigned n_in_flight = 0;
+    Histogram latency_ms;
+    Histogram time_to_first_byte_ms;
+    Histogram size_bytes;
+
+    [[nodiscard]] QJsonObject to_json() const;
+    void write_to(QVariantMap* map, const QString& prefix) const;
+};
+
+/// Per host request statistics of one tile layer. Not thread safe, use it from the thread of the owning TileLoadService.
+class Statistics {
+public:
+    struct Finished {
+        NetworkInfo::Status status = NetworkInfo::Status::Good;
+        uint64_t latency_ms = 0;
+        uint64_t time_to_first_byte_ms = 0;
+        uint64_t n_bytes = 0;
+        bool from_cache = false;
+    };
+
+    void request_started(const QString& host);
+    void request_finished(const QString& host, const Finished& info);
+
+    [[nodiscard]] const Counters& total() const { return m_total; }
+    [[nodiscard]] const std::map<QString, Counters>& per_host() const { return m_per_host; }
+
+    /// flat map with keys like "net_total_latency_p50_ms" or "net_<host>_n_good", used for the stats_ready channel.
+    [[nodiscard]] QVariantMap to_variant_map() const;
+    [[nodiscard]] QJsonObject to_json() const;
+
+private:
+    Counters m_total;
+    std::map<QString, Counters> m_per_host;
+};
+
+} // namespace nucleus::tile::network
@@ -18,6 +18,8 @@
 
 #include "QuadAssembler.h"
 
+#include <QVariantMap>
+
 using namespace nucleus::tile;
 
 QuadAssembler::QuadAssembler(QObject* parent)
@@ -27,9 +29,14 @@ QuadAssembler::QuadAssembler(QObject* parent)
 
 size_t QuadAssembler::n_items_in_flight() const { return m_quads.size(); }
 
+const network::Histogram& QuadAssembler::wait_time_ms() const { return m_wait_time_ms; }
+
+void QuadAssembler::set_stats_interval(unsigned int new_stats_interval) { m_stats_interval = new_stats_interval; }
+
 void QuadAssembler::load(const tile::Id& tile_id)
 {
     m_quads[tile_id].id = tile_id;
+    m_request_times[tile_id] = Clock::now();
     for (const auto& child_id : tile_id.children()) {
         emit tile_requested(child_id);
     }
@@ -40,7 +47,23 @@ void QuadAssembler::deliver_tile(const Data& tile)
     auto& quad = m_quads[tile.id.parent()];
     quad.tiles[quad.n_tiles++] = tile;
     if (quad.n_tiles == 4) {
+        const auto requested = m_request_times.find(quad.id);
+        if (requested != m_request_times.end()) {
+            m_wait_time_ms.add(uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - requested->second).count()));
+            m_request_times.erase(requested);
+        }
         emit quad_loaded(quad);
         m_quads.erase(quad.id);
+
+        const auto now = nucleus::utils::time_since_epoch();
+        if (now - m_last_stats_emit >= m_stats_interval) {
+            m_last_stats_emit = now;
+            QVariantMap stats;
+            stats["quad_wait_p50_ms"] = qulonglong(m_wait_time_ms.quantile(0.5));
+            stats["quad_wait_p90_ms"] = qulonglong(m_wait_time_ms.quantile(0.9));
+            stats["quad_wait_max_ms"] = qulonglong(m_wait_time_ms.max());
+            stats["n_quads_assembling"] = qulonglong(m_quads.size());
+            emit stats_ready(stats);
+        }
     }
 }
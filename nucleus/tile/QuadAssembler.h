@@ -18,8 +18,10 @@
 
 #pragma once
 
+#include <chrono>
 #include <unordered_map>
 #include <QObject>
+#include "NetworkStatistics.h"
 #include "types.h"
 
 namespace nucleus::tile {
@@ -28,11 +30,21 @@ class QuadAssembler : public QObject {
     Q_OBJECT
     using TileId2QuadMap = std::unordered_map<tile::Id, DataQuad, tile::Id::Hasher>;
 
+    using Clock = std::chrono::steady_clock;
+    using TileId2TimeMap = std::unordered_map<tile::Id, Clock::time_point, tile::Id::Hasher>;
+
     TileId2QuadMap m_quads;
+    TileId2TimeMap m_request_times;
+    network::Histogram m_wait_time_ms;
+    unsigned m_stats_interval = 1000;
+    uint64_t m_last_stats_emit = 0;
 
 public:
     explicit QuadAssembler(QObject* parent = nullptr);
     [[nodiscard]] size_t n_items_in_flight() const;
+    /// time between the quad request and the arrival of its last tile
+    [[nodiscard]] const network::Histogram& wait_time_ms() const;
+    void set_stats_interval(unsigned int new_stats_interval);
 
 public slots:
     void load(const tile::Id& tile_id);
@@ -41,5 +53,6 @@ public slots:
 signals:
     void tile_requested(const tile::Id& tile_id);
     void quad_loaded(const DataQuad& tile);
+    void stats_ready(const QVariantMap& stats);
 };
 }
@@ -0,0 +1,318 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "RegionPrefetcher.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QRegularExpression>
+#include <algorithm>
+#include <cstdio>
+#include <nucleus/srs.h>
+
+#include "Cache.h"
+#include "utils.h"
+
+using namespace nucleus::tile;
+
+namespace {
+bool point_in_polygon(const glm::dvec2& p, const std::vector<glm::dvec2>& polygon)
+{
+    bool inside = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        const auto& a = polygon[i];
+        const auto& b = polygon[j];
+        if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+            inside = !inside;
+    }
+    return inside;
+}
+
+bool segments_intersect(const glm::dvec2& p1, const glm::dvec2& p2, const glm::dvec2& q1, const glm::dvec2& q2)
+{
+    const auto cross = [](const glm::dvec2& o, const glm::dvec2& a, const glm::dvec2& b) { return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x); };
+    const auto d1 = cross(q1, q2, p1);
+    const auto d2 = cross(q1, q2, p2);
+    const auto d3 = cross(p1, p2, q1);
+    const auto d4 = cross(p1, p2, q2);
+    return ((d1 > 0) != (d2 > 0)) && ((d3 > 0) != (d4 > 0));
+}
+
+bool polygon_overlaps_rect(const std::vector<glm::dvec2>& polygon, const glm::dvec2& min, const glm::dvec2& max)
+{
+    for (const auto& p : polygon) {
+        if (p.x >= min.x && p.x <= max.x && p.y >= min.y && p.y <= max.y)
+            return true;
+    }
+    const auto corners = std::array { min, glm::dvec2 { max.x, min.y }, max, glm::dvec2 { min.x, max.y } };
+    for (const auto& c : corners) {
+        if (point_in_polygon(c, polygon))
+            return true;
+    }
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+        for (size_t k = 0; k < corners.size(); ++k) {
+            if (segments_intersect(polygon[j], polygon[i], corners[k], corners[(k + 1) % corners.size()]))
+                return true;
+        }
+    }
+    return false;
+}
+
+std::string file_name(const tile::Id& id) { return std::to_string(id.zoom_level) + "_" + std::to_string(id.coords.x) + "_" + std::to_string(id.coords.y) + ".alp_tile"; }
+
+std::optional<tile::Id> parse_file_name(const std::string& name)
+{
+    unsigned z = 0, x = 0, y = 0;
+    if (std::sscanf(name.c_str(), "%u_%u_%u.alp_tile", &z, &x, &y) != 3)
+        return {};
+    return tile::Id { z, { x, y } };
+}
+} // namespace
+
+PrefetchRegion PrefetchRegion::from_bounds(const QString& name, const glm::dvec2& lat_long_min, const glm::dvec2& lat_long_max, unsigned min_zoom_level, unsigned max_zoom_level)
+{
+    return { name,
+        { lat_long_min, { lat_long_min.x, lat_long_max.y }, lat_long_max, { lat_long_max.x, lat_long_min.y } },
+        min_zoom_level,
+        max_zoom_level };
+}
+
+QJsonObject PrefetchRegion::to_json() const
+{
+    QJsonArray polygon;
+    for (const auto& p : lat_long_polygon)
+        polygon.append(QJsonArray { p.x, p.y });
+    QJsonObject o;
+    o["name"] = name;
+    o["lat_long_polygon"] = polygon;
+    o["min_zoom_level"] = int(min_zoom_level);
+    o["max_zoom_level"] = int(max_zoom_level);
+    return o;
+}
+
+std::optional<PrefetchRegion> PrefetchRegion::from_json(const QJsonObject& json)
+{
+    if (!json["name"].isString() || !json["lat_long_polygon"].isArray())
+        return {};
+    PrefetchRegion r;
+    r.name = json["name"].toString();
+    r.min_zoom_level = unsigned(json["min_zoom_level"].toInt());
+    r.max_zoom_level = unsigned(json["max_zoom_level"].toInt());
+    for (const auto& p : json["lat_long_polygon"].toArray()) {
+        const auto a = p.toArray();
+        if (a.size() != 2)
+            return {};
+        r.lat_long_polygon.emplace_back(a[0].toDouble(), a[1].toDouble());
+    }
+    if (r.lat_long_polygon.size() < 3)
+        return {};
+    return r;
+}
+
+std::vector<tile::Id> PrefetchRegion::quads(const utils::AabbDecoratorPtr& aabb_decorator, unsigned max_zoom_level_limit) const
+{
+    if (lat_long_polygon.size() < 3)
+        return {};
+    std::vector<glm::dvec2> world_polygon;
+    world_polygon.reserve(lat_long_polygon.size());
+    for (const auto& p : lat_long_polygon)
+        world_polygon.push_back(srs::lat_long_to_world(p));
+
+    // quads on level z load tiles on level z + 1, the scheduler never requests quads on the max zoom level.
+    const auto max_quad_zoom_level = std::min(max_zoom_level, max_zoom_level_limit);
+
+    std::vector<tile::Id> result;
+    std::vector<tile::Id> level = { tile::Id { 0, { 0, 0 } } };
+    while (!level.empty() && level.front().zoom_level < max_quad_zoom_level) {
+        std::vector<tile::Id> next_level;
+        for (const auto& id : level) {
+            const auto aabb = aabb_decorator->aabb(id);
+            if (!polygon_overlaps_rect(world_polygon, glm::dvec2(aabb.min), glm::dvec2(aabb.max)))
+                continue;
+            if (id.zoom_level >= min_zoom_level)
+                result.push_back(id);
+            for (const auto& child : id.children())
+                next_level.push_back(child);
+        }
+        level = std::move(next_level);
+    }
+    return result;
+}
+
+RegionPrefetcher::RegionPrefetcher(std::filesystem::path base_path, QObject* parent)
+    : QObject { parent }
+    , m_base_path(std::move(base_path))
+{
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(m_base_path, ec)) {
+        if (const auto id = parse_file_name(entry.path().filename().string()))
+            m_stored.insert(*id);
+    }
+}
+
+void RegionPrefetcher::add(const PrefetchRegion& region, const utils::AabbDecoratorPtr& aabb_decorator, unsigned max_zoom_level)
+{
+    cancel(region.name);
+    std::filesystem::create_directories(manifest_path(region.name).parent_path());
+    QFile file(manifest_path(region.name));
+    if (file.open(QIODeviceBase::WriteOnly))
+        file.write(QJsonDocument(region.to_json()).toJson());
+    else
+        qWarning() << "Couldn't write the manifest of region" << region.name << "prefetching won't resume after a restart.";
+    track(region, aabb_decorator, max_zoom_level);
+}
+
+void RegionPrefetcher::cancel(const QString& name)
+{
+    std::erase_if(m_regions, [&name](const RegionState& r) { return r.region.name == name; });
+    std::filesystem::remove(manifest_path(name));
+    m_pending.clear();
+    for (const auto& r : m_regions) {
+        for (auto i = r.cursor; i < r.quads.size(); ++i) {
+            if (!m_stored.contains(r.quads[i]))
+                m_pending.insert(r.quads[i]);
+        }
+    }
+}
+
+tl::expected<void, QString> RegionPrefetcher::resume(const utils::AabbDecoratorPtr& aabb_decorator, unsigned max_zoom_level)
+{
+    std::error_code ec;
+    const auto regions_path = m_base_path / "regions";
+    if (!std::filesystem::exists(regions_path, ec))
+        return {};
+    for (const auto& entry : std::filesystem::directory_iterator(regions_path, ec)) {
+        QFile file(entry.path());
+        if (!file.open(QIODeviceBase::ReadOnly))
+            return tl::unexpected(QString("Couldn't open region manifest '%1'.").arg(QString::fromStdString(entry.path().string())));
+        const auto region = PrefetchRegion::from_json(QJsonDocument::fromJson(file.readAll()).object());
+        if (!region)
+            return tl::unexpected(QString("Region manifest '%1' is invalid.").arg(QString::fromStdString(entry.path().string())));
+        if (std::ranges::none_of(m_regions, [&region](const RegionState& r) { return r.region.name == region->name; }))
+            track(*region, aabb_decorator, max_zoom_level);
+    }
+    return {};
+}
+
+void RegionPrefetcher::track(const PrefetchRegion& region, const utils::AabbDecoratorPtr& aabb_decorator, unsigned max_zoom_level)
+{
+    RegionState state { region, region.quads(aabb_decorator, max_zoom_level), {}, 0, 0 };
+    state.members.insert(state.quads.cbegin(), state.quads.cend());
+    for (const auto& id : state.quads) {
+        if (m_stored.contains(id))
+            ++state.n_done;
+        else
+            m_pending.insert(id);
+    }
+    emit progress_changed(region.name, state.n_done, unsigned(state.quads.size()));
+    m_regions.push_back(std::move(state));
+}
+
+std::vector<tile::Id> RegionPrefetcher::next_batch(unsigned n, const std::function<bool(const tile::Id&)>& skip)
+{
+    std::vector<tile::Id> batch;
+    for (auto& r : m_regions) {
+        while (r.cursor < r.quads.size() && m_stored.contains(r.quads[r.cursor]))
+            ++r.cursor;
+        for (auto i = r.cursor; i < r.quads.size() && batch.size() < n; ++i) {
+            const auto& id = r.quads[i];
+            if (m_stored.contains(id) || skip(id) || std::ranges::find(batch, id) != batch.end())
+                continue;
+            batch.push_back(id);
+        }
+        if (batch.size() >= n)
+            break;
+    }
+    return batch;
+}
+
+bool RegionPrefetcher::is_pending(const tile::Id& id) const { return m_pending.contains(id); }
+
+bool RegionPrefetcher::contains(const tile::Id& id) const { return m_stored.contains(id); }
+
+tl::expected<DataQuad, QString> RegionPrefetcher::load(const tile::Id& id) const
+{
+    QFile file(quad_path(id));
+    if (!file.open(QIODeviceBase::ReadOnly))
+        return tl::unexpected(QString("Couldn't open file '%1' for reading!").arg(file.fileName()));
+    const auto bytes = file.readAll();
+    zpp::bits::in in(bytes);
+    std::remove_cvref_t<decltype(DataQuad::version_information)> version = {};
+    DataQuad quad;
+    if (failure(in(version)) || version != DataQuad::version_information || failure(in(quad)))
+        return tl::unexpected(QString("Offline quad '%1' is corrupt or has an incompatible version.").arg(file.fileName()));
+    return quad;
+}
+
+tl::expected<void, QString> RegionPrefetcher::store(const DataQuad& quad)
+{
+    std::vector<char> bytes;
+    zpp::bits::out out(bytes);
+    const std::remove_cvref_t<decltype(DataQuad::version_information)> version = DataQuad::version_information;
+    if (failure(out(version)) || failure(out(quad)))
+        return tl::unexpected(QString("Couldn't serialise quad %1/%2/%3.").arg(quad.id.zoom_level).arg(quad.id.coords.x).arg(quad.id.coords.y));
+
+    std::filesystem::create_directories(m_base_path);
+    // write to a temporary file first, a crash must not leave a half written quad that counts as done.
+    const auto path = quad_path(quad.id);
+    auto temp_path = path;
+    temp_path += ".part";
+    {
+        QFile file(temp_path);
+        if (!file.open(QIODeviceBase::WriteOnly))
+            return tl::unexpected(QString("Couldn't open file '%1' for writing!").arg(file.fileName()));
+        if (file.write(bytes.data(), qint64(bytes.size())) != qint64(bytes.size()))
+            return tl::unexpected(QString("Couldn't write file '%1'!").arg(file.fileName()));
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec)
+        return tl::unexpected(QString::fromStdString(ec.message()));
+
+    const auto newly_stored = m_stored.insert(quad.id).second;
+    m_pending.erase(quad.id);
+    for (auto& r : m_regions) {
+        if (!newly_stored || !r.members.contains(quad.id))
+            continue;
+        ++r.n_done;
+        emit progress_changed(r.region.name, r.n_done, unsigned(r.quads.size()));
+    }
+    return {};
+}
+
+std::optional<RegionPrefetcher::Progress> RegionPrefetcher::progress(const QString& name) const
+{
+    for (const auto& r : m_regions) {
+        if (r.region.name == name)
+            return Progress { r.n_done, unsigned(r.quads.size()) };
+    }
+    return {};
+}
+
+const std::filesystem::path& RegionPrefetcher::base_path() const { return m_base_path; }
+
+std::filesystem::path RegionPrefetcher::quad_path(const tile::Id& id) const { return m_base_path / file_name(id); }
+
+std::filesystem::path RegionPrefetcher::manifest_path(const QString& name) const
+{
+    auto file_name = name;
+    file_name.replace(QRegularExpression("[^A-Za-z0-9_-]"), "_");
+    return m_base_path / "regions" / (file_name.toStdString() + ".json");
+}
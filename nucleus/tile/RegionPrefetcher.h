@@ -0,0 +1,103 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <QJsonObject>
+#include <QObject>
+#include <filesystem>
+#include <functional>
+#include <glm/glm.hpp>
+#include <optional>
+#include <tl/expected.hpp>
+#include <unordered_set>
+#include <vector>
+
+#include "types.h"
+
+namespace nucleus::tile {
+namespace utils {
+    class AabbDecorator;
+    using AabbDecoratorPtr = std::shared_ptr<AabbDecorator>;
+} // namespace utils
+
+/// A region to be made available offline. Zoom levels refer to quads (a quad on level z contains the 4 tiles of level z + 1).
+/// The quad tree is always built from the root, so set min_zoom_level > 0 only if coarser quads are available otherwise.
+struct PrefetchRegion {
+    QString name;
+    std::vector<glm::dvec2> lat_long_polygon;
+    unsigned min_zoom_level = 0;
+    unsigned max_zoom_level = 16;
+
+    static PrefetchRegion from_bounds(const QString& name, const glm::dvec2& lat_long_min, const glm::dvec2& lat_long_max, unsigned min_zoom_level, unsigned max_zoom_level);
+    [[nodiscard]] QJsonObject to_json() const;
+    [[nodiscard]] static std::optional<PrefetchRegion> from_json(const QJsonObject& json);
+    /// all quads overlapping the region, coarse to fine
+    [[nodiscard]] std::vector<tile::Id> quads(const utils::AabbDecoratorPtr& aabb_decorator, unsigned max_zoom_level) const;
+};
+
+/// Downloads regions quad by quad, and keeps them in an on-disk store that is independent of the ram cache (and its purging).
+/// Regions are written as json manifests next to the quads, so that downloads can be resumed after a restart. Quads that are
+/// already in the store are never requested again.
+class RegionPrefetcher : public QObject {
+    Q_OBJECT
+public:
+    struct Progress {
+        unsigned n_done = 0;
+        unsigned n_total = 0;
+    };
+
+    explicit RegionPrefetcher(std::filesystem::path base_path, QObject* parent = nullptr);
+
+    void add(const PrefetchRegion& region, const utils::AabbDecoratorPtr& aabb_decorator, unsigned max_zoom_level);
+    void cancel(const QString& name);
+    /// reads region manifests written by earlier runs
+    tl::expected<void, QString> resume(const utils::AabbDecoratorPtr& aabb_decorator, unsigned max_zoom_level);
+
+    /// up to n quads that still need downloading, skipping those for which skip returns true
+    [[nodiscard]] std::vector<tile::Id> next_batch(unsigned n, const std::function<bool(const tile::Id&)>& skip);
+    [[nodiscard]] bool is_pending(const tile::Id& id) const;
+    [[nodiscard]] bool contains(const tile::Id& id) const;
+    [[nodiscard]] tl::expected<DataQuad, QString> load(const tile::Id& id) const;
+    tl::expected<void, QString> store(const DataQuad& quad);
+
+    [[nodiscard]] std::optional<Progress> progress(const QString& name) const;
+    [[nodiscard]] const std::filesystem::path& base_path() const;
+
+signals:
+    void progress_changed(const QString& region_name, unsigned n_done, unsigned n_total);
+
+private:
+    struct RegionState {
+        PrefetchRegion region;
+        std::vector<tile::Id> quads;
+        std::unordered_set<tile::Id, tile::Id::Hasher> members;
+        size_t cursor = 0; // everything before the cursor is stored
+        unsigned n_done = 0;
+    };
+    void track(const PrefetchRegion& region, const utils::AabbDecoratorPtr& aabb_decorator, unsigned max_zoom_level);
+    [[nodiscard]] std::filesystem::path quad_path(const tile::Id& id) const;
+    [[nodiscard]] std::filesystem::path manifest_path(const QString& name) const;
+
+    std::filesystem::path m_base_path;
+    std::vector<RegionState> m_regions;
+    std::unordered_set<tile::Id, tile::Id::Hasher> m_stored;
+    std::unordered_set<tile::Id, tile::Id::Hasher> m_pending;
+};
+
+} // namespace nucleus::tile
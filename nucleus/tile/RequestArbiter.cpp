@@ -0,0 +1,234 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "RequestArbiter.h"
+
+#include <QTimer>
+#include <algorithm>
+#include <limits>
+#include <nucleus/utils/lang.h>
+
+#include "SlotLimiter.h"
+
+using namespace nucleus::tile;
+
+RequestArbiter::RequestArbiter(const Settings& settings, QObject* parent)
+    : QObject { parent }
+    , m(settings)
+    , m_process_timer(std::make_unique<QTimer>(this))
+{
+    m_process_timer->setSingleShot(true);
+    connect(m_process_timer.get(), &QTimer::timeout, this, &RequestArbiter::process);
+}
+
+RequestArbiter::~RequestArbiter() = default;
+
+unsigned RequestArbiter::attach(const QString& name, SlotLimiter* limiter, unsigned rank, ImportanceFunction importance)
+{
+    assert(limiter);
+    assert(limiter->thread() == thread());
+    if (!importance)
+        importance = [](const tile::Id& id) { return 1.0f / float(1 + id.zoom_level); };
+
+    const auto layer = unsigned(m_layers.size());
+    m_layers.push_back({ name, limiter, rank, std::move(importance), {}, 0, 0 });
+    limiter->set_arbiter(this, layer);
+    return layer;
+}
+
+void RequestArbiter::set_layer_rank(const QString& name, unsigned rank)
+{
+    for (auto& layer : m_layers) {
+        if (layer.name == name)
+            layer.rank = rank;
+    }
+}
+
+unsigned RequestArbiter::layer_rank(const QString& name) const
+{
+    for (const auto& layer : m_layers) {
+        if (layer.name == name)
+            return layer.rank;
+    }
+    return default_layer_rank(name);
+}
+
+unsigned RequestArbiter::default_layer_rank(const QString& name)
+{
+    // labels and ortho are draped onto / placed on the terrain, without geometry there is nothing to show them on.
+    // geometry therefore always goes first (up to starvation), no matter how important the quads of the other layers are.
+    if (name == "geometry")
+        return 2;
+    if (name == "map_label")
+        return 1;
+    return 0;
+}
+
+void RequestArbiter::set_settings(const Settings& settings)
+{
+    assert(settings.slot_limit > 0);
+    assert(settings.rate_period_msecs < unsigned(std::numeric_limits<int>::max()));
+    m = settings;
+    process();
+}
+
+const RequestArbiter::Settings& RequestArbiter::settings() const { return m; }
+
+RequestArbiter::Statistics RequestArbiter::statistics() const
+{
+    Statistics s;
+    s.n_in_flight = m_n_in_flight;
+    for (const auto& layer : m_layers)
+        s.n_queued += unsigned(layer.queue.size());
+    s.n_granted = m_n_granted;
+    s.n_starvation_grants = m_n_starvation_grants;
+    s.n_bytes = m_n_bytes;
+    return s;
+}
+
+void RequestArbiter::request_quads(unsigned layer_index, const std::vector<tile::Id>& ids)
+{
+    assert(layer_index < m_layers.size());
+    auto& layer = m_layers[layer_index];
+    if (layer.queue.empty() && !ids.empty())
+        layer.waiting_since_msecs = nucleus::utils::time_since_epoch();
+
+    layer.queue.clear();
+    layer.queue.reserve(ids.size());
+    for (const auto& id : ids)
+        layer.queue.push_back({ id, layer.importance(id) });
+    // stable, so that the order of the scheduler is kept for equal importance. the best request goes to the back.
+    std::ranges::stable_sort(layer.queue, [](const Pending& a, const Pending& b) { return a.importance > b.importance; });
+    std::ranges::reverse(layer.queue);
+    process();
+}
+
+void RequestArbiter::release(unsigned layer_index, uint64_t n_bytes)
+{
+    assert(layer_index < m_layers.size());
+    auto& layer = m_layers[layer_index];
+    assert(layer.n_in_flight > 0);
+    assert(m_n_in_flight > 0);
+    --layer.n_in_flight;
+    --m_n_in_flight;
+    m_n_bytes += n_bytes;
+    m_bandwidth_tokens -= double(n_bytes);
+    process();
+}
+
+bool RequestArbiter::budget_available(uint64_t now_msecs)
+{
+    if (m_n_in_flight >= m.slot_limit)
+        return false;
+
+    while (!m_grant_times.empty() && m_grant_times.front() + m.rate_period_msecs < now_msecs)
+        m_grant_times.pop_front();
+    if (m_grant_times.size() >= m.rate)
+        return false;
+
+    if (m.bandwidth_bytes_per_second == 0)
+        return true;
+    if (m_bandwidth_refill_msecs == 0)
+        m_bandwidth_tokens = double(m.bandwidth_bytes_per_second);
+    else
+        m_bandwidth_tokens += double(now_msecs - m_bandwidth_refill_msecs) / 1000.0 * double(m.bandwidth_bytes_per_second);
+    // bursts of up to one second worth of data
+    m_bandwidth_tokens = std::min(m_bandwidth_tokens, double(m.bandwidth_bytes_per_second));
+    m_bandwidth_refill_msecs = now_msecs;
+    return m_bandwidth_tokens > 0;
+}
+
+std::optional<unsigned> RequestArbiter::pick_layer(uint64_t now_msecs) const
+{
+    // the queue is sorted, so the best request is a background one only if all of them are
+    const auto is_background = [](const Layer& layer) { return layer.queue.back().importance <= background_importance; };
+    const auto can_grant = [this](const Layer& layer) { return !layer.queue.empty() && layer.limiter && layer.limiter->slots_taken() < layer.limiter->limit(); };
+
+    // lexicographic: background requests last, then rank, importance of the best quad only among layers of equal rank
+    const auto better = [&is_background](const Layer& a, const Layer& b) {
+        if (is_background(a) != is_background(b))
+            return is_background(b);
+        if (a.rank != b.rank)
+            return a.rank > b.rank;
+        return a.queue.back().importance > b.queue.back().importance;
+    };
+    std::optional<unsigned> best;
+    for (unsigned i = 0; i < m_layers.size(); ++i) {
+        if (can_grant(m_layers[i]) && (!best || better(m_layers[i], m_layers[*best])))
+            best = i;
+    }
+    if (!best)
+        return {};
+
+    // the best layer is served anyway. among the others, the one waiting the longest goes first, if it waited too long.
+    std::optional<unsigned> most_starved;
+    for (unsigned i = 0; i < m_layers.size(); ++i) {
+        const auto& layer = m_layers[i];
+        if (i == *best || !can_grant(layer) || now_msecs - layer.waiting_since_msecs <= m.starvation_timeout_msecs)
+            continue;
+        if (is_background(layer) && !is_background(m_layers[*best]))
+            continue; // background requests wait for idle time, starving or not
+        if (!most_starved || layer.waiting_since_msecs < m_layers[*most_starved].waiting_since_msecs)
+            most_starved = i;
+    }
+    return most_starved ? most_starved : best;
+}
+
+void RequestArbiter::grant(unsigned layer_index, uint64_t now_msecs, bool starving)
+{
+    auto& layer = m_layers[layer_index];
+    const auto id = layer.queue.back().id;
+    layer.queue.pop_back();
+    layer.waiting_since_msecs = now_msecs;
+    ++layer.n_in_flight;
+    ++m_n_in_flight;
+    ++m_n_granted;
+    if (starving)
+        ++m_n_starvation_grants;
+    m_grant_times.push_back(now_msecs);
+    layer.limiter->grant(id);
+}
+
+void RequestArbiter::process()
+{
+    // granting emits signals, which might deliver synchronously (e.g., from a cache) and call back into release().
+    if (m_processing) {
+        m_process_again = true;
+        return;
+    }
+    m_processing = true;
+    do {
+        m_process_again = false;
+        const auto now = nucleus::utils::time_since_epoch();
+        while (budget_available(now)) {
+            const auto layer = pick_layer(now);
+            if (!layer)
+                break;
+            const auto& l = m_layers[*layer];
+            const auto starving = now - l.waiting_since_msecs > m.starvation_timeout_msecs;
+            grant(*layer, now, starving);
+        }
+    } while (m_process_again);
+    m_processing = false;
+
+    // slots are freed by release(), but rate and bandwidth budgets recover with time.
+    if (m_n_in_flight < m.slot_limit && pick_layer(nucleus::utils::time_since_epoch()) && !m_process_timer->isActive()) {
+        const auto rate_blocked = m_grant_times.size() >= m.rate;
+        m_process_timer->start(rate_blocked ? int(1 + m.rate_period_msecs / 10) : 20);
+    }
+}
@@ -0,0 +1,116 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <QObject>
+#include <QPointer>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "types.h"
+
+class QTimer;
+
+namespace nucleus::tile {
+class SlotLimiter;
+
+/// Shares one request budget (slots in flight, request rate, bandwidth) between several layers (geometry, ortho, labels, ..).
+/// Layers are attached via their SlotLimiter. The SlotLimiter keeps its own (per layer) limit, but hands the queue to the arbiter,
+/// which grants requests across all layers lexicographically: the layer with the highest rank first, and by screen space importance
+/// of the quad among layers of equal rank. Layers that got nothing granted for starvation_timeout_msecs are served first, so that
+/// low rank layers still progress. Background requests (importance background_importance, e.g., offline region prefetch) form
+/// their own lowest tier across all layers, they are granted only when no layer has anything else queued.
+/// All attached SlotLimiters must live in the same thread as the arbiter, calls are direct.
+class RequestArbiter : public QObject {
+    Q_OBJECT
+public:
+    using ImportanceFunction = std::function<float(const tile::Id&)>;
+    /// importance functions return this (or less) for background requests
+    static constexpr float background_importance = -1.0f;
+    struct Settings {
+        unsigned slot_limit = 32; // quads in flight summed over all layers
+        unsigned rate = 200; // quads per rate_period_msecs summed over all layers
+        unsigned rate_period_msecs = 1000;
+        uint64_t bandwidth_bytes_per_second = 0; // 0: unlimited
+        unsigned starvation_timeout_msecs = 2000;
+    };
+    struct Statistics {
+        unsigned n_in_flight = 0;
+        unsigned n_queued = 0;
+        uint64_t n_granted = 0;
+        uint64_t n_starvation_grants = 0;
+        uint64_t n_bytes = 0;
+    };
+
+    explicit RequestArbiter(const Settings& settings, QObject* parent = nullptr);
+    ~RequestArbiter() override;
+
+    /// returns the layer index. importance defaults to preferring coarse quads.
+    unsigned attach(const QString& name, SlotLimiter* limiter, unsigned rank, ImportanceFunction importance = {});
+    void set_layer_rank(const QString& name, unsigned rank);
+    [[nodiscard]] unsigned layer_rank(const QString& name) const;
+    [[nodiscard]] static unsigned default_layer_rank(const QString& name);
+
+    void set_settings(const Settings& settings);
+    [[nodiscard]] const Settings& settings() const;
+    [[nodiscard]] Statistics statistics() const;
+
+    // called by attached SlotLimiters
+    void request_quads(unsigned layer, const std::vector<tile::Id>& ids);
+    void release(unsigned layer, uint64_t n_bytes);
+
+private slots:
+    void process();
+
+private:
+    struct Pending {
+        tile::Id id;
+        float importance;
+    };
+    struct Layer {
+        QString name;
+        QPointer<SlotLimiter> limiter;
+        unsigned rank = 0;
+        ImportanceFunction importance;
+        std::vector<Pending> queue; // sorted by importance, highest at the back
+        unsigned n_in_flight = 0;
+        uint64_t waiting_since_msecs = 0; // last grant, or when the queue became non-empty
+    };
+
+    [[nodiscard]] bool budget_available(uint64_t now_msecs);
+    [[nodiscard]] std::optional<unsigned> pick_layer(uint64_t now_msecs) const;
+    void grant(unsigned layer, uint64_t now_msecs, bool starving);
+
+    Settings m;
+    std::vector<Layer> m_layers;
+    std::deque<uint64_t> m_grant_times;
+    double m_bandwidth_tokens = 0;
+    uint64_t m_bandwidth_refill_msecs = 0;
+    uint64_t m_n_granted = 0;
+    uint64_t m_n_starvation_grants = 0;
+    uint64_t m_n_bytes = 0;
+    unsigned m_n_in_flight = 0;
+    bool m_processing = false;
+    bool m_process_again = false;
+    std::unique_ptr<QTimer> m_process_timer;
+};
+
+} // namespace nucleus::tile
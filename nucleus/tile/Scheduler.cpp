@@ -19,6 +19,8 @@
  *****************************************************************************/
 
 #include "Scheduler.h"
+#include "RegionPrefetcher.h"
+#include "RequestArbiter.h"
 
 #include <QBuffer>
 #include <QDebug>
@@ -27,8 +29,8 @@
 #include <QTimer>
 #include <QVariantMap>
 #include <nucleus/DataQuerier.h>
+#include <nucleus/tile/traversal.h>
 #include <nucleus/tile/utils.h>
-#include <radix/quad_tree.h>
 #include <unordered_set>
 #include <utility>
 
@@ -78,6 +80,11 @@ void Scheduler::receive_quad(const DataQuad& new_quad)
     case Status::Good:
     case Status::NotFound: {
         m_ram_cache.insert(new_quad);
+        if (m_prefetcher && m_prefetcher->is_pending(new_quad.id)) {
+            const auto r = m_prefetcher->store(new_quad);
+            if (!r.has_value())
+                qDebug() << QString("Storing quad of an offline region failed: %1").arg(r.error());
+        }
         QVariantMap stats;
         stats["n_quads_ram"] = m_ram_cache.n_cached_objects();
         emit stats_ready(m_name, stats);
@@ -117,7 +124,7 @@ void Scheduler::set_network_reachability(QNetworkInformation::Reachability reach
 
 void Scheduler::update_gpu_quads()
 {
-    const auto should_refine = tile::utils::refineFunctor(m_current_camera, m_aabb_decorator, m.tile_resolution, m.max_zoom_level);
+    const auto should_refine = tile::utils::refineFunctor(m_current_camera, m_aabb_decorator, m.tile_resolution, m.max_zoom_level, m.refine_criterion);
     std::vector<DataQuad> gpu_candidates;
     m_ram_cache.visit([this, &gpu_candidates, &should_refine](const DataQuad& quad) {
         if (!should_refine(quad.id))
@@ -161,24 +168,134 @@ void Scheduler::update_gpu_quads()
 
 void Scheduler::send_quad_requests()
 {
+    auto quads = missing_quads_for_current_camera();
+    // other processes sharing the disk cache, or offline regions might have them. also without network.
+    load_from_disk_cache(&quads);
+    if (m_prefetcher)
+        load_from_offline_store(&quads);
     if (!m_network_requests_enabled)
         return;
-    auto quads = missing_quads_for_current_camera();
     QVariantMap stats;
     stats["n_quads_ram"] = m_ram_cache.n_cached_objects();
     stats["n_quads_ram_max"] = m.ram_quad_limit;
     stats["n_quads_requested"] = unsigned(quads.size());
+
+    m_prefetch_requests.clear();
+    if (m_prefetcher) {
+        const std::unordered_set<tile::Id, tile::Id::Hasher> camera_quads(quads.cbegin(), quads.cend());
+        const auto batch = m_prefetcher->next_batch(m.prefetch_batch_size, [&camera_quads](const tile::Id& id) { return camera_quads.contains(id); });
+        for (const auto& id : batch) {
+            // quads loaded for the camera go straight into the store. if that fails, they are downloaded (and stored) again.
+            if (m_ram_cache.contains(id) && m_ram_cache.peak_at(id).network_info().status != NetworkInfo::Status::NetworkError) {
+                const auto r = m_prefetcher->store(m_ram_cache.peak_at(id));
+                if (r.has_value())
+                    continue;
+                qDebug() << QString("Storing quad of an offline region failed: %1").arg(r.error());
+            }
+            m_prefetch_requests.insert(id);
+            quads.push_back(id);
+        }
+        stats["n_quads_prefetching"] = unsigned(m_prefetch_requests.size());
+    }
     emit stats_ready(m_name, stats);
     emit quads_requested(std::move(quads));
 }
 
+void Scheduler::load_from_disk_cache(std::vector<tile::Id>* missing_quads)
+{
+    if (m_name == "unnamed" || m_name.isEmpty())
+        return;
+    const auto now = nucleus::utils::time_since_epoch();
+    if (now - m_last_disk_cache_probe < m.disk_cache_probe_interval)
+        return;
+    m_last_disk_cache_probe = now;
+    std::vector<tile::Id> not_in_ram;
+    for (const auto& id : *missing_quads) {
+        if (!m_ram_cache.contains(id))
+            not_in_ram.push_back(id);
+    }
+    if (not_in_ram.empty())
+        return;
+    const auto loaded = m_ram_cache.load_from_disk(disk_cache_path(), not_in_ram);
+    if (!loaded.has_value()) {
+        qDebug() << QString("Loading quads from the disk cache failed: %1").arg(loaded.error());
+        return;
+    }
+    if (loaded->empty())
+        return;
+    const std::unordered_set<tile::Id, tile::Id::Hasher> loaded_set(loaded->cbegin(), loaded->cend());
+    std::erase_if(*missing_quads, [&loaded_set](const tile::Id& id) { return loaded_set.contains(id); });
+    for (const auto& id : *loaded)
+        emit quad_received(id);
+    schedule_purge();
+    schedule_update();
+}
+
+void Scheduler::load_from_offline_store(std::vector<tile::Id>* missing_quads)
+{
+    std::vector<DataQuad> loaded;
+    for (const auto& id : *missing_quads) {
+        if (m_ram_cache.contains(id) || !m_prefetcher->contains(id))
+            continue;
+        auto quad = m_prefetcher->load(id);
+        if (!quad.has_value()) {
+            qDebug() << quad.error();
+            continue;
+        }
+        loaded.push_back(std::move(quad.value()));
+    }
+    std::erase_if(*missing_quads, [this](const tile::Id& id) { return m_ram_cache.contains(id); });
+    for (const auto& quad : loaded)
+        receive_quad(quad);
+}
+
+void Scheduler::prefetch_region(const PrefetchRegion& region)
+{
+    prefetcher()->add(region, m_aabb_decorator, m.max_zoom_level);
+    schedule_update();
+}
+
+void Scheduler::cancel_prefetch(const QString& region_name)
+{
+    if (m_prefetcher)
+        m_prefetcher->cancel(region_name);
+}
+
+tl::expected<void, QString> Scheduler::resume_prefetch()
+{
+    if (!m_prefetcher && !std::filesystem::exists(offline_store_path() / "regions"))
+        return {};
+    const auto r = prefetcher()->resume(m_aabb_decorator, m.max_zoom_level);
+    if (!r.has_value())
+        qDebug() << QString("Resuming offline region downloads failed: %1").arg(r.error());
+    schedule_update();
+    return r;
+}
+
+RegionPrefetcher* Scheduler::prefetcher()
+{
+    if (!m_prefetcher) {
+        m_prefetcher = std::make_unique<RegionPrefetcher>(offline_store_path());
+        connect(m_prefetcher.get(), &RegionPrefetcher::progress_changed, this, &Scheduler::prefetch_progress);
+    }
+    return m_prefetcher.get();
+}
+
+const RegionPrefetcher* Scheduler::region_prefetcher() const { return m_prefetcher.get(); }
+
+std::filesystem::path Scheduler::offline_store_path()
+{
+    const auto base_path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation).toStdString());
+    return base_path / ("offline_tiles_" + m_name.toStdString());
+}
+
 void Scheduler::purge_ram_cache()
 {
     if (m_ram_cache.n_cached_objects() <= unsigned(float(m.ram_quad_limit) * 1.05f)) {
         return;
     }
 
-    const auto should_refine = tile::utils::refineFunctor(m_current_camera, m_aabb_decorator, m.tile_resolution, m.max_zoom_level);
+    const auto should_refine = tile::utils::refineFunctor(m_current_camera, m_aabb_decorator, m.tile_resolution, m.max_zoom_level, m.refine_criterion);
     m_ram_cache.visit([&should_refine](const DataQuad& quad) { return should_refine(quad.id); });
     m_ram_cache.purge(m.ram_quad_limit);
 
@@ -195,7 +312,7 @@ tl::expected<void, QString> Scheduler::persist_tiles()
                                       "Name your scheduler, e.g., by using the scheduler director."));
     }
     const auto start = std::chrono::steady_clock::now();
-    const auto r = m_ram_cache.write_to_disk(disk_cache_path());
+    const auto r = m_ram_cache.write_to_disk(disk_cache_path(), m.ram_quad_limit);
     const auto diff = std::chrono::steady_clock::now() - start;
 
     if (diff > std::chrono::milliseconds(50))
@@ -210,6 +327,8 @@ tl::expected<void, QString> Scheduler::persist_tiles()
     return r;
 }
 
+void Scheduler::relay_stats(const QVariantMap& stats) { emit stats_ready(m_name, stats); }
+
 void Scheduler::schedule_update()
 {
     assert(m.update_timeout < unsigned(std::numeric_limits<int>::max()));
@@ -249,7 +368,7 @@ tl::expected<void, QString> Scheduler::read_disk_cache()
         qDebug() << error;
         return tl::unexpected(error);
     }
-    const auto r = m_ram_cache.read_from_disk(disk_cache_path());
+    const auto r = m_ram_cache.read_from_disk(disk_cache_path(), m.ram_quad_limit);
     if (r.has_value()) {
         QVariantMap stats;
         stats["n_quads_ram"] = m_ram_cache.n_cached_objects();
@@ -264,16 +383,9 @@ tl::expected<void, QString> Scheduler::read_disk_cache()
 
 std::vector<Id> Scheduler::quads_for_current_camera_position() const
 {
-    std::vector<Id> all_inner_nodes;
-    const auto all_leaves = radix::quad_tree::onTheFlyTraverse(Id { 0, { 0, 0 } },
-        tile::utils::refineFunctor(m_current_camera, m_aabb_decorator, m.tile_resolution, m.max_zoom_level),
-        [&all_inner_nodes](const Id& v) {
-            all_inner_nodes.push_back(v);
-            return v.children();
-        });
-
+    const auto refine = tile::utils::refineFunctor(m_current_camera, m_aabb_decorator, m.tile_resolution, m.max_zoom_level, m.refine_criterion);
     // not adding leaves, because they we will be fetching quads, which also fetch their children
-    return all_inner_nodes;
+    return parallel_traverse(Id { 0, { 0, 0 } }, refine).inner_nodes;
 }
 
 const utils::AabbDecoratorPtr& Scheduler::aabb_decorator() const { return m_aabb_decorator; }
@@ -288,6 +400,18 @@ std::vector<Id> Scheduler::missing_quads_for_current_camera() const
     return tiles;
 }
 
+float Scheduler::screen_space_importance(const tile::Id& id) const
+{
+    if (m_prefetch_requests.contains(id))
+        return RequestArbiter::background_importance;
+    if (!m_aabb_decorator)
+        return 1.0f / float(1 + id.zoom_level);
+    const auto aabb = m_aabb_decorator->aabb(id);
+    const auto distance = float(radix::geometry::distance(aabb, m_current_camera.position()));
+    const auto pixel_size = float(aabb.size().x / m.tile_resolution);
+    return m_current_camera.to_screen_space(pixel_size, distance);
+}
+
 std::shared_ptr<nucleus::DataQuerier> Scheduler::dataquerier() const { return m_dataquerier; }
 
 void Scheduler::set_retirement_age_for_tile_cache(unsigned int new_retirement_age_for_tile_cache)
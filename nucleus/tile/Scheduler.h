@@ -20,6 +20,7 @@
 #pragma once
 
 #include <memory>
+#include <unordered_set>
 
 #include <QNetworkInformation>
 #include <QObject>
@@ -35,6 +36,8 @@ class DataQuerier;
 }
 
 namespace nucleus::tile {
+class RegionPrefetcher;
+struct PrefetchRegion;
 namespace utils {
     class AabbDecorator;
     using AabbDecoratorPtr = std::shared_ptr<AabbDecorator>;
@@ -56,6 +59,9 @@ public:
         unsigned update_timeout = 100;
         unsigned purge_timeout = 1000;
         unsigned persist_timeout = 10000;
+        unsigned disk_cache_probe_interval = 1000; // minimum time between looking for quads written by other processes
+        unsigned prefetch_batch_size = 8; // quads of offline regions appended to each request, after those for the camera
+        RefineCriterion refine_criterion = RefineCriterion::ScreenSpaceSize;
     };
 
     explicit Scheduler(const Settings& settings);
@@ -92,15 +98,22 @@ public:
     const utils::AabbDecoratorPtr& aabb_decorator() const;
 
     std::vector<tile::Id> missing_quads_for_current_camera() const;
+    /// approximate size of a pixel of the quad on screen (in screen pixels) for the current camera, used to prioritise requests.
+    [[nodiscard]] float screen_space_importance(const tile::Id& id) const;
 
     [[nodiscard]] const QString& name() const;
     void set_name(const QString& new_name);
 
+    std::filesystem::path offline_store_path();
+    /// nullptr until a region was added or resumed
+    [[nodiscard]] const RegionPrefetcher* region_prefetcher() const;
+
 signals:
     void statistics_updated(Statistics stats);
     void stats_ready(const QString& scheduler_name, const QVariantMap& new_stats);
     void quad_received(const tile::Id& ids);
     void quads_requested(const std::vector<tile::Id>& ids);
+    void prefetch_progress(const QString& region_name, unsigned n_done, unsigned n_total);
 
 public slots:
     void update_camera(const nucleus::camera::Definition& camera);
@@ -110,6 +123,13 @@ public slots:
     void send_quad_requests();
     void purge_ram_cache();
     tl::expected<void, QString> persist_tiles();
+    /// re-emits stats of the loading pipeline (tile service, quad assembler) as stats_ready under the name of this scheduler
+    void relay_stats(const QVariantMap& stats);
+    /// downloads the region at low priority into an offline store next to the disk cache
+    void prefetch_region(const nucleus::tile::PrefetchRegion& region);
+    void cancel_prefetch(const QString& region_name);
+    /// continues downloads of regions added in earlier runs
+    tl::expected<void, QString> resume_prefetch();
 
 protected:
     void schedule_update();
@@ -120,6 +140,12 @@ protected:
     virtual void transform_and_emit(const std::vector<DataQuad>& new_quads, const std::vector<tile::Id>& deleted_quads) = 0;
 
 private:
+    RegionPrefetcher* prefetcher();
+    /// loads missing quads that other processes (sharing the disk cache directory) wrote since we last looked
+    void load_from_disk_cache(std::vector<tile::Id>* missing_quads);
+    /// replaces missing quads with those found in the offline store (only if there is nothing in ram, not even a stale copy)
+    void load_from_offline_store(std::vector<tile::Id>* missing_quads);
+
     QString m_name = "unnamed";
     std::shared_ptr<DataQuerier> m_dataquerier;
     Settings m;
@@ -133,6 +159,9 @@ private:
     utils::AabbDecoratorPtr m_aabb_decorator;
     Cache<DataQuad> m_ram_cache;
     Cache<GpuCacheInfo> m_gpu_cached;
+    std::unique_ptr<RegionPrefetcher> m_prefetcher;
+    std::unordered_set<tile::Id, tile::Id::Hasher> m_prefetch_requests;
+    uint64_t m_last_disk_cache_probe = 0;
 
 };
 }
@@ -17,20 +17,49 @@
  *****************************************************************************/
 
 #include "SchedulerDirector.h"
+#include "RegionPrefetcher.h"
+#include "RequestArbiter.h"
 #include "Scheduler.h"
+#include "SlotLimiter.h"
+#include <nucleus/utils/thread.h>
 
 using namespace nucleus::tile;
 
 SchedulerDirector::SchedulerDirector()
     : QObject {}
+    , m_request_arbiter(std::make_unique<RequestArbiter>(RequestArbiter::Settings {}))
 {
 }
 
+SchedulerDirector::~SchedulerDirector() = default;
+
 bool SchedulerDirector::check_in(QString name, std::shared_ptr<Scheduler> scheduler)
 {
     if (m_schedulers.contains(name))
         return false;
     m_schedulers[name] = scheduler;
     scheduler->set_name(name);
+
+    auto* limiter = scheduler->findChild<SlotLimiter*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!limiter)
+        return true;
+    // the arbiter calls the slot limiters directly, so it has to follow the schedulers into their thread.
+    if (m_request_arbiter->thread() != limiter->thread())
+        m_request_arbiter->moveToThread(limiter->thread());
+    m_request_arbiter->attach(name, limiter, RequestArbiter::default_layer_rank(name), [sch = scheduler.get()](const tile::Id& id) {
+        return sch->screen_space_importance(id);
+    });
     return true;
 }
+
+RequestArbiter* SchedulerDirector::request_arbiter() const { return m_request_arbiter.get(); }
+
+void SchedulerDirector::prefetch_region(const PrefetchRegion& region)
+{
+    visit([&region](Scheduler* sch) { nucleus::utils::thread::async_call(sch, [sch, region]() { sch->prefetch_region(region); }); });
+}
+
+void SchedulerDirector::cancel_prefetch(const QString& region_name)
+{
+    visit([&region_name](Scheduler* sch) { nucleus::utils::thread::async_call(sch, [sch, region_name]() { sch->cancel_prefetch(region_name); }); });
+}
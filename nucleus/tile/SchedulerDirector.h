@@ -24,13 +24,24 @@
 
 namespace nucleus::tile {
 class Scheduler;
+class RequestArbiter;
+struct PrefetchRegion;
 
 class SchedulerDirector : public QObject {
     Q_OBJECT
 public:
     explicit SchedulerDirector();
+    ~SchedulerDirector() override;
+    /// names the scheduler and, if it has a loading pipeline (SlotLimiter child), attaches it to the shared request arbiter.
     bool check_in(QString name, std::shared_ptr<Scheduler> scheduler);
 
+    /// shared slot, rate and bandwidth budget of all checked in schedulers. lives in the thread of the schedulers.
+    [[nodiscard]] RequestArbiter* request_arbiter() const;
+
+    /// makes the region available offline in all layers. progress is reported by Scheduler::prefetch_progress.
+    void prefetch_region(const PrefetchRegion& region);
+    void cancel_prefetch(const QString& region_name);
+
     template <typename Functor> void visit(Functor fun)
     {
         for (const auto& [key, value] : m_schedulers) {
@@ -42,6 +53,7 @@ signals:
 
 private:
     std::unordered_map<QString, std::shared_ptr<Scheduler>> m_schedulers;
+    std::unique_ptr<RequestArbiter> m_request_arbiter;
 };
 
 } // namespace nucleus::tile
@@ -18,6 +18,8 @@
 
 #include "SlotLimiter.h"
 
+#include "RequestArbiter.h"
+
 using namespace nucleus::tile;
 
 SlotLimiter::SlotLimiter(QObject* parent)
@@ -41,9 +43,30 @@ unsigned SlotLimiter::slots_taken() const
     return unsigned(m_in_flight.size());
 }
 
+void SlotLimiter::set_arbiter(RequestArbiter* arbiter, unsigned layer)
+{
+    m_arbiter = arbiter;
+    m_arbiter_layer = layer;
+}
+
+void SlotLimiter::grant(const tile::Id& id)
+{
+    m_in_flight.insert(id);
+    emit quad_requested(id);
+}
+
 void SlotLimiter::request_quads(const std::vector<tile::Id>& ids)
 {
     m_request_queue.clear();
+    if (m_arbiter) {
+        std::vector<tile::Id> not_in_flight;
+        for (const tile::Id& id : ids) {
+            if (!m_in_flight.contains(id))
+                not_in_flight.push_back(id);
+        }
+        m_arbiter->request_quads(m_arbiter_layer, not_in_flight);
+        return;
+    }
     for (const tile::Id& id : ids) {
         if (m_in_flight.contains(id))
             continue;
@@ -58,8 +81,19 @@ void SlotLimiter::request_quads(const std::vector<tile::Id>& ids)
 
 void SlotLimiter::deliver_quad(const DataQuad& tile)
 {
-    m_in_flight.erase(tile.id);
+    const auto was_in_flight = m_in_flight.erase(tile.id) > 0;
     emit quad_delivered(tile);
+    if (m_arbiter) {
+        if (!was_in_flight)
+            return;
+        uint64_t n_bytes = 0;
+        for (unsigned i = 0; i < tile.n_tiles; ++i) {
+            if (tile.tiles[i].data)
+                n_bytes += uint64_t(tile.tiles[i].data->size());
+        }
+        m_arbiter->release(m_arbiter_layer, n_bytes);
+        return;
+    }
     if (m_request_queue.empty())
         return;
 
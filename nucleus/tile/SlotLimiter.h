@@ -20,9 +20,11 @@
 
 #include <unordered_set>
 #include <QObject>
+#include <QPointer>
 #include "types.h"
 
 namespace nucleus::tile {
+class RequestArbiter;
 
 class SlotLimiter : public QObject {
     Q_OBJECT
@@ -30,6 +32,8 @@ class SlotLimiter : public QObject {
     unsigned m_limit = 16;
     std::unordered_set<tile::Id, tile::Id::Hasher> m_in_flight;
     std::vector<tile::Id> m_request_queue;
+    QPointer<RequestArbiter> m_arbiter;
+    unsigned m_arbiter_layer = 0;
 
 public:
     explicit SlotLimiter(QObject* parent = nullptr);
@@ -38,6 +42,10 @@ public:
     [[nodiscard]] unsigned int limit() const;
     unsigned int slots_taken() const;
 
+    /// hands the request queue to a RequestArbiter, which calls grant() once budget is available (set by RequestArbiter::attach).
+    void set_arbiter(RequestArbiter* arbiter, unsigned layer);
+    void grant(const tile::Id& id);
+
 public slots:
     void request_quads(const std::vector<tile::Id>& id);
     void deliver_quad(const DataQuad& tile);
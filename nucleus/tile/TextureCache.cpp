@@ -0,0 +1,276 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include "TextureCache.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <algorithm>
+#include <zpp_bits.h>
+
+namespace nucleus::tile {
+
+namespace {
+    constexpr uint32_t file_version = 1;
+
+    struct FileLevel {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> data;
+    };
+    struct FileTexture {
+        uint32_t version = file_version;
+        uint32_t format = 0;
+        uint64_t source_stamp = 0;
+        std::vector<FileLevel> levels;
+    };
+} // namespace
+
+TextureCache::TextureCache(const Settings& settings)
+    : m_settings(settings)
+{
+    scan_disk();
+}
+
+TextureCache::TexturePtr TextureCache::get(const tile::Id& id, Format format, uint64_t source_stamp)
+{
+    const auto key = Key { id, format };
+    if (const auto it = m_ram.find(key); it != m_ram.end()) {
+        if (it->second.source_stamp == source_stamp) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru_position);
+            ++m_statistics.n_ram_hits;
+            return it->second.texture;
+        }
+        // source data changed, drop the stale texture
+        m_statistics.n_ram_bytes -= it->second.n_bytes;
+        m_lru.erase(it->second.lru_position);
+        m_ram.erase(it);
+    }
+
+    const auto disk_it = m_disk.find(file_path(key).filename().string());
+    if (disk_it != m_disk.end()) {
+        const auto file = read_file(key);
+        if (file.has_value() && file->first == source_stamp) {
+            disk_it->second.last_used = ++m_disk_clock;
+            ++m_statistics.n_disk_hits;
+            insert_into_ram(key, source_stamp, file->second);
+            return file->second;
+        }
+        if (!file.has_value())
+            qDebug() << "TextureCache: dropping unreadable file:" << file.error();
+        // stale or unreadable
+        std::error_code ec;
+        std::filesystem::remove(file_path(key), ec);
+        m_statistics.n_disk_bytes -= disk_it->second.n_bytes;
+        m_disk.erase(disk_it);
+    }
+    ++m_statistics.n_misses;
+    return {};
+}
+
+void TextureCache::insert(const tile::Id& id, Format format, uint64_t source_stamp, const TexturePtr& texture)
+{
+    assert(texture);
+    const auto key = Key { id, format };
+    insert_into_ram(key, source_stamp, texture);
+    if (m_settings.disk_path.empty())
+        return;
+
+    const auto written = write_file(key, source_stamp, *texture);
+    if (!written.has_value()) {
+        qDebug() << "TextureCache: writing to disk failed:" << written.error();
+        return;
+    }
+    auto& disk_entry = m_disk[file_path(key).filename().string()];
+    m_statistics.n_disk_bytes -= disk_entry.n_bytes;
+    disk_entry = { written.value(), ++m_disk_clock };
+    m_statistics.n_disk_bytes += disk_entry.n_bytes;
+    evict_disk();
+}
+
+void TextureCache::set_settings(const Settings& settings)
+{
+    const auto disk_path_changed = settings.disk_path != m_settings.disk_path;
+    m_settings = settings;
+    if (disk_path_changed)
+        scan_disk();
+    evict_ram();
+    evict_disk();
+}
+
+const TextureCache::Settings& TextureCache::settings() const { return m_settings; }
+
+const TextureCache::Statistics& TextureCache::statistics() const { return m_statistics; }
+
+size_t TextureCache::n_ram_entries() const { return m_ram.size(); }
+
+uint64_t TextureCache::source_stamp(const DataQuad& quad)
+{
+    uint64_t stamp = 0;
+    for (unsigned i = 0; i < quad.n_tiles; ++i)
+        stamp = std::max(stamp, quad.tiles[i].network_info.timestamp);
+    return stamp;
+}
+
+size_t TextureCache::n_bytes(const nucleus::utils::MipmappedColourTexture& texture)
+{
+    size_t n = 0;
+    for (const auto& level : texture)
+        n += level.n_bytes();
+    return n;
+}
+
+void TextureCache::insert_into_ram(const Key& key, uint64_t source_stamp, const TexturePtr& texture)
+{
+    if (const auto it = m_ram.find(key); it != m_ram.end()) {
+        m_statistics.n_ram_bytes -= it->second.n_bytes;
+        m_lru.erase(it->second.lru_position);
+        m_ram.erase(it);
+    }
+    m_lru.push_front(key);
+    const auto size = n_bytes(*texture);
+    m_ram[key] = Entry { texture, source_stamp, size, m_lru.begin() };
+    m_statistics.n_ram_bytes += size;
+    evict_ram();
+}
+
+void TextureCache::evict_ram()
+{
+    // the most recent entry stays, even if it alone exceeds the budget
+    while (m_statistics.n_ram_bytes > m_settings.ram_budget_bytes && m_lru.size() > 1) {
+        const auto it = m_ram.find(m_lru.back());
+        assert(it != m_ram.end());
+        m_statistics.n_ram_bytes -= it->second.n_bytes;
+        m_ram.erase(it);
+        m_lru.pop_back();
+    }
+}
+
+void TextureCache::scan_disk()
+{
+    m_disk.clear();
+    m_statistics.n_disk_bytes = 0;
+    if (m_settings.disk_path.empty())
+        return;
+    std::error_code ec;
+    std::vector<std::pair<std::filesystem::file_time_type, std::string>> by_age;
+    for (const auto& file : std::filesystem::directory_iterator(m_settings.disk_path, ec)) {
+        if (!file.is_regular_file(ec) || file.path().extension() != ".alp_tex")
+            continue;
+        const auto size = size_t(file.file_size(ec));
+        m_disk[file.path().filename().string()] = { size, 0 };
+        m_statistics.n_disk_bytes += size;
+        by_age.emplace_back(file.last_write_time(ec), file.path().filename().string());
+    }
+    std::sort(by_age.begin(), by_age.end());
+    for (const auto& [time, name] : by_age)
+        m_disk[name].last_used = ++m_disk_clock;
+    evict_disk();
+}
+
+void TextureCache::evict_disk()
+{
+    if (m_statistics.n_disk_bytes <= m_settings.disk_budget_bytes)
+        return;
+    // evict down to 90% of the budget, so that the sort below isn't needed on every insert
+    std::vector<std::pair<uint64_t, std::string>> by_use;
+    by_use.reserve(m_disk.size());
+    for (const auto& [name, entry] : m_disk)
+        by_use.emplace_back(entry.last_used, name);
+    std::sort(by_use.begin(), by_use.end());
+    const auto target = m_settings.disk_budget_bytes / 10u * 9u;
+    for (const auto& [last_used, name] : by_use) {
+        if (m_statistics.n_disk_bytes <= target)
+            break;
+        std::error_code ec;
+        std::filesystem::remove(m_settings.disk_path / name, ec);
+        m_statistics.n_disk_bytes -= m_disk[name].n_bytes;
+        m_disk.erase(name);
+    }
+}
+
+std::filesystem::path TextureCache::file_path(const Key& key) const
+{
+    return m_settings.disk_path / QString("%1_%2_%3_%4.alp_tex").arg(int(key.format)).arg(key.id.zoom_level).arg(key.id.coords.x).arg(key.id.coords.y).toStdString();
+}
+
+tl::expected<std::pair<uint64_t, TextureCache::TexturePtr>, QString> TextureCache::read_file(const Key& key) const
+{
+    QFile file(file_path(key));
+    if (!file.open(QIODeviceBase::ReadOnly))
+        return tl::unexpected(QString("Couldn't open file '%1' for reading!").arg(file.fileName()));
+    const auto bytes = file.readAll();
+    zpp::bits::in in(bytes);
+    FileTexture file_texture;
+    if (failure(in(file_texture)) || file_texture.version != file_version || file_texture.format != uint32_t(key.format))
+        return tl::unexpected(QString("Texture file '%1' is corrupt or has an incompatible version.").arg(file.fileName()));
+
+    auto texture = std::make_shared<nucleus::utils::MipmappedColourTexture>();
+    texture->reserve(file_texture.levels.size());
+    for (auto& level : file_texture.levels) {
+        const auto size = glm::uvec2(level.width, level.height);
+        if (key.format == Format::Uncompressed_RGBA) {
+            auto raster = nucleus::utils::pooled_raster<glm::u8vec4>(size);
+            if (level.data.size() != raster.size_in_bytes())
+                return tl::unexpected(QString("Texture file '%1' is corrupt.").arg(file.fileName()));
+            std::copy(level.data.begin(), level.data.end(), raster.bytes());
+            texture->emplace_back(std::move(raster), key.format);
+        } else {
+            texture->emplace_back(level.data, size, key.format); // copied into pooled storage
+        }
+    }
+    return std::make_pair(file_texture.source_stamp, TexturePtr(std::move(texture)));
+}
+
+tl::expected<size_t, QString> TextureCache::write_file(const Key& key, uint64_t source_stamp, const nucleus::utils::MipmappedColourTexture& texture)
+{
+    FileTexture file_texture;
+    file_texture.format = uint32_t(key.format);
+    file_texture.source_stamp = source_stamp;
+    for (const auto& level : texture)
+        file_texture.levels.push_back({ level.width(), level.height(), { level.data(), level.data() + level.n_bytes() } });
+
+    std::vector<char> bytes;
+    zpp::bits::out out(bytes);
+    if (failure(out(file_texture)))
+        return tl::unexpected(QString("Couldn't serialise texture %1/%2/%3.").arg(key.id.zoom_level).arg(key.id.coords.x).arg(key.id.coords.y));
+
+    std::error_code ec;
+    std::filesystem::create_directories(m_settings.disk_path, ec);
+    if (ec)
+        return tl::unexpected(QString("Couldn't create directory '%1': %2").arg(QString::fromStdString(m_settings.disk_path.string()), QString::fromStdString(ec.message())));
+    // write to a temporary file first, readers (also in other processes) must never see a half written texture.
+    const auto path = file_path(key);
+    auto temp_path = path;
+    temp_path += QString(".%1.part").arg(QCoreApplication::applicationPid()).toStdString();
+    {
+        QFile file(temp_path);
+        if (!file.open(QIODeviceBase::WriteOnly))
+            return tl::unexpected(QString("Couldn't open file '%1' for writing!").arg(file.fileName()));
+        if (file.write(bytes.data(), qint64(bytes.size())) != qint64(bytes.size()))
+            return tl::unexpected(QString("Couldn't write file '%1'!").arg(file.fileName()));
+    }
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec)
+        return tl::unexpected(QString::fromStdString(ec.message()));
+    return bytes.size();
+}
+
+} // namespace nucleus::tile
@@ -0,0 +1,107 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#pragma once
+
+#include <QString>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <tl/expected.hpp>
+#include <unordered_map>
+
+#include "nucleus/utils/ColourTexture.h"
+#include "types.h"
+
+namespace nucleus::tile {
+
+/// Second level cache for finished (stitched, mipmapped and compressed) ortho quad textures, so that quads returning
+/// to the gpu don't need to be decoded and compressed again. Keyed by quad id and compression format. Entries carry a
+/// stamp of the source data (see source_stamp()), a mismatch counts as a miss. Least recently used entries are evicted
+/// once the ram budget is exceeded. Optionally, textures are also written to a directory with its own byte budget.
+/// Not thread safe, owned by the TextureScheduler.
+class TextureCache {
+public:
+    using Format = nucleus::utils::ColourTexture::Format;
+    using TexturePtr = std::shared_ptr<const nucleus::utils::MipmappedColourTexture>;
+    struct Settings {
+        size_t ram_budget_bytes = 128u * 1024u * 1024u;
+        size_t disk_budget_bytes = 1024u * 1024u * 1024u;
+        std::filesystem::path disk_path = {}; // empty: ram only
+    };
+    struct Statistics {
+        unsigned n_ram_hits = 0;
+        unsigned n_disk_hits = 0;
+        unsigned n_misses = 0;
+        size_t n_ram_bytes = 0;
+        size_t n_disk_bytes = 0;
+    };
+
+    explicit TextureCache(const Settings& settings);
+
+    /// nullptr if there is no texture for id and format, or if it was built from different source data.
+    [[nodiscard]] TexturePtr get(const tile::Id& id, Format format, uint64_t source_stamp);
+    void insert(const tile::Id& id, Format format, uint64_t source_stamp, const TexturePtr& texture);
+
+    void set_settings(const Settings& settings);
+    [[nodiscard]] const Settings& settings() const;
+    [[nodiscard]] const Statistics& statistics() const;
+    [[nodiscard]] size_t n_ram_entries() const;
+
+    /// identifies the data a texture was made from: the newest network timestamp of the quad's tiles.
+    [[nodiscard]] static uint64_t source_stamp(const DataQuad& quad);
+    [[nodiscard]] static size_t n_bytes(const nucleus::utils::MipmappedColourTexture& texture);
+
+private:
+    struct Key {
+        tile::Id id;
+        Format format;
+        bool operator==(const Key&) const = default;
+    };
+    struct KeyHasher {
+        size_t operator()(const Key& key) const { return tile::Id::Hasher()(key.id) * 31u + size_t(key.format); }
+    };
+    struct Entry {
+        TexturePtr texture;
+        uint64_t source_stamp = 0;
+        size_t n_bytes = 0;
+        std::list<Key>::iterator lru_position;
+    };
+    struct DiskEntry {
+        size_t n_bytes = 0;
+        uint64_t last_used = 0;
+    };
+
+    void insert_into_ram(const Key& key, uint64_t source_stamp, const TexturePtr& texture);
+    void evict_ram();
+    void scan_disk();
+    void evict_disk();
+    [[nodiscard]] std::filesystem::path file_path(const Key& key) const;
+    [[nodiscard]] tl::expected<std::pair<uint64_t, TexturePtr>, QString> read_file(const Key& key) const;
+    tl::expected<size_t, QString> write_file(const Key& key, uint64_t source_stamp, const nucleus::utils::MipmappedColourTexture& texture);
+
+    Settings m_settings;
+    Statistics m_statistics;
+    std::list<Key> m_lru; // front: most recently used
+    std::unordered_map<Key, Entry, KeyHasher> m_ram;
+    std::unordered_map<std::string, DiskEntry> m_disk; // by file name
+    uint64_t m_disk_clock = 0;
+};
+
+} // namespace nucleus::tile
@@ -19,6 +19,10 @@
 #include "TextureScheduler.h"
 #include "conversion.h"
 #include <QDebug>
+#include <QStandardPaths>
+#include <QVariantMap>
+#include <algorithm>
+#include <nucleus/utils/BufferPool.h>
 #include <nucleus/utils/image_loader.h>
 
 namespace nucleus::tile {
@@ -26,6 +30,7 @@ namespace nucleus::tile {
 TextureScheduler::TextureScheduler(const Scheduler::Settings& settings)
     : nucleus::tile::Scheduler(settings)
     , m_default_raster(glm::uvec2(settings.tile_resolution), { 255, 255, 255, 255 })
+    , m_texture_cache(TextureCache::Settings {})
 {
 }
 
@@ -34,44 +39,91 @@ TextureScheduler::~TextureScheduler() = default;
 void TextureScheduler::transform_and_emit(const std::vector<tile::DataQuad>& new_quads, const std::vector<tile::Id>& deleted_quads)
 {
     std::vector<GpuTextureTile> new_gpu_tiles;
-    new_gpu_tiles.reserve(new_gpu_tiles.size() * 4);
+    new_gpu_tiles.reserve(new_quads.size());
+    for (const auto& quad : new_quads)
+        new_gpu_tiles.push_back(to_gpu_tile(quad));
 
-    for (const auto& quad : new_quads) {
-        GpuTextureTile gpu_tile;
-        gpu_tile.id = quad.id;
+    // we are merging the tiles. so deleted quads become deleted tiles.
+    emit gpu_tiles_updated(deleted_quads, new_gpu_tiles);
+
+    // the pool is process wide, so its stats go under their own name (the same keys, no matter which scheduler reports).
+    const auto pool = nucleus::utils::BufferPool::instance().statistics();
+    QVariantMap stats;
+    stats["n_acquired"] = qulonglong(pool.n_acquired);
+    stats["n_allocated"] = qulonglong(pool.n_allocated);
+    stats["n_freed"] = qulonglong(pool.n_freed);
+    stats["pooled_mb"] = double(pool.n_pooled_bytes) / (1024 * 1024);
+    stats["live_mb"] = double(pool.n_live_bytes) / (1024 * 1024);
+    emit stats_ready("buffer_pool", stats);
+}
+
+GpuTextureTile TextureScheduler::to_gpu_tile(const tile::DataQuad& quad)
+{
+    GpuTextureTile gpu_tile;
+    gpu_tile.id = quad.id;
+    const auto has_no_data = [](const tile::Data& tile) { return !tile.data || tile.data->isEmpty(); };
+    if (std::all_of(quad.tiles.cbegin(), quad.tiles.cend(), has_no_data)) {
+        // nothing to decode or compress, all empty quads share one texture
+        if (!m_empty_texture) {
+            Raster<glm::u8vec4> white(m_default_raster.size() * 2u, m_default_raster.pixel({ 0, 0 }));
+            m_empty_texture = std::make_shared<nucleus::utils::MipmappedColourTexture>(generate_mipmapped_colour_texture(std::move(white), m_compression_algorithm));
+        }
+        gpu_tile.texture = m_empty_texture;
+        gpu_tile.empty = true;
+        return gpu_tile;
+    }
+    const auto source_stamp = TextureCache::source_stamp(quad);
+    gpu_tile.texture = m_texture_cache.get(quad.id, m_compression_algorithm, source_stamp);
+    if (!gpu_tile.texture) {
         auto ortho_raster = to_raster(quad, m_default_raster);
-        gpu_tile.texture = std::make_shared<nucleus::utils::MipmappedColourTexture>(generate_mipmapped_colour_texture(ortho_raster, m_compression_algorithm));
-        new_gpu_tiles.push_back(gpu_tile);
+        gpu_tile.texture = std::make_shared<nucleus::utils::MipmappedColourTexture>(generate_mipmapped_colour_texture(std::move(ortho_raster), m_compression_algorithm));
+        m_texture_cache.insert(quad.id, m_compression_algorithm, source_stamp, gpu_tile.texture);
     }
+    return gpu_tile;
+}
 
-    // we are merging the tiles. so deleted quads become deleted tiles.
-    emit gpu_tiles_updated(deleted_quads, new_gpu_tiles);
+TextureCache& TextureScheduler::texture_cache() { return m_texture_cache; }
+
+std::filesystem::path TextureScheduler::texture_cache_path()
+{
+    const auto base_path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation).toStdString());
+    return base_path / ("texture_cache_" + name().toStdString());
 }
 
-void TextureScheduler::set_texture_compression_algorithm(nucleus::utils::ColourTexture::Format compression_algorithm) { m_compression_algorithm = compression_algorithm; }
+void TextureScheduler::set_texture_compression_algorithm(nucleus::utils::ColourTexture::Format compression_algorithm)
+{
+    m_compression_algorithm = compression_algorithm;
+    m_empty_texture.reset();
+}
 
 Raster<glm::u8vec4> TextureScheduler::to_raster(const tile::DataQuad& quad, const Raster<glm::u8vec4>& default_raster)
 {
     assert(quad.n_tiles == 4);
 
-    std::array<Raster<glm::u8vec4>, 4> quad_rasters;
-    std::array<tile::Id, 4> quad_ids;
+    // Each tile is decoded into its quadrant of the final raster, no intermediate rasters are allocated.
+    const auto tile_size = default_raster.size();
+    auto ortho_raster = nucleus::utils::pooled_raster<glm::u8vec4>(tile_size * 2u); // every quadrant is written below
     for (const auto& tile : quad.tiles) {
-        const auto quad_index = unsigned(quad_position(tile.id));
-        quad_ids[quad_index] = tile.id;
-        if (tile.data->size()) {
-            // Ortho image is available
-            const auto ortho_raster = nucleus::utils::image_loader::rgba8(*tile.data.get()).value_or(default_raster);
-            quad_rasters[quad_index] = std::move(ortho_raster);
-        } else {
-            // Ortho image is not available (use white default tile)
-            quad_rasters[quad_index] = default_raster;
+        glm::uvec2 offset = { 0, 0 };
+        switch (quad_position(tile.id)) {
+        case tile::QuadPosition::TopLeft:
+            break;
+        case tile::QuadPosition::TopRight:
+            offset = { tile_size.x, 0 };
+            break;
+        case tile::QuadPosition::BottomLeft:
+            offset = { 0, tile_size.y };
+            break;
+        case tile::QuadPosition::BottomRight:
+            offset = tile_size;
+            break;
         }
+        const auto quadrant = ortho_raster.view().sub_view(offset, tile_size);
+        // Ortho image is not available or broken (use white default tile)
+        if (!tile.data->size() || !nucleus::utils::image_loader::rgba8_into(*tile.data, quadrant))
+            nucleus::copy<glm::u8vec4>(default_raster.view(), quadrant);
     }
 
-    auto ortho_raster = nucleus::concatenate_horizontally(quad_rasters[unsigned(tile::QuadPosition::TopLeft)], quad_rasters[unsigned(tile::QuadPosition::TopRight)]);
-    ortho_raster.append_vertically(nucleus::concatenate_horizontally(quad_rasters[unsigned(tile::QuadPosition::BottomLeft)], quad_rasters[unsigned(tile::QuadPosition::BottomRight)]));
-
     return ortho_raster;
 }
 
@@ -19,6 +19,7 @@
 #pragma once
 
 #include "Scheduler.h"
+#include "TextureCache.h"
 #include "types.h"
 
 namespace nucleus::tile {
@@ -32,6 +33,11 @@ public:
     void set_texture_compression_algorithm(nucleus::utils::ColourTexture::Format compression_algorithm);
     static Raster<glm::u8vec4> to_raster(const tile::DataQuad& data_quad, const Raster<glm::u8vec4>& default_raster);
 
+    /// finished textures of quads that were on the gpu before. consulted before decoding and compressing a quad.
+    [[nodiscard]] TextureCache& texture_cache();
+    /// AppDataLocation/texture_cache_<name>, use it as TextureCache::Settings::disk_path to keep textures across restarts
+    std::filesystem::path texture_cache_path();
+
 signals:
     void gpu_tiles_updated(const std::vector<tile::Id>& deleted_tiles, const std::vector<GpuTextureTile>& new_tiles);
 
@@ -39,8 +45,12 @@ protected:
     void transform_and_emit(const std::vector<tile::DataQuad>& new_quads, const std::vector<tile::Id>& deleted_quads) override;
 
 private:
+    [[nodiscard]] GpuTextureTile to_gpu_tile(const tile::DataQuad& quad);
+
     nucleus::utils::ColourTexture::Format m_compression_algorithm = nucleus::utils::ColourTexture::Format::Uncompressed_RGBA;
     Raster<glm::u8vec4> m_default_raster;
+    std::shared_ptr<const nucleus::utils::MipmappedColourTexture> m_empty_texture; // for quads without any data
+    TextureCache m_texture_cache;
 };
 
 } // namespace nucleus::tile
@@ -20,9 +20,11 @@
 #include "TileLoadService.h"
 
 #include <QDebug>
+#include <QJsonDocument>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QtVersionChecks>
+#include <chrono>
 #include <nucleus/srs.h>
 #include <nucleus/utils/lang.h>
 
@@ -39,30 +41,49 @@ TileLoadService::TileLoadService(const QString& base_url, UrlPattern url_pattern
 
 TileLoadService::~TileLoadService() = default;
 
-void TileLoadService::load(const tile::Id& tile_id) const
+void TileLoadService::load(const tile::Id& tile_id)
 {
-    QNetworkRequest request(QUrl(build_tile_url(tile_id)));
+    const auto url = QUrl(build_tile_url(tile_id));
+    QNetworkRequest request(url);
     request.setTransferTimeout(int(m_transfer_timeout));
     request.setAttribute(QNetworkRequest::CacheLoadControlAttribute, QNetworkRequest::PreferCache);
 #if QT_VERSION >= QT_VERSION_CHECK(6, 5, 0)
     request.setAttribute(QNetworkRequest::UseCredentialsAttribute, false);
 #endif
 
+    using Clock = std::chrono::steady_clock;
+    const auto host = url.host();
+    const auto start = Clock::now();
+    auto first_byte = std::make_shared<Clock::time_point>(); // stays at epoch until the headers arrive
+    m_statistics.request_started(host);
+
     QNetworkReply* reply = m_network_manager->get(request);
-    connect(reply, &QNetworkReply::finished, [tile_id, reply, this]() {
+    connect(reply, &QNetworkReply::metaDataChanged, this, [first_byte]() {
+        if (*first_byte == Clock::time_point {})
+            *first_byte = Clock::now();
+    });
+    connect(reply, &QNetworkReply::finished, [tile_id, reply, host, start, first_byte, this]() {
         const auto error = reply->error();
         const auto timestamp = utils::time_since_epoch();
+        const auto to_msecs = [](const Clock::duration& d) { return uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(d).count()); };
+        const auto latency = to_msecs(Clock::now() - start);
+        const auto time_to_first_byte = (*first_byte == Clock::time_point {}) ? latency : to_msecs(*first_byte - start);
+
+        auto status = NetworkInfo::Status::Good;
+        auto tile = std::make_shared<QByteArray>();
         if (error == QNetworkReply::NoError) {
-            auto tile = std::make_shared<QByteArray>(reply->readAll());
-            emit load_finished({tile_id, {NetworkInfo::Status::Good, timestamp}, tile});
+            *tile = reply->readAll();
         } else if (error == QNetworkReply::ContentNotFoundError) {
-            auto tile = std::make_shared<QByteArray>();
-            emit load_finished({tile_id, {NetworkInfo::Status::NotFound, timestamp}, tile});
+            status = NetworkInfo::Status::NotFound;
         } else {
             //            qDebug() << reply->url() << ": " << error;
-            auto tile = std::make_shared<QByteArray>();
-            emit load_finished({tile_id, {NetworkInfo::Status::NetworkError, timestamp}, tile});
+            status = NetworkInfo::Status::NetworkError;
         }
+        const auto from_cache = reply->attribute(QNetworkRequest::SourceIsFromCacheAttribute).toBool();
+        m_statistics.request_finished(host, { status, latency, time_to_first_byte, uint64_t(tile->size()), from_cache });
+
+        emit load_finished({ tile_id, { status, timestamp }, tile });
+        emit_stats_if_due();
         reply->deleteLater();
     });
 }
@@ -110,3 +131,18 @@ void TileLoadService::set_transfer_timeout(unsigned int new_transfer_timeout)
     assert(new_transfer_timeout < unsigned(std::numeric_limits<int>::max()));
     m_transfer_timeout = new_transfer_timeout;
 }
+
+const network::Statistics& TileLoadService::statistics() const { return m_statistics; }
+
+QByteArray TileLoadService::statistics_json() const { return QJsonDocument(m_statistics.to_json()).toJson(QJsonDocument::Indented); }
+
+void TileLoadService::set_stats_interval(unsigned int new_stats_interval) { m_stats_interval = new_stats_interval; }
+
+void TileLoadService::emit_stats_if_due()
+{
+    const auto now = utils::time_since_epoch();
+    if (now - m_last_stats_emit < m_stats_interval)
+        return;
+    m_last_stats_emit = now;
+    emit stats_ready(m_statistics.to_variant_map());
+}
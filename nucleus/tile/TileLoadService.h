@@ -20,6 +20,7 @@
 
 #include <memory>
 #include <QObject>
+#include "NetworkStatistics.h"
 #include "constants.h"
 #include "types.h"
 
@@ -45,14 +46,26 @@ public:
     [[nodiscard]] unsigned int transfer_timeout() const;
     void set_transfer_timeout(unsigned int new_transfer_timeout);
 
+    [[nodiscard]] const network::Statistics& statistics() const;
+    /// machine readable dump of statistics(), indented json.
+    [[nodiscard]] QByteArray statistics_json() const;
+    /// stats_ready is emitted at most once per interval (on request completion). 0 emits on every completion.
+    void set_stats_interval(unsigned int new_stats_interval);
+
 public slots:
-    void load(const tile::Id& tile_id) const;
+    void load(const tile::Id& tile_id);
 
 signals:
     void load_finished(Data tile) const;
+    void stats_ready(const QVariantMap& stats) const;
 
 private:
+    void emit_stats_if_due();
+
     unsigned m_transfer_timeout = tile::constants::default_network_timeout;
+    unsigned m_stats_interval = 1000;
+    uint64_t m_last_stats_emit = 0;
+    network::Statistics m_statistics;
     std::shared_ptr<QNetworkAccessManager> m_network_manager;
     QString m_base_url;
     UrlPattern m_url_pattern;
@@ -24,13 +24,14 @@
 #include "radix/height_encoding.h"
 
 #include "nucleus/utils/image_loader.h"
+#include <optional>
 
 namespace nucleus::tile::cache_queries {
 
-inline tl::expected<float, QString> query_altitude(MemoryCache* cache, const glm::dvec2& lat_long)
+/// finest tile with good data in the cache, that contains world_space
+inline std::optional<Data> finest_tile(MemoryCache* cache, const glm::dvec2& world_space)
 {
-    const auto world_space = srs::lat_long_to_world(lat_long);
-    nucleus::tile::Data selected_tile;
+    std::optional<Data> selected_tile;
     cache->visit([&](const nucleus::tile::DataQuad& tile) {
         for (const auto& t : tile.tiles) {
             if (srs::tile_bounds(t.id).contains(world_space) && t.network_info.status == NetworkInfo::Status::Good) {
@@ -40,21 +41,40 @@ inline tl::expected<float, QString> query_altitude(MemoryCache* cache, const glm
         }
         return false;
     });
-    if (!selected_tile.data)
-        return tl::unexpected(QString("Couldn't find altitude for %1/%2").arg(lat_long.x).arg(lat_long.y));
-    assert(selected_tile.data->size());
+    if (!selected_tile || !selected_tile->data)
+        return {};
+    assert(selected_tile->data->size());
+    return selected_tile;
+}
+
+/// bilinear sample of a decoded height tile (see image_loader::height_u16).
+/// the outermost samples lie on the tile border, like the vertices of the rendered mesh.
+inline float sample_altitude(const Raster<uint16_t>& height_tile, const tile::Id& id, const glm::dvec2& world_space)
+{
+    const auto bounds = srs::tile_bounds(id);
+    const auto uv = glm::clamp((world_space - bounds.min) / bounds.size(), 0.0, 1.0);
+    const auto last = height_tile.size() - 1u;
+    const auto p = glm::dvec2(uv.x, 1 - uv.y) * glm::dvec2(last);
+    const auto p0 = glm::min(glm::uvec2(p), last);
+    const auto p1 = glm::min(p0 + 1u, last);
+    const auto f = glm::vec2(p - glm::dvec2(p0));
+    const auto altitude = [&](unsigned x, unsigned y) {
+        const auto v = height_tile.pixel({ x, y });
+        return radix::height_encoding::to_float(glm::u8vec3(v >> 8, v & 255, 0));
+    };
+    return glm::mix(glm::mix(altitude(p0.x, p0.y), altitude(p1.x, p0.y), f.x), glm::mix(altitude(p0.x, p1.y), altitude(p1.x, p1.y), f.x), f.y);
+}
 
-    const auto bounds = srs::tile_bounds(selected_tile.id);
-    const auto uv = (world_space - bounds.min) / bounds.size();
+/// decodes the tile for every query, DataQuerier keeps the decoded tiles.
+inline tl::expected<float, QString> query_altitude(MemoryCache* cache, const glm::dvec2& lat_long)
+{
+    const auto world_space = srs::lat_long_to_world(lat_long);
+    const auto selected_tile = finest_tile(cache, world_space);
+    if (!selected_tile)
+        return tl::unexpected(QString("Couldn't find altitude for %1/%2").arg(lat_long.x).arg(lat_long.y));
 
-    if (selected_tile.data && selected_tile.data->size()) {
-        if (const auto height_tile_expected = nucleus::utils::image_loader::rgba8(*selected_tile.data)) {
-            const auto& height_tile = height_tile_expected.value();
-            const auto p = glm::uvec2(uint32_t(uv.x * height_tile.width()), uint32_t((1 - uv.y) * height_tile.height()));
-            const auto px = height_tile.pixel(p);
-            return radix::height_encoding::to_float(glm::u8vec3(px));
-        }
-    }
+    if (const auto height_tile = nucleus::utils::image_loader::height_u16(*selected_tile->data))
+        return sample_altitude(height_tile.value(), selected_tile->id, world_space);
     assert(false);
     return tl::unexpected(QString("Couldn't find altitude for %1/%2").arg(lat_long.x).arg(lat_long.y));
 }
@@ -19,14 +19,14 @@
 
 #include "conversion.h"
 
+#include "nucleus/utils/bit_coding.h"
+
 namespace nucleus::tile::conversion {
 
 Raster<uint16_t> to_u16raster(const Raster<glm::u8vec4>& raster)
 {
     Raster<uint16_t> retval(raster.size());
-    std::transform(raster.begin(), raster.end(), retval.begin(), [](const glm::u8vec4& rgba) {
-        return uint16_t(rgba.x) << 8 | uint16_t(rgba.y);
-    });
+    nucleus::utils::bit_coding::pack_red_green(raster.bytes(), 4, raster.buffer_length(), retval.data());
     return retval;
 }
 
@@ -17,15 +17,18 @@
  *****************************************************************************/
 
 #include "drawing.h"
-#include <radix/quad_tree.h>
-#include <unordered_set>
+#include "FrustumCuller.h"
+#include "traversal.h"
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
 
 namespace nucleus::tile::drawing {
 
 std::vector<tile::Id> generate_list(const camera::Definition& camera, utils::AabbDecoratorPtr aabb_decorator, unsigned int max_zoom_level)
 {
     const auto tile_refine_functor = tile::utils::refineFunctor(camera, aabb_decorator, 256, max_zoom_level);
-    return radix::quad_tree::onTheFlyTraverse(tile::Id { 0, { 0, 0 } }, tile_refine_functor, [](const tile::Id& v) { return v.children(); });
+    return parallel_traverse(tile::Id { 0, { 0, 0 } }, tile_refine_functor).leaves;
 }
 
 std::vector<TileBounds> compute_bounds(const std::vector<Id>& tiles, utils::AabbDecoratorPtr aabb_decorator)
@@ -38,57 +41,108 @@ std::vector<TileBounds> compute_bounds(const std::vector<Id>& tiles, utils::Aabb
     return bounded_tiles;
 }
 
-std::vector<tile::Id> limit(std::vector<tile::Id> tiles, uint max_n_tiles)
-{
-    if (tiles.size() < max_n_tiles)
-        return tiles;
-
-    std::sort(tiles.begin(), tiles.end(), [&](const tile::Id& a, const tile::Id& b) { return a.zoom_level > b.zoom_level; });
-    std::unordered_set<tile::Id, tile::Id::Hasher> id_set;
-    id_set.reserve(tiles.size());
-    for (const auto t : tiles) {
-        id_set.insert(t);
-    }
-    const auto all_in_set = [&](const std::array<Id, 4>& siblings) {
-        for (const auto& s : siblings) {
-            if (!id_set.contains(s))
-                return false;
-        }
-        return true;
-    };
-    const auto remove = [&](const std::array<Id, 4>& siblings) {
-        for (const auto& s : siblings) {
-            const auto pos = std::find(tiles.crbegin(), tiles.crend(), s);
-            tiles.erase(std::next(pos).base());
-            id_set.erase(s);
-        }
-        return true;
-    };
+namespace {
+    // merges complete sibling groups (all 4 children are in the list) into their parent, lowest priority first, until the list is short enough.
+    // merging can complete the group of the parent, which is then queued as well. O(n log n), tiles must be unique.
+    template <class PriorityFunction>
+    std::vector<tile::Id> collapse(std::vector<tile::Id> tiles, uint max_n_tiles, const PriorityFunction& priority_of)
+    {
+        if (tiles.size() <= max_n_tiles)
+            return tiles;
+
+        struct Candidate {
+            float priority;
+            uint32_t group;
+        };
+        // min heap on priority, ties go to the group that was found first
+        const auto later = [](const Candidate& a, const Candidate& b) { return a.priority > b.priority || (a.priority == b.priority && a.group > b.group); };
+
+        std::unordered_map<tile::Id, size_t, tile::Id::Hasher> index_of;
+        std::unordered_map<tile::Id, uint8_t, tile::Id::Hasher> n_children_in_list;
+        std::vector<tile::Id> groups;
+        std::vector<Candidate> heap;
+        index_of.reserve(tiles.size() * 2);
+        n_children_in_list.reserve(tiles.size());
+
+        const auto add_to_parent = [&](const tile::Id& id) {
+            if (id.zoom_level == 0)
+                return;
+            const auto parent = id.parent();
+            if (++n_children_in_list[parent] < 4)
+                return;
+            groups.push_back(parent);
+            heap.push_back({ priority_of(parent), uint32_t(groups.size() - 1) });
+            std::push_heap(heap.begin(), heap.end(), later);
+        };
+
+        for (size_t i = 0; i < tiles.size(); ++i)
+            index_of.emplace(tiles[i], i);
+        for (const auto& t : tiles)
+            add_to_parent(t);
+
+        std::vector<bool> removed(tiles.size(), false);
+        auto n_tiles = tiles.size();
+        while (n_tiles > max_n_tiles && !heap.empty()) {
+            std::pop_heap(heap.begin(), heap.end(), later);
+            const auto parent = groups[heap.back().group];
+            heap.pop_back();
 
-    while (tiles.size() > max_n_tiles) {
-        for (auto it = tiles.crbegin(); it != tiles.crend(); ++it) {
-            const auto parent = (*it).parent();
-            const auto siblings = parent.children();
-            if (all_in_set(siblings)) {
-                remove(siblings);
-                tiles.push_back(parent);
-                id_set.insert(parent);
-                break;
+            for (const auto& child : parent.children()) {
+                const auto it = index_of.find(child);
+                assert(it != index_of.end());
+                removed[it->second] = true;
+                index_of.erase(it);
             }
+            index_of.emplace(parent, tiles.size());
+            tiles.push_back(parent);
+            removed.push_back(false);
+            n_tiles -= 3;
+            add_to_parent(parent);
         }
+
+        std::vector<tile::Id> limited;
+        limited.reserve(n_tiles);
+        for (size_t i = 0; i < tiles.size(); ++i) {
+            if (!removed[i])
+                limited.push_back(tiles[i]);
+        }
+        return limited;
     }
-    return tiles;
+} // namespace
+
+std::vector<tile::Id> limit(std::vector<tile::Id> tiles, uint max_n_tiles)
+{
+    // coarse tiles are usually far away, merge them first
+    return collapse(std::move(tiles), max_n_tiles, [](const tile::Id& parent) { return float(parent.zoom_level); });
+}
+
+std::vector<tile::Id> limit(std::vector<tile::Id> tiles, uint max_n_tiles, const camera::Definition& camera, utils::AabbDecoratorPtr aabb_decorator)
+{
+    // the projected size of the parent is the screen space error we accept by drawing it instead of its children
+    const auto projected_size = [&](const tile::Id& parent) {
+        const auto aabb = aabb_decorator->aabb(parent);
+        const auto distance = float(radix::geometry::distance(aabb, camera.position()));
+        return camera.to_screen_space(float(aabb.size().x), distance);
+    };
+    return collapse(std::move(tiles), max_n_tiles, projected_size);
 }
 
 std::vector<TileBounds> cull(std::vector<TileBounds> tiles, const camera::Definition& camera)
 {
     std::vector<TileBounds> culled_tiles;
     culled_tiles.reserve(tiles.size());
-    const auto frustum = camera.frustum();
+    const FrustumCuller culler(camera);
 
-    for (const auto& t : tiles) {
-        if (tile::utils::camera_frustum_contains_tile(frustum, t.bounds))
-            culled_tiles.push_back(t);
+    CameraRelativeBounds relative_bounds(culler.origin());
+    relative_bounds.reserve(tiles.size());
+    for (const auto& t : tiles)
+        relative_bounds.push_back(t.bounds);
+
+    std::vector<FrustumCuller::Result> results;
+    culler.classify(relative_bounds, &results);
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        if (culler.resolve(results[i], tiles[i].bounds))
+            culled_tiles.push_back(tiles[i]);
     }
 
     return culled_tiles;
@@ -27,7 +27,10 @@ constexpr uint max_n_tiles = 1024;
 
 std::vector<tile::Id> generate_list(const camera::Definition& camera, utils::AabbDecoratorPtr aabb_decorator, unsigned max_zoom_level);
 std::vector<TileBounds> compute_bounds(const std::vector<tile::Id>& tiles, utils::AabbDecoratorPtr aabb_decorator);
+// merges complete sibling groups until there are at most max_n_tiles. the first overload merges coarse groups first,
+// the second the groups whose parent has the smallest projected size, i.e., the least visible error.
 std::vector<tile::Id> limit(std::vector<tile::Id> tiles, uint max_n_tiles);
+std::vector<tile::Id> limit(std::vector<tile::Id> tiles, uint max_n_tiles, const camera::Definition& camera, utils::AabbDecoratorPtr aabb_decorator);
 std::vector<TileBounds> cull(std::vector<TileBounds> list, const camera::Definition& camera);
 std::vector<TileBounds> sort(std::vector<TileBounds> list, const glm::dvec3& camera_position);
 }
@@ -45,6 +45,7 @@ inline GeometrySchedulerHolder geometry_scheduler(TileLoadServicePtr tile_servic
     settings.max_zoom_level = 18;
     settings.tile_resolution = 256;
     settings.gpu_quad_limit = 512;
+    settings.refine_criterion = RefineCriterion::GeometricError;
     auto scheduler = std::make_unique<GeometryScheduler>(settings, 65);
     scheduler->set_aabb_decorator(aabb_decorator);
 
@@ -66,6 +67,9 @@ inline GeometrySchedulerHolder geometry_scheduler(TileLoadServicePtr tile_servic
 
         QObject::connect(qa, &QuadAssembler::quad_loaded, sl, &SlotLimiter::deliver_quad);
         QObject::connect(sl, &SlotLimiter::quad_delivered, sch, &TextureScheduler::receive_quad);
+
+        QObject::connect(tile_service.get(), &TileLoadService::stats_ready, sch, &Scheduler::relay_stats);
+        QObject::connect(qa, &QuadAssembler::stats_ready, sch, &Scheduler::relay_stats);
     }
     if (QNetworkInformation::loadDefaultBackend() && QNetworkInformation::instance()) {
         QNetworkInformation* n = QNetworkInformation::instance();
@@ -120,6 +124,9 @@ inline TextureSchedulerHolder texture_scheduler(TileLoadServicePtr tile_service,
 
         QObject::connect(qa, &QuadAssembler::quad_loaded, sl, &SlotLimiter::deliver_quad);
         QObject::connect(sl, &SlotLimiter::quad_delivered, sch, &TextureScheduler::receive_quad);
+
+        QObject::connect(tile_service.get(), &TileLoadService::stats_ready, sch, &Scheduler::relay_stats);
+        QObject::connect(qa, &QuadAssembler::stats_ready, sch, &Scheduler::relay_stats);
     }
     if (QNetworkInformation::loadDefaultBackend() && QNetworkInformation::instance()) {
         QNetworkInformation* n = QNetworkInformation::instance();
@@ -0,0 +1,110 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#pragma once
+
+#include "types.h"
+#include <limits>
+#include <nucleus/utils/thread.h>
+#include <vector>
+
+namespace nucleus::tile {
+
+struct TraversalResult {
+    std::vector<tile::Id> leaves;
+    std::vector<tile::Id> inner_nodes; // nodes that were refined
+};
+
+/// Quad tree traversal like radix::quad_tree::onTheFlyTraverse, but the subtrees at split_depth below the root are traversed
+/// in parallel (utils::thread::parallel_for). The nodes above are expanded on the calling thread. Both lists come out in
+/// depth-first order (children in the order of Id::children, inner nodes before their children) independently of the number
+/// of threads. refine is called concurrently and must be thread safe.
+template <typename RefinePredicate>
+TraversalResult parallel_traverse(const tile::Id& root, const RefinePredicate& refine, unsigned split_depth = 3)
+{
+    // depth-first, pre-order, on an explicit stack
+    const auto traverse = [&refine](const tile::Id& subtree_root, unsigned max_depth, const auto& on_leaf, const auto& on_inner, const auto& on_split) {
+        std::vector<tile::Id> stack = { subtree_root };
+        while (!stack.empty()) {
+            const auto node = stack.back();
+            stack.pop_back();
+            if (node.zoom_level - subtree_root.zoom_level >= max_depth) {
+                on_split(node);
+                continue;
+            }
+            if (!refine(node)) {
+                on_leaf(node);
+                continue;
+            }
+            on_inner(node);
+            const auto children = node.children();
+            stack.insert(stack.end(), children.rbegin(), children.rend());
+        }
+    };
+
+    // the part above split_depth, in order. subtrees are placeholders, filled in below
+    struct Item {
+        enum class Type { Leaf, InnerNode, Subtree } type;
+        tile::Id id;
+        unsigned subtree = 0;
+    };
+    std::vector<Item> items;
+    std::vector<tile::Id> subtree_roots;
+    traverse(
+        root,
+        split_depth,
+        [&](const tile::Id& id) { items.push_back({ Item::Type::Leaf, id }); },
+        [&](const tile::Id& id) { items.push_back({ Item::Type::InnerNode, id }); },
+        [&](const tile::Id& id) {
+            items.push_back({ Item::Type::Subtree, id, unsigned(subtree_roots.size()) });
+            subtree_roots.push_back(id);
+        });
+
+    std::vector<TraversalResult> subtrees(subtree_roots.size());
+    utils::thread::parallel_for(unsigned(subtree_roots.size()), [&](unsigned i) {
+        auto& result = subtrees[i];
+        traverse(
+            subtree_roots[i],
+            std::numeric_limits<unsigned>::max(),
+            [&](const tile::Id& id) { result.leaves.push_back(id); },
+            [&](const tile::Id& id) { result.inner_nodes.push_back(id); },
+            [](const tile::Id&) {});
+    });
+
+    TraversalResult result;
+    for (const auto& item : items) {
+        switch (item.type) {
+        case Item::Type::Leaf:
+            result.leaves.push_back(item.id);
+            break;
+        case Item::Type::InnerNode:
+            result.inner_nodes.push_back(item.id);
+            break;
+        case Item::Type::Subtree: {
+            const auto& subtree = subtrees[item.subtree];
+            result.leaves.insert(result.leaves.end(), subtree.leaves.begin(), subtree.leaves.end());
+            result.inner_nodes.insert(result.inner_nodes.end(), subtree.inner_nodes.begin(), subtree.inner_nodes.end());
+            break;
+        }
+        }
+    }
+    return result;
+}
+
+} // namespace nucleus::tile
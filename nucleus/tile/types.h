@@ -31,6 +31,10 @@ class Raster;
 namespace nucleus::tile {
 using namespace radix::tile;
 
+/// ScreenSpaceSize refines while texels project larger than the pixel error threshold. GeometricError additionally stops
+/// where the geometric error of the children projects below it, so flat terrain isn't split as deep as rock faces.
+enum class RefineCriterion { ScreenSpaceSize, GeometricError };
+
 struct NetworkInfo {
     enum class Status : uint64_t { // NetworkInfo will be padded by 4 bytes even when usign 32bit int. clear the warning.
         Good = 0,
@@ -89,6 +93,7 @@ static_assert(NamedTile<GpuCacheInfo>);
 struct GpuTextureTile {
     tile::Id id;
     std::shared_ptr<const nucleus::utils::MipmappedColourTexture> texture;
+    bool empty = false; // no data in any of the quad's tiles. texture is shared by all empty quads, the gpu can share a layer.
 };
 static_assert(NamedTile<GpuTextureTile>);
 
@@ -101,6 +106,7 @@ struct GpuGeometryTile {
     tile::Id id;
     tile::SrsAndHeightBounds bounds = {};
     std::shared_ptr<const nucleus::Raster<uint16_t>> surface;
+    bool empty = false; // no (or broken) data. surface is shared by all empty tiles, the gpu can share a layer.
 };
 static_assert(NamedTile<GpuGeometryTile>);
 
@@ -18,4 +18,220 @@
 
 #include "utils.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <nucleus/utils/bit_coding.h>
 
+namespace nucleus::tile::utils {
+
+namespace {
+    // altitude scale divisors of the horizontal tile edges on AabbTable::max_row_zoom_level, south to north.
+    // the edges of coarser zoom levels are a subset (tile bounds scale by powers of two, so the values are identical).
+    const std::vector<float>& edge_divisors()
+    {
+        static const auto divisors = []() {
+            const auto n_rows = srs::number_of_vertical_tiles_for_zoom_level(AabbTable::max_row_zoom_level);
+            std::vector<float> divisors(n_rows + 1);
+            for (unsigned row = 0; row < n_rows; ++row) {
+                const auto bounds = srs::tile_bounds({ AabbTable::max_row_zoom_level, { 0, row } });
+                divisors[row] = altitude_scale_divisor(float(std::abs(bounds.min.y)));
+                if (row + 1 == n_rows)
+                    divisors[row + 1] = altitude_scale_divisor(float(std::abs(bounds.max.y)));
+            }
+            return divisors;
+        }();
+        return divisors;
+    }
+} // namespace
+
+AabbTable::AabbTable(const radix::TileHeights& tile_heights)
+{
+    const auto query = [&](const tile::Id& id) { return tile_heights.query({ id.zoom_level, id.coords }); };
+    // depth first, children in z-order, so that the keys come out sorted
+    const auto discover = [&](const auto& self, const tile::Id& id, const std::pair<float, float>& heights) -> void {
+        m_keys.push_back(key(id));
+        m_heights.push_back(heights);
+        if (id.zoom_level >= max_zoom_level)
+            return;
+        const auto children = std::array {
+            tile::Id { id.zoom_level + 1, id.coords * 2u + glm::uvec2(0, 0) },
+            tile::Id { id.zoom_level + 1, id.coords * 2u + glm::uvec2(1, 0) },
+            tile::Id { id.zoom_level + 1, id.coords * 2u + glm::uvec2(0, 1) },
+            tile::Id { id.zoom_level + 1, id.coords * 2u + glm::uvec2(1, 1) },
+        };
+        std::array<std::pair<float, float>, 4> child_heights;
+        bool leaf = true;
+        for (unsigned i = 0; i < 4; ++i) {
+            child_heights[i] = query(children[i]);
+            leaf = leaf && child_heights[i] == heights;
+        }
+        if (leaf)
+            return;
+        for (unsigned i = 0; i < 4; ++i)
+            self(self, children[i], child_heights[i]);
+    };
+    const auto root = tile::Id { 0, { 0, 0 } };
+    discover(discover, root, query(root));
+    assert(std::is_sorted(m_keys.cbegin(), m_keys.cend()));
+}
+
+tile::SrsAndHeightBounds AabbTable::aabb(const tile::Id& id) const
+{
+    const auto h = heights(id);
+    const auto srs_bounds = srs::tile_bounds(id);
+    return make_bounds(srs_bounds, h.first, h.second, scale_divisor(id, srs_bounds));
+}
+
+std::pair<float, float> AabbTable::heights(const tile::Id& id) const
+{
+    assert(id.zoom_level <= max_zoom_level);
+    // last entry not after id: either id itself, or the leaf it lies in (nothing between them in z-order)
+    const auto it = std::upper_bound(m_keys.cbegin(), m_keys.cend(), key(id));
+    assert(it != m_keys.cbegin());
+    return m_heights[size_t(it - m_keys.cbegin()) - 1];
+}
+
+float AabbTable::scale_divisor(const tile::Id& id, const tile::SrsBounds& srs_bounds)
+{
+    if (id.zoom_level > max_row_zoom_level)
+        return altitude_scale_divisor(furthest_world_y(srs_bounds));
+    const auto n_rows = srs::number_of_vertical_tiles_for_zoom_level(id.zoom_level);
+    const auto furthest_edge = (id.coords.y >= n_rows / 2) ? id.coords.y + 1 : id.coords.y;
+    return edge_divisors()[furthest_edge << (max_row_zoom_level - id.zoom_level)];
+}
+
+uint64_t AabbTable::key(const tile::Id& id)
+{
+    const auto shift = max_zoom_level - id.zoom_level;
+    return (nucleus::utils::bit_coding::z_order(id.coords << shift) << 5) | id.zoom_level;
+}
+
+tile::SrsAndHeightBounds AabbDecorator::aabb(const tile::Id& id) const
+{
+    auto heights = (id.zoom_level <= AabbTable::max_zoom_level) ? table.heights(id) : tile_heights.query({ id.zoom_level, id.coords });
+    {
+        std::shared_lock lock(loaded_heights_mutex);
+        if (!loaded_heights.empty()) {
+            if (const auto it = loaded_heights.find(id); it != loaded_heights.end()) {
+                const auto& loaded = it->second.effective;
+                heights = { std::max(heights.first, loaded.first), std::min(heights.second, loaded.second) };
+                if (heights.first > heights.second) // static heights disagree with the data, trust what is rendered
+                    heights = loaded;
+            }
+        }
+    }
+    const auto srs_bounds = srs::tile_bounds(id);
+    return make_bounds(srs_bounds, heights.first, heights.second, AabbTable::scale_divisor(id, srs_bounds));
+}
+
+void AabbDecorator::add_loaded_heights(const tile::Id& id, float min_height, float max_height)
+{
+    std::unique_lock lock(loaded_heights_mutex);
+    loaded_heights[id].own = std::make_pair(min_height, max_height);
+    update_loaded_heights_locked(id);
+}
+
+void AabbDecorator::remove_loaded_heights(const tile::Id& id)
+{
+    std::unique_lock lock(loaded_heights_mutex);
+    const auto it = loaded_heights.find(id);
+    if (it == loaded_heights.end() || !it->second.own)
+        return;
+    it->second.own.reset();
+    update_loaded_heights_locked(id);
+}
+
+std::optional<std::pair<float, float>> AabbDecorator::loaded_heights_of(const tile::Id& id) const
+{
+    std::shared_lock lock(loaded_heights_mutex);
+    const auto it = loaded_heights.find(id);
+    if (it == loaded_heights.end())
+        return {};
+    return it->second.effective;
+}
+
+void AabbDecorator::set_geometric_error(const tile::Id& id, float error)
+{
+    const auto decimetres = uint16_t(std::clamp(std::ceil(error * 10.f), 0.f, 65535.f));
+    std::unique_lock lock(loaded_heights_mutex);
+    geometric_errors[id] = decimetres;
+}
+
+std::optional<float> AabbDecorator::geometric_error(const tile::Id& id) const
+{
+    std::shared_lock lock(loaded_heights_mutex);
+    const auto it = geometric_errors.find(id);
+    if (it == geometric_errors.end())
+        return {};
+    return float(it->second) / 10.f;
+}
+
+std::optional<float> AabbDecorator::children_geometric_error(const tile::Id& id) const
+{
+    std::shared_lock lock(loaded_heights_mutex);
+    if (geometric_errors.empty())
+        return {};
+    std::optional<float> estimate;
+    float max_error = 0;
+    for (const auto& child : id.children()) {
+        if (const auto it = geometric_errors.find(child); it != geometric_errors.end()) {
+            max_error = std::max(max_error, float(it->second) / 10.f);
+            continue;
+        }
+        if (!estimate) {
+            // shared by all children, their ancestors are id and above
+            auto ancestor = id;
+            auto scale = 0.5f;
+            while (true) {
+                if (const auto it = geometric_errors.find(ancestor); it != geometric_errors.end()) {
+                    estimate = float(it->second) / 10.f * scale;
+                    break;
+                }
+                if (ancestor.zoom_level == 0)
+                    return {};
+                ancestor = tile::Id { ancestor.zoom_level - 1, ancestor.coords / 2u };
+                scale *= 0.5f;
+            }
+        }
+        max_error = std::max(max_error, estimate.value());
+    }
+    return max_error;
+}
+
+void AabbDecorator::update_loaded_heights_locked(tile::Id id)
+{
+    // id itself changed, its ancestors only need an update, as long as their effective heights change
+    for (bool first = true;; first = false) {
+        auto it = loaded_heights.find(id);
+        const auto previous = (it != loaded_heights.end()) ? std::optional(it->second.effective) : std::nullopt;
+        auto effective = (it != loaded_heights.end()) ? it->second.own : std::nullopt;
+
+        auto children_union = std::make_pair(std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest());
+        bool all_children_known = true;
+        for (const auto& child : id.children()) {
+            const auto child_it = loaded_heights.find(child);
+            if (child_it == loaded_heights.end()) {
+                all_children_known = false;
+                break;
+            }
+            children_union = { std::min(children_union.first, child_it->second.effective.first), std::max(children_union.second, child_it->second.effective.second) };
+        }
+        if (all_children_known)
+            effective = children_union;
+
+        if (effective && it != loaded_heights.end())
+            it->second.effective = effective.value();
+        else if (effective)
+            loaded_heights.emplace(id, LoadedHeights { {}, effective.value() });
+        else if (it != loaded_heights.end())
+            loaded_heights.erase(it);
+
+        if ((!first && effective == previous) || id.zoom_level == 0)
+            return;
+        id = tile::Id { id.zoom_level - 1, id.coords / 2u };
+    }
+}
+
+} // namespace nucleus::tile::utils
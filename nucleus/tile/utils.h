@@ -19,6 +19,8 @@
 #pragma once
 
 #include <QByteArray>
+#include <optional>
+#include <shared_mutex>
 #include <nucleus/camera/Definition.h>
 #include <nucleus/srs.h>
 #include <radix/TileHeights.h>
@@ -49,54 +51,113 @@ inline glm::dvec3 nearestVertex(const nucleus::camera::Definition& camera, const
 }
 
 namespace utils {
-    inline tile::SrsAndHeightBounds make_bounds(const tile::Id& id, float min_height, float max_height)
+    /// |cos(latitude)| at world_y, altitudes are divided by it to get world space heights (mercator stretches towards the poles).
+    inline float altitude_scale_divisor(float world_y)
     {
-        const auto comp_scaled_alt = [](float world_y, float altitude) {
-            // unoptimised version:
-            //            const auto lat = srs::world_to_lat_long({ 0.0, world_y }).x;
-            //            return srs::lat_long_alt_to_world({ lat, 0.0, altitude }).z;
-
-            // optimised version:
-            constexpr double pi = 3.1415926535897932384626433;
-            constexpr unsigned int cSemiMajorAxis = 6378137;
-            constexpr double cEarthCircumference = 2 * pi * cSemiMajorAxis;
-            constexpr double cOriginShift = cEarthCircumference / 2.0;
-
-            const float mercN = world_y * float(pi / cOriginShift);
-            const float lat_rad = 2.0f * (std::atan(std::exp(mercN)) - float(pi / 4.0));
-            return altitude / std::abs(std::cos(lat_rad));
-        };
+        // unoptimised version:
+        //            const auto lat = srs::world_to_lat_long({ 0.0, world_y }).x;
+        //            return srs::lat_long_alt_to_world({ lat, 0.0, altitude }).z;
+
+        // optimised version:
+        constexpr double pi = 3.1415926535897932384626433;
+        constexpr unsigned int cSemiMajorAxis = 6378137;
+        constexpr double cEarthCircumference = 2 * pi * cSemiMajorAxis;
+        constexpr double cOriginShift = cEarthCircumference / 2.0;
+
+        const float mercN = world_y * float(pi / cOriginShift);
+        const float lat_rad = 2.0f * (std::atan(std::exp(mercN)) - float(pi / 4.0));
+        return std::abs(std::cos(lat_rad));
+    }
 
-        const auto srs_bounds = srs::tile_bounds(id);
-        const auto max_world_y = [&srs_bounds]() {
-            return float(std::max(srs_bounds.max.y, -srs_bounds.min.y));
-        }();
-        //        const auto min_world_y = [&srs_bounds, &id]() {
-        //            if (id.zoom_level == 0)
-        //                return 0.;
-        //            return std::min(std::abs(srs_bounds.min.y), std::abs(srs_bounds.max.y));    // max can have a smaller abs value in the southern hemisphere
-        //        }();
-
-        const auto max_altitude = comp_scaled_alt(max_world_y, max_height) + 0.5f; // +0.5 to account for float inaccuracy
+    /// world_y of the tile edge furthest from the equator, that's where the altitude scale is largest.
+    inline float furthest_world_y(const tile::SrsBounds& srs_bounds) { return float(std::max(srs_bounds.max.y, -srs_bounds.min.y)); }
+
+    inline tile::SrsAndHeightBounds make_bounds(const tile::SrsBounds& srs_bounds, float min_height, float max_height, float altitude_scale_divisor)
+    {
+        const auto max_altitude = max_height / altitude_scale_divisor + 0.5f; // +0.5 to account for float inaccuracy
         const auto min_altitude = min_height - 0.5f; // we are allowed to be conservative with the AABBs! old code: comp_scaled_alt(min_world_y, min_height);
         return { .min = { srs_bounds.min, min_altitude }, .max = { srs_bounds.max, max_altitude } };
     }
 
+    inline tile::SrsAndHeightBounds make_bounds(const tile::Id& id, float min_height, float max_height)
+    {
+        const auto srs_bounds = srs::tile_bounds(id);
+        return make_bounds(srs_bounds, min_height, max_height, altitude_scale_divisor(furthest_world_y(srs_bounds)));
+    }
+
+    /// Flat copy of radix::TileHeights, sorted along the z-order curve (parents before children). The altitude scale divisors
+    /// of all tile rows are cached as well. An aabb costs a binary search, instead of walking up the zoom levels through a map and
+    /// evaluating atan, exp and cos.
+    /// The tree is discovered top down. A tile whose four children report its own heights is treated as a leaf: TileHeights
+    /// answers missing tiles with their parent, and stored children can repeat both extremes of the parent only on flat ground.
+    /// That's exact for complete pyramids (as generated). Tiles stored below unstored ones are missed, their ancestors' heights
+    /// are used instead, which is conservative.
+    class AabbTable {
+    public:
+        static constexpr unsigned max_zoom_level = 24;
+        static constexpr unsigned max_row_zoom_level = 18; // divisors of deeper rows are computed on the fly
+
+        explicit AabbTable(const radix::TileHeights& tile_heights);
+        /// same result as make_bounds(id, tile_heights.query(id)). id.zoom_level must not exceed max_zoom_level.
+        [[nodiscard]] tile::SrsAndHeightBounds aabb(const tile::Id& id) const;
+        /// same result as tile_heights.query(id). id.zoom_level must not exceed max_zoom_level.
+        [[nodiscard]] std::pair<float, float> heights(const tile::Id& id) const;
+        /// same result as altitude_scale_divisor(furthest_world_y(srs_bounds)), srs_bounds must be the bounds of id.
+        [[nodiscard]] static float scale_divisor(const tile::Id& id, const tile::SrsBounds& srs_bounds);
+        [[nodiscard]] size_t size() const { return m_keys.size(); }
+
+    private:
+        static uint64_t key(const tile::Id& id);
+
+        std::vector<uint64_t> m_keys;
+        std::vector<std::pair<float, float>> m_heights;
+    };
+
     class AabbDecorator;
     using AabbDecoratorPtr = std::shared_ptr<AabbDecorator>;
     class AabbDecorator {
         radix::TileHeights tile_heights;
+        AabbTable table;
+
+        struct LoadedHeights {
+            std::optional<std::pair<float, float>> own;
+            std::pair<float, float> effective; // union of the children, if all 4 are known, otherwise own
+        };
+        mutable std::shared_mutex loaded_heights_mutex;
+        tile::IdMap<LoadedHeights> loaded_heights;
+        tile::IdMap<uint16_t> geometric_errors; // decimetres, rounded up. kept after the tiles are unloaded
+        void update_loaded_heights_locked(tile::Id id);
 
     public:
         explicit inline AabbDecorator(radix::TileHeights tile_heights)
             : tile_heights(std::move(tile_heights))
+            , table(this->tile_heights)
         {
         }
-        inline tile::SrsAndHeightBounds aabb(const tile::Id& id) const
+        /// static heights, tightened by the loaded heights where known
+        tile::SrsAndHeightBounds aabb(const tile::Id& id) const;
+        /// reference for the table, walks through tile_heights
+        inline tile::SrsAndHeightBounds aabb_uncached(const tile::Id& id) const
         {
             const auto heights = tile_heights.query({ id.zoom_level, id.coords });
             return make_bounds(id, heights.first, heights.second);
         }
+
+        /// Thread safe. Heights of a loaded tile, e.g. min and max of its height surface, widened for the terrain between the
+        /// samples. They are intersected with the static heights, which are coarse beyond the resolution of the height file.
+        /// Once all 4 children of a tile are known, their union replaces its heights, and so on up the tree.
+        void add_loaded_heights(const tile::Id& id, float min_height, float max_height);
+        void remove_loaded_heights(const tile::Id& id);
+        [[nodiscard]] std::optional<std::pair<float, float>> loaded_heights_of(const tile::Id& id) const;
+
+        /// Thread safe. Vertical error in metres of rendering the parent's geometry instead of the tile's own (see
+        /// GeometryScheduler::geometric_error).
+        void set_geometric_error(const tile::Id& id, float error);
+        [[nodiscard]] std::optional<float> geometric_error(const tile::Id& id) const;
+        /// Largest geometric error among the children of id, i.e., what refining id would fix. Unknown children are estimated
+        /// from their closest known ancestor, halving the error per level. std::nullopt if no ancestor is known either.
+        [[nodiscard]] std::optional<float> children_geometric_error(const tile::Id& id) const;
+
         static inline AabbDecoratorPtr make(radix::TileHeights heights) { return std::make_shared<AabbDecorator>(std::move(heights)); }
     };
 
@@ -229,11 +290,15 @@ namespace utils {
         return refine;
     }
 
-    inline auto refineFunctor(const nucleus::camera::Definition& camera, const AabbDecoratorPtr& aabb_decorator, unsigned tile_size, unsigned max_zoom_level)
+    inline auto refineFunctor(const nucleus::camera::Definition& camera,
+        const AabbDecoratorPtr& aabb_decorator,
+        unsigned tile_size,
+        unsigned max_zoom_level,
+        RefineCriterion criterion = RefineCriterion::ScreenSpaceSize)
     {
         constexpr auto sqrt2 = 1.414213562373095;
         const auto camera_frustum = camera.frustum();
-        auto refine = [&camera, camera_frustum, tile_size, aabb_decorator, max_zoom_level](const tile::Id& tile) {
+        auto refine = [&camera, camera_frustum, tile_size, aabb_decorator, max_zoom_level, criterion](const tile::Id& tile) {
             if (tile.zoom_level >= max_zoom_level)
                 return false;
 
@@ -244,7 +309,15 @@ namespace utils {
             const auto distance = float(radix::geometry::distance(aabb, camera.position()));
             const auto pixel_size = float(sqrt2 * aabb.size().x / tile_size);
 
-            return camera.to_screen_space(pixel_size, distance) >= camera.pixel_error_threshold();
+            if (camera.to_screen_space(pixel_size, distance) < camera.pixel_error_threshold())
+                return false;
+            if (criterion == RefineCriterion::ScreenSpaceSize)
+                return true;
+            const auto error = aabb_decorator->children_geometric_error(tile);
+            if (!error)
+                return true;
+            const auto world_space_error = error.value() / AabbTable::scale_divisor(tile, srs::tile_bounds(tile));
+            return camera.to_screen_space(world_space_error, distance) >= camera.pixel_error_threshold();
         };
         return refine;
     }
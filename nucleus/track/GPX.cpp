@@ -24,6 +24,7 @@
 #include <QFile>
 #include <QXmlStreamReader>
 
+#include "../DataQuerier.h"
 #include "../srs.h"
 
 namespace nucleus::track {
@@ -113,6 +114,24 @@ std::unique_ptr<Gpx> parse(const QString& path)
     return parse(xmlReader);
 }
 
+void drape(Gpx* gpx, const DataQuerier& data_querier)
+{
+    std::vector<glm::dvec2> lat_longs;
+    for (const Segment& segment : gpx->track) {
+        for (const Point& point : segment)
+            lat_longs.emplace_back(point.latitude, point.longitude);
+    }
+    const auto altitudes = data_querier.get_altitudes(lat_longs);
+    size_t i = 0;
+    for (Segment& segment : gpx->track) {
+        for (Point& point : segment) {
+            if (altitudes[i])
+                point.elevation = altitudes[i].value();
+            ++i;
+        }
+    }
+}
+
 std::vector<glm::vec4> to_world_points(const Gpx& gpx)
 {
     std::vector<glm::vec4> track;
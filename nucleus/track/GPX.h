@@ -27,6 +27,10 @@
 #include <string>
 #include <vector>
 
+namespace nucleus {
+class DataQuerier;
+}
+
 namespace nucleus::track {
 
 // https://www.topografix.com/gpx.asp
@@ -73,6 +77,10 @@ std::unique_ptr<Gpx> parse(const QString& path);
 
 std::unique_ptr<Gpx> parse(QXmlStreamReader&);
 
+/// sets the elevation of all points to the terrain altitude (e.g., for tracks recorded without elevation).
+/// points outside of the cached terrain keep their elevation.
+void drape(Gpx* gpx, const DataQuerier& data_querier);
+
 std::vector<glm::vec4> to_world_points(const Gpx& gpx);
 
 std::vector<glm::vec4> to_world_points(const track::Segment& segment);
@@ -0,0 +1,144 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include "BufferPool.h"
+
+#include <bit>
+#include <cassert>
+#include <new>
+
+namespace nucleus::utils {
+
+namespace {
+    // smaller requests are rounded up to this, there is no point in pooling tiny buffers separately
+    constexpr size_t min_class_bytes = 64;
+
+    void* allocate(size_t n_bytes) { return ::operator new(n_bytes, std::align_val_t(BufferPool::alignment)); }
+    void deallocate(void* buffer) { ::operator delete(buffer, std::align_val_t(BufferPool::alignment)); }
+} // namespace
+
+BufferPool::BufferPool(size_t max_pooled_bytes)
+    : m_max_pooled_bytes(max_pooled_bytes)
+{
+}
+
+BufferPool::~BufferPool() { clear(); }
+
+BufferPool& BufferPool::instance()
+{
+    static auto* pool = new BufferPool();
+    return *pool;
+}
+
+// class 4 * e + q holds buffers of (5 + q) * 2^(e - 2) bytes, i.e., 1.25, 1.5, 1.75 and 2 times 2^e.
+unsigned BufferPool::size_class(size_t n_bytes)
+{
+    const auto m = std::max(n_bytes, min_class_bytes) - 1;
+    const auto e = unsigned(std::bit_width(m)) - 1;
+    const auto q = unsigned(m >> (e - 2)) - 4;
+    return 4 * e + q;
+}
+
+size_t BufferPool::class_bytes(unsigned cls) { return size_t(5 + cls % 4) << (cls / 4 - 2); }
+
+size_t BufferPool::size_class_bytes(size_t n_bytes) { return class_bytes(size_class(n_bytes)); }
+
+void* BufferPool::acquire(size_t n_bytes)
+{
+    if (n_bytes == 0)
+        return nullptr;
+    const auto cls = size_class(n_bytes);
+    const auto n_class_bytes = class_bytes(cls);
+    {
+        std::scoped_lock lock(m_mutex);
+        m_statistics.n_acquired++;
+        m_statistics.n_live_bytes += n_class_bytes;
+        auto& free_list = m_free[cls];
+        if (!free_list.empty()) {
+            void* buffer = free_list.back();
+            free_list.pop_back();
+            m_statistics.n_pooled_bytes -= n_class_bytes;
+            return buffer;
+        }
+        m_statistics.n_allocated++;
+    }
+    return allocate(n_class_bytes);
+}
+
+void BufferPool::release(void* buffer, size_t n_bytes)
+{
+    if (buffer == nullptr)
+        return;
+    assert(n_bytes > 0);
+    const auto cls = size_class(n_bytes);
+    const auto n_class_bytes = class_bytes(cls);
+    {
+        std::scoped_lock lock(m_mutex);
+        m_statistics.n_released++;
+        assert(m_statistics.n_live_bytes >= n_class_bytes);
+        m_statistics.n_live_bytes -= n_class_bytes;
+        if (m_statistics.n_pooled_bytes + n_class_bytes <= m_max_pooled_bytes) {
+            m_free[cls].push_back(buffer);
+            m_statistics.n_pooled_bytes += n_class_bytes;
+            return;
+        }
+        m_statistics.n_freed++;
+    }
+    deallocate(buffer);
+}
+
+void BufferPool::set_max_pooled_bytes(size_t max_pooled_bytes)
+{
+    std::scoped_lock lock(m_mutex);
+    m_max_pooled_bytes = max_pooled_bytes;
+    trim(max_pooled_bytes);
+}
+
+size_t BufferPool::max_pooled_bytes() const
+{
+    std::scoped_lock lock(m_mutex);
+    return m_max_pooled_bytes;
+}
+
+void BufferPool::clear()
+{
+    std::scoped_lock lock(m_mutex);
+    trim(0);
+}
+
+BufferPool::Statistics BufferPool::statistics() const
+{
+    std::scoped_lock lock(m_mutex);
+    return m_statistics;
+}
+
+// frees the largest buffers first. requires the lock.
+void BufferPool::trim(size_t max_pooled_bytes)
+{
+    for (auto cls = unsigned(m_free.size()); cls-- > 0 && m_statistics.n_pooled_bytes > max_pooled_bytes;) {
+        auto& free_list = m_free[cls];
+        while (!free_list.empty() && m_statistics.n_pooled_bytes > max_pooled_bytes) {
+            deallocate(free_list.back());
+            free_list.pop_back();
+            m_statistics.n_pooled_bytes -= class_bytes(cls);
+        }
+    }
+}
+
+} // namespace nucleus::utils
@@ -0,0 +1,124 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+#include "nucleus/Raster.h"
+
+namespace nucleus::utils {
+
+/// Thread safe pool of large, 64 byte aligned buffers. There are four size classes per power of two (1.25, 1.5, 1.75 and
+/// 2 times 2^n), so odd sizes like the 65² height rasters waste at most 25%. Released buffers are kept for
+/// reuse until max_pooled_bytes is reached, after that they are freed. Used for the storage of the tile conversion
+/// pipeline (stitched rasters, mip levels, compressed textures), which would otherwise allocate and free several
+/// MiB per quad.
+class BufferPool {
+public:
+    struct Statistics {
+        uint64_t n_acquired = 0;
+        uint64_t n_allocated = 0; // acquisitions that couldn't be served from the pool
+        uint64_t n_released = 0;
+        uint64_t n_freed = 0; // releases that didn't fit the budget
+        size_t n_pooled_bytes = 0;
+        size_t n_live_bytes = 0; // acquired and not released yet (rounded up to the size class)
+    };
+    static constexpr size_t alignment = 64;
+
+    explicit BufferPool(size_t max_pooled_bytes = size_t(64) * 1024 * 1024);
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+    ~BufferPool();
+
+    /// never destroyed, so buffers can be released during static destruction.
+    static BufferPool& instance();
+
+    /// nullptr for n_bytes == 0. the content is undefined.
+    [[nodiscard]] void* acquire(size_t n_bytes);
+    /// n_bytes must be the value given to acquire.
+    void release(void* buffer, size_t n_bytes);
+
+    void set_max_pooled_bytes(size_t max_pooled_bytes);
+    [[nodiscard]] size_t max_pooled_bytes() const;
+    /// frees all pooled buffers
+    void clear();
+    [[nodiscard]] Statistics statistics() const;
+
+    [[nodiscard]] static size_t size_class_bytes(size_t n_bytes);
+
+private:
+    static unsigned size_class(size_t n_bytes);
+    static size_t class_bytes(unsigned cls);
+    void trim(size_t max_pooled_bytes);
+
+    mutable std::mutex m_mutex;
+    std::array<std::vector<void*>, 4 * 64> m_free;
+    size_t m_max_pooled_bytes = 0;
+    Statistics m_statistics;
+};
+
+/// std allocator on top of a BufferPool, e.g. for the compressed data of ColourTexture.
+template <typename T> class PoolAllocator {
+public:
+    using value_type = T;
+
+    PoolAllocator() noexcept
+        : m_pool(&BufferPool::instance())
+    {
+    }
+    explicit PoolAllocator(BufferPool& pool) noexcept
+        : m_pool(&pool)
+    {
+    }
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) noexcept
+        : m_pool(other.pool())
+    {
+    }
+
+    [[nodiscard]] T* allocate(size_t n) { return static_cast<T*>(m_pool->acquire(n * sizeof(T))); }
+    void deallocate(T* p, size_t n) noexcept { m_pool->release(p, n * sizeof(T)); }
+    [[nodiscard]] BufferPool* pool() const noexcept { return m_pool; }
+
+    template <typename U> bool operator==(const PoolAllocator<U>& other) const noexcept { return m_pool == other.pool(); }
+
+private:
+    BufferPool* m_pool;
+};
+
+using PooledBytes = std::vector<uint8_t, PoolAllocator<uint8_t>>;
+
+/// raster adopting a pool buffer, which goes back to the pool once the raster (or the texture holding it) is dropped.
+/// the content is undefined. copies own a std::vector as usual.
+template <typename T> Raster<T> pooled_raster(const glm::uvec2& size, BufferPool& pool = BufferPool::instance())
+{
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+    static_assert(alignof(T) <= BufferPool::alignment);
+    const auto n_bytes = size_t(size.x) * size.y * sizeof(T);
+    auto* buffer = static_cast<T*>(pool.acquire(n_bytes));
+    return Raster<T>(size, buffer, [&pool, n_bytes](T* p) { pool.release(p, n_bytes); });
+}
+
+} // namespace nucleus::utils
@@ -24,127 +24,160 @@
 #include <cstdint>
 #include <stdexcept>
 
+#include "nucleus/utils/thread.h"
+
 #define GOOFYTC_IMPLEMENTATION
 #include <GoofyTC/goofy_tc.h>
 
+using Format = nucleus::utils::ColourTexture::Format;
 
 namespace {
 
-std::vector<uint8_t> to_dxt1(const nucleus::Raster<glm::u8vec4>& image)
+struct alignas(16) AlignedBlock
 {
-    assert(image.width() == image.height());
-    assert(image.width() % 16 == 0);
-    assert(image.size_per_line() * image.height() == image.width() * image.height() * 4);
-    assert(image.size_in_bytes() == image.width() * image.height() * 4);
-
-    struct alignas(16) AlignedBlock
-    {
-        std::array<uint8_t, 16> data;
-    };
-    static_assert(sizeof(AlignedBlock) == 16);
+    std::array<uint8_t, 16> data;
+};
+static_assert(sizeof(AlignedBlock) == 16);
 
-    const auto n_bytes_in = size_t(image.size_in_bytes());
-    const auto n_bytes_out = image.width() * image.height() / 2;
-    assert(n_bytes_in % sizeof(AlignedBlock) == 0);
+// goofy works on chunks of 16x16 pixels. The compressed 4x4 blocks are stored row by row, therefore every band of
+// 16 pixel rows can be compressed independently, and its output is a contiguous range.
+constexpr unsigned goofy_chunk = 16;
+// Below this width, the whole level is a single task. Larger levels are split into bands, which run in parallel.
+constexpr unsigned min_band_split_width = 128;
 
-    auto aligned_in = std::vector<AlignedBlock>(n_bytes_in / sizeof(AlignedBlock));
-    auto data_ptr = reinterpret_cast<uint8_t*>(aligned_in.data());
-    std::copy(image.bytes(), image.bytes() + n_bytes_in, data_ptr);
+size_t n_compressed_bytes(const glm::uvec2& size) { return size_t(size.x) * size.y / 2; }
 
-    std::vector<uint8_t> compressed(n_bytes_out);
-    const auto result = goofy::compressDXT1(compressed.data(), data_ptr, (uint32_t)image.width(), (uint32_t)image.height(), (uint32_t)image.width() * 4);
-    assert(result == 0);
-    Q_UNUSED(result);
-
-    return compressed;
+// goofy reads its input with aligned 16 byte loads. Only copy, if the raster storage isn't aligned already
+// (decoder and vector allocations usually are).
+const uint8_t* aligned_input(const nucleus::Raster<glm::u8vec4>& image, std::vector<AlignedBlock>& scratch)
+{
+    if (reinterpret_cast<std::uintptr_t>(image.bytes()) % alignof(AlignedBlock) == 0)
+        return image.bytes();
+    scratch.resize(image.size_in_bytes() / sizeof(AlignedBlock));
+    auto* data_ptr = reinterpret_cast<uint8_t*>(scratch.data());
+    std::copy(image.bytes(), image.bytes() + image.size_in_bytes(), data_ptr);
+    return data_ptr;
 }
 
-std::vector<uint8_t> to_etc1(const nucleus::Raster<glm::u8vec4>& image)
+void compress(Format format, uint8_t* out, const uint8_t* in, unsigned width, unsigned height)
 {
-    assert(image.width() == image.height());
-    assert(image.width() % 16 == 0);
-    assert(image.size_per_line() * image.height() == image.width() * image.height() * 4);
-    assert(image.size_in_bytes() == image.width() * image.height() * 4);
-
-    struct alignas(16) AlignedBlock
-    {
-        std::array<uint8_t, 16> data;
-    };
-    static_assert(sizeof(AlignedBlock) == 16);
-
-    const auto n_bytes_in = size_t(image.size_in_bytes());
-    const auto n_bytes_out = image.width() * image.height() / 2;
-    assert(n_bytes_in % sizeof(AlignedBlock) == 0);
-
-    auto aligned_in = std::vector<AlignedBlock>(n_bytes_in / sizeof(AlignedBlock));
-    auto data_ptr = reinterpret_cast<uint8_t*>(aligned_in.data());
-    std::copy(image.bytes(), image.bytes() + n_bytes_in, data_ptr);
-
-    std::vector<uint8_t> compressed(n_bytes_out);
-    const auto result = goofy::compressETC1(compressed.data(), data_ptr, (uint32_t)image.width(), (uint32_t)image.height(), (uint32_t)image.width() * 4);
+    assert(width % goofy_chunk == 0);
+    assert(height % goofy_chunk == 0);
+    assert(reinterpret_cast<std::uintptr_t>(in) % alignof(AlignedBlock) == 0);
+    int result = 0;
+    if (format == Format::DXT1)
+        result = goofy::compressDXT1(out, in, (uint32_t)width, (uint32_t)height, (uint32_t)width * 4);
+    else if (format == Format::ETC1)
+        result = goofy::compressETC1(out, in, (uint32_t)width, (uint32_t)height, (uint32_t)width * 4);
+    else
+        throw std::runtime_error("Unsupported algorithm for nucleus::Raster<glm::u8vec4>");
     assert(result == 0);
     Q_UNUSED(result);
-
-    return compressed;
 }
 
-std::vector<uint8_t> to_uncompressed_rgba(const nucleus::Raster<glm::u8vec4>& image)
+/// One unit of work: a band of 16 pixel rows of a mip level (or the whole level, if it is small).
+struct Task {
+    const uint8_t* in;
+    uint8_t* out;
+    unsigned width;
+    unsigned height;
+};
+
+void append_tasks(std::vector<Task>& tasks, const uint8_t* in, uint8_t* out, const glm::uvec2& size)
 {
-    size_t size_in_bytes = image.size_in_bytes();
-    assert(size_in_bytes == (size_t)image.width() * image.height() * 4);
-    std::vector<uint8_t> data(size_in_bytes);
-    // Note: AND Another copy... We copy the data two times (once in stb_image_loader.cpp)
-    std::copy(image.bytes(), image.bytes() + image.size_in_bytes(), data.data());
-    return data;
+    if (size.x < min_band_split_width) {
+        tasks.push_back({ in, out, size.x, size.y });
+        return;
+    }
+    for (unsigned y = 0; y < size.y; y += goofy_chunk) {
+        tasks.push_back({ in + size_t(y) * size.x * 4, out + n_compressed_bytes({ size.x, y }), size.x, goofy_chunk });
+    }
 }
 
-std::vector<uint8_t> to_compressed(const nucleus::Raster<glm::u8vec4>& image, nucleus::utils::ColourTexture::Format algorithm)
+// Levels smaller than goofy's chunk size (8x8 and below) are packed into a single 16x16 atlas and compressed with
+// one call. Their blocks are sliced out afterwards. 2x2 and 1x1 levels are replicated to fill their 4x4 block.
+std::vector<nucleus::utils::PooledBytes> compress_small_levels(const std::vector<const nucleus::Raster<glm::u8vec4>*>& levels, Format format)
 {
-    using Algorithm = nucleus::utils::ColourTexture::Format;
-    assert(image.width() == image.height());
-    assert(image.width() % 4 == 0 || image.width() == 2 || image.width() == 1);
-
-    switch (algorithm) {
-    case Algorithm::Uncompressed_RGBA:
-        return to_uncompressed_rgba(image);
-    case nucleus::utils::ColourTexture::Format::DXT1: {
-        if (image.width() >= 16)
-            return to_dxt1(image);
-        glm::u32vec4 avg = {};
-        for (const auto& c : image.buffer()) {
-            avg += glm::u32vec4(c);
+    const auto slot_of = [](unsigned width) -> glm::uvec2 {
+        switch (width) {
+        case 8:
+            return { 0, 0 };
+        case 4:
+            return { 8, 0 };
+        case 2:
+            return { 12, 0 };
+        case 1:
+            return { 8, 4 };
         }
-        avg /= image.buffer_length();
-        auto v = to_dxt1(nucleus::resize(image, { 16, 16 }, glm::u8vec4(avg)));
-        if (image.width() == 8) {
-            for (auto i = 16u; i < 32; ++i)
-                v[i] = v[i + 16u];
-            v.resize(32);
-        } else if (image.width() <= 4) {
-            v.resize(8);
+        return { 0, 0 }; // other sizes (e.g. 12x12) get an atlas of their own
+    };
+    const auto fits_shared_atlas = [&]() {
+        unsigned used = 0;
+        for (const auto* level : levels) {
+            const auto w = level->width();
+            if ((w != 8 && w != 4 && w != 2 && w != 1) || (used & w))
+                return false;
+            used |= w;
         }
-        return v;
-    }
-    case nucleus::utils::ColourTexture::Format::ETC1: {
-        if (image.width() >= 16)
-            return to_etc1(image);
-        glm::u32vec4 avg = {};
-        for (const auto& c : image.buffer()) {
-            avg += glm::u32vec4(c);
+        return true;
+    };
+    if (levels.size() > 1 && !fits_shared_atlas()) {
+        std::vector<nucleus::utils::PooledBytes> retval;
+        for (const auto* level : levels) {
+            retval.push_back(std::move(compress_small_levels({ level }, format).front()));
         }
-        avg /= image.buffer_length();
-        auto v = to_etc1(nucleus::resize(image, { 16, 16 }, glm::u8vec4(avg)));
-        if (image.width() == 8) {
-            for (auto i = 16u; i < 32; ++i)
-                v[i] = v[i + 16u];
-            v.resize(32);
-        } else if (image.width() <= 4) {
-            v.resize(8);
+        return retval;
+    }
+
+    nucleus::Raster<glm::u8vec4> atlas(glm::uvec2(goofy_chunk), levels.front()->pixel({ 0, 0 }));
+    for (const auto* level : levels) {
+        assert(level->width() == level->height());
+        assert(level->width() < goofy_chunk);
+        const auto offset = slot_of(level->width());
+        const auto extent = glm::uvec2(std::max(level->width(), 4u));
+        for (unsigned y = 0; y < extent.y; ++y) {
+            for (unsigned x = 0; x < extent.x; ++x) {
+                atlas.pixel(offset + glm::uvec2(x, y)) = level->pixel(glm::uvec2(x, y) * level->size() / extent);
+            }
         }
-        return v;
     }
+    std::vector<uint8_t> compressed(n_compressed_bytes(atlas.size()));
+    std::vector<AlignedBlock> scratch;
+    compress(format, compressed.data(), aligned_input(atlas, scratch), atlas.width(), atlas.height());
+
+    constexpr unsigned block_bytes = 8;
+    constexpr unsigned blocks_per_row = goofy_chunk / 4;
+    std::vector<nucleus::utils::PooledBytes> retval;
+    retval.reserve(levels.size());
+    for (const auto* level : levels) {
+        const auto first_block = slot_of(level->width()) / 4u;
+        const auto n_blocks = std::max(level->width() / 4u, 1u);
+        nucleus::utils::PooledBytes out;
+        out.reserve(n_blocks * n_blocks * block_bytes);
+        for (unsigned by = first_block.y; by < first_block.y + n_blocks; ++by) {
+            const auto* row = compressed.data() + (by * blocks_per_row + first_block.x) * block_bytes;
+            out.insert(out.end(), row, row + n_blocks * block_bytes);
+        }
+        retval.push_back(std::move(out));
     }
-    throw std::runtime_error("Unsupported algorithm for nucleus::Raster<glm::u8vec4>");
+    return retval;
+}
+
+nucleus::utils::PooledBytes to_compressed(const nucleus::Raster<glm::u8vec4>& image, Format format)
+{
+    assert(image.width() == image.height());
+    assert(image.width() % 4 == 0 || image.width() == 2 || image.width() == 1);
+    if (format == Format::Uncompressed_RGBA)
+        return {}; // kept as raster by ColourTexture
+    if (image.width() < goofy_chunk)
+        return std::move(compress_small_levels({ &image }, format).front());
+
+    nucleus::utils::PooledBytes compressed(n_compressed_bytes(image.size()));
+    std::vector<AlignedBlock> scratch;
+    std::vector<Task> tasks;
+    append_tasks(tasks, aligned_input(image, scratch), compressed.data(), image.size());
+    nucleus::utils::thread::parallel_for(unsigned(tasks.size()), [&](unsigned i) { compress(format, tasks[i].out, tasks[i].in, tasks[i].width, tasks[i].height); });
+    return compressed;
 }
 } // namespace
 
@@ -153,16 +186,71 @@ nucleus::utils::ColourTexture::ColourTexture(const nucleus::Raster<glm::u8vec4>&
     , m_width(unsigned(image.width()))
     , m_height(unsigned(image.height()))
     , m_format(format)
+{
+    if (format == Format::Uncompressed_RGBA)
+        m_uncompressed = image;
+}
+
+nucleus::utils::ColourTexture::ColourTexture(nucleus::Raster<glm::u8vec4>&& image, Format format)
+    : m_data(to_compressed(image, format))
+    , m_width(unsigned(image.width()))
+    , m_height(unsigned(image.height()))
+    , m_format(format)
+{
+    if (format == Format::Uncompressed_RGBA)
+        m_uncompressed = std::move(image);
+}
+
+nucleus::utils::ColourTexture::ColourTexture(PooledBytes&& compressed, const glm::uvec2& size, Format format)
+    : m_data(std::move(compressed))
+    , m_width(size.x)
+    , m_height(size.y)
+    , m_format(format)
+{
+    assert(format != Format::Uncompressed_RGBA);
+}
+
+nucleus::utils::ColourTexture::ColourTexture(const std::vector<uint8_t>& compressed, const glm::uvec2& size, Format format)
+    : ColourTexture(PooledBytes(compressed.cbegin(), compressed.cend()), size, format)
 {
 }
 
 nucleus::utils::MipmappedColourTexture nucleus::utils::generate_mipmapped_colour_texture(
-    const nucleus::Raster<glm::u8vec4>& texture, ColourTexture::Format format)
+    nucleus::Raster<glm::u8vec4> texture, ColourTexture::Format format)
 {
-    auto mip_levels = nucleus::generate_mipmap(texture);
+    // all levels live in pool buffers, which return once the texture is dropped (e.g. after the gpu upload)
+    auto mip_levels = nucleus::generate_mipmap(std::move(texture), [](const glm::uvec2& size) { return nucleus::utils::pooled_raster<glm::u8vec4>(size); });
     nucleus::utils::MipmappedColourTexture colour_texture = {};
-    for (const auto& level : mip_levels) {
-        colour_texture.emplace_back(level, format);
+    colour_texture.reserve(mip_levels.size());
+    if (format == Format::Uncompressed_RGBA) {
+        for (auto& level : mip_levels) {
+            colour_texture.emplace_back(std::move(level), format);
+        }
+        return colour_texture;
+    }
+
+    // All bands of all large levels are compressed in one parallel batch, the small levels share a single encode.
+    std::vector<PooledBytes> compressed(mip_levels.size());
+    std::vector<std::vector<AlignedBlock>> scratch(mip_levels.size());
+    std::vector<Task> tasks;
+    std::vector<const nucleus::Raster<glm::u8vec4>*> small_levels;
+    for (size_t i = 0; i < mip_levels.size(); ++i) {
+        const auto& level = mip_levels[i];
+        if (level.width() < goofy_chunk) {
+            small_levels.push_back(&level);
+            continue;
+        }
+        compressed[i].resize(n_compressed_bytes(level.size()));
+        append_tasks(tasks, aligned_input(level, scratch[i]), compressed[i].data(), level.size());
+    }
+    nucleus::utils::thread::parallel_for(unsigned(tasks.size()), [&](unsigned i) { compress(format, tasks[i].out, tasks[i].in, tasks[i].width, tasks[i].height); });
+    if (!small_levels.empty()) {
+        auto small = compress_small_levels(small_levels, format);
+        std::move(small.begin(), small.end(), compressed.end() - small.size());
+    }
+
+    for (size_t i = 0; i < mip_levels.size(); ++i) {
+        colour_texture.emplace_back(std::move(compressed[i]), mip_levels[i].size(), format);
     }
     return colour_texture;
 }
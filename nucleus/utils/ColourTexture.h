@@ -22,6 +22,7 @@
 #include <vector>
 #include <glm/glm.hpp>
 #include "nucleus/Raster.h"
+#include "nucleus/utils/BufferPool.h"
 
 namespace nucleus::utils {
 
@@ -30,21 +31,27 @@ public:
     enum class Format { Uncompressed_RGBA, DXT1, ETC1 };
 
 private:
-    std::vector<uint8_t> m_data;
+    PooledBytes m_data; // compressed formats
+    nucleus::Raster<glm::u8vec4> m_uncompressed; // Uncompressed_RGBA keeps the raster's storage instead of copying into m_data
     unsigned m_width = 0;
     unsigned m_height = 0;
     Format m_format = Format::Uncompressed_RGBA;
 
 public:
     explicit ColourTexture(const nucleus::Raster<glm::u8vec4>& data, Format format);
-    [[nodiscard]] const uint8_t* data() const { return m_data.data(); }
-    [[nodiscard]] size_t n_bytes() const { return m_data.size(); }
+    explicit ColourTexture(nucleus::Raster<glm::u8vec4>&& data, Format format);
+    /// wraps already compressed data (DXT1 or ETC1)
+    ColourTexture(PooledBytes&& compressed, const glm::uvec2& size, Format format);
+    /// copies into pooled storage
+    ColourTexture(const std::vector<uint8_t>& compressed, const glm::uvec2& size, Format format);
+    [[nodiscard]] const uint8_t* data() const { return m_format == Format::Uncompressed_RGBA ? m_uncompressed.bytes() : m_data.data(); }
+    [[nodiscard]] size_t n_bytes() const { return m_format == Format::Uncompressed_RGBA ? m_uncompressed.size_in_bytes() : m_data.size(); }
     [[nodiscard]] unsigned width() const { return m_width; }
     [[nodiscard]] unsigned height() const { return m_height; }
     [[nodiscard]] Format format() const { return m_format; }
 };
 
 using MipmappedColourTexture = std::vector<ColourTexture>;
-MipmappedColourTexture generate_mipmapped_colour_texture(const nucleus::Raster<glm::u8vec4>& data, ColourTexture::Format format);
+MipmappedColourTexture generate_mipmapped_colour_texture(nucleus::Raster<glm::u8vec4> data, ColourTexture::Format format);
 
 } // namespace nucleus::utils
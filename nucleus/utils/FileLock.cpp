@@ -0,0 +1,111 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include "FileLock.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+using namespace nucleus::utils;
+
+tl::expected<FileLock, QString> FileLock::acquire(const std::filesystem::path& path, Mode mode)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(path.parent_path(), ec);
+#if defined(_WIN32)
+    const auto handle = CreateFileW(path.wstring().c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE)
+        return tl::unexpected(QString("Couldn't open lock file '%1' (error %2).").arg(QString::fromStdString(path.string())).arg(GetLastError()));
+    OVERLAPPED overlapped = {};
+    const DWORD flags = (mode == Mode::Exclusive) ? LOCKFILE_EXCLUSIVE_LOCK : 0;
+    if (!LockFileEx(handle, flags, 0, MAXDWORD, MAXDWORD, &overlapped)) {
+        const auto error = GetLastError();
+        CloseHandle(handle);
+        return tl::unexpected(QString("Couldn't lock '%1' (error %2).").arg(QString::fromStdString(path.string())).arg(error));
+    }
+    return FileLock(reinterpret_cast<intptr_t>(handle), mode);
+#elif defined(__EMSCRIPTEN__)
+    // single process, nothing to coordinate.
+    return FileLock(-1, mode);
+#else
+    const auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return tl::unexpected(QString("Couldn't open lock file '%1': %2").arg(QString::fromStdString(path.string()), std::strerror(errno)));
+    int r = 0;
+    do {
+        r = ::flock(fd, mode == Mode::Exclusive ? LOCK_EX : LOCK_SH);
+    } while (r != 0 && errno == EINTR);
+    if (r != 0) {
+        const auto error = QString(std::strerror(errno));
+        ::close(fd);
+        return tl::unexpected(QString("Couldn't lock '%1': %2").arg(QString::fromStdString(path.string()), error));
+    }
+    return FileLock(fd, mode);
+#endif
+}
+
+FileLock::FileLock(intptr_t handle, Mode mode)
+    : m_handle(handle)
+    , m_mode(mode)
+{
+}
+
+FileLock::FileLock(FileLock&& other) noexcept
+    : m_handle(std::exchange(other.m_handle, -1))
+    , m_mode(other.m_mode)
+{
+}
+
+FileLock& FileLock::operator=(FileLock&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_handle = std::exchange(other.m_handle, -1);
+        m_mode = other.m_mode;
+    }
+    return *this;
+}
+
+FileLock::~FileLock() { release(); }
+
+FileLock::Mode FileLock::mode() const { return m_mode; }
+
+void FileLock::release()
+{
+    if (m_handle == -1)
+        return;
+#if defined(_WIN32)
+    const auto handle = reinterpret_cast<HANDLE>(m_handle);
+    OVERLAPPED overlapped = {};
+    UnlockFileEx(handle, 0, MAXDWORD, MAXDWORD, &overlapped);
+    CloseHandle(handle);
+#elif !defined(__EMSCRIPTEN__)
+    ::flock(int(m_handle), LOCK_UN);
+    ::close(int(m_handle));
+#endif
+    m_handle = -1;
+}
@@ -0,0 +1,53 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#pragma once
+
+#include <QString>
+#include <cstdint>
+#include <filesystem>
+#include <tl/expected.hpp>
+
+namespace nucleus::utils {
+
+/// Advisory lock on a file, shared between processes (flock on unix, LockFileEx on windows, no-op on webassembly).
+/// Any number of processes can hold a shared lock at the same time, an exclusive lock waits until all others are released.
+/// The lock is released on destruction, or when the process dies.
+class FileLock {
+public:
+    enum class Mode { Shared, Exclusive };
+
+    [[nodiscard]] static tl::expected<FileLock, QString> acquire(const std::filesystem::path& path, Mode mode);
+
+    FileLock(FileLock&& other) noexcept;
+    FileLock& operator=(FileLock&& other) noexcept;
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+    ~FileLock();
+
+    [[nodiscard]] Mode mode() const;
+
+private:
+    FileLock(intptr_t handle, Mode mode);
+    void release();
+
+    intptr_t m_handle = -1;
+    Mode m_mode = Mode::Shared;
+};
+
+} // namespace nucleus::utils
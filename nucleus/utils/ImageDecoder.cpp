@@ -0,0 +1,88 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include "ImageDecoder.h"
+
+#include <array>
+#include <mutex>
+
+namespace nucleus::utils {
+
+namespace {
+    std::shared_ptr<const ImageDecoder> default_decoder(ImageFormat format)
+    {
+        if (format == ImageFormat::Jpeg) {
+            if (auto turbo = turbojpeg_decoder())
+                return turbo;
+        }
+        return stb_image_decoder();
+    }
+
+    struct Registry {
+        std::mutex mutex;
+        std::array<std::shared_ptr<const ImageDecoder>, 3> decoders;
+    };
+    Registry& registry()
+    {
+        static Registry r;
+        return r;
+    }
+} // namespace
+
+ImageFormat detect_image_format(const QByteArray& bytes)
+{
+    const auto* b = reinterpret_cast<const uint8_t*>(bytes.constData());
+    if (bytes.size() >= 3 && b[0] == 0xFF && b[1] == 0xD8 && b[2] == 0xFF)
+        return ImageFormat::Jpeg;
+    if (bytes.size() >= 8 && b[0] == 0x89 && b[1] == 'P' && b[2] == 'N' && b[3] == 'G' && b[4] == 0x0D && b[5] == 0x0A && b[6] == 0x1A && b[7] == 0x0A)
+        return ImageFormat::Png;
+    return ImageFormat::Unknown;
+}
+
+unsigned downscale_factor(const glm::uvec2& image_size, const glm::uvec2& target_size)
+{
+    for (unsigned factor = 1; factor <= 8; factor *= 2) {
+        if (target_size * factor == image_size)
+            return factor;
+    }
+    return 0;
+}
+
+std::shared_ptr<const ImageDecoder> image_decoder(ImageFormat format)
+{
+    auto& r = registry();
+    std::scoped_lock lock(r.mutex);
+    auto& decoder = r.decoders[size_t(format)];
+    if (!decoder)
+        decoder = default_decoder(format);
+    return decoder;
+}
+
+void set_image_decoder(ImageFormat format, std::shared_ptr<const ImageDecoder> decoder)
+{
+    auto& r = registry();
+    std::scoped_lock lock(r.mutex);
+    r.decoders[size_t(format)] = decoder ? std::move(decoder) : default_decoder(format);
+}
+
+#ifndef ALP_ENABLE_TURBOJPEG
+std::shared_ptr<const ImageDecoder> turbojpeg_decoder() { return {}; }
+#endif
+
+} // namespace nucleus::utils
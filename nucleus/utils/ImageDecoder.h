@@ -0,0 +1,59 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <memory>
+#include <nucleus/Raster.h>
+#include <tl/expected.hpp>
+
+namespace nucleus::utils {
+
+enum class ImageFormat { Unknown, Jpeg, Png };
+
+/// by magic bytes
+[[nodiscard]] ImageFormat detect_image_format(const QByteArray& bytes);
+
+/// 1, 2, 4 or 8 if target_size is image_size divided by that factor, 0 otherwise
+[[nodiscard]] unsigned downscale_factor(const glm::uvec2& image_size, const glm::uvec2& target_size);
+
+/// Decoder backend for image_loader. stb_image is always available, libjpeg-turbo if found at configure time
+/// (ALP_ENABLE_TURBOJPEG). Implementations must be thread safe, the schedulers decode on their own threads.
+class ImageDecoder {
+public:
+    virtual ~ImageDecoder() = default;
+    [[nodiscard]] virtual QString name() const = 0;
+    [[nodiscard]] virtual tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QByteArray& bytes) const = 0;
+    /// The view may be the image size divided by 2, 4 or 8 (see downscale_factor), fails for any other size.
+    /// jpeg decoders scale in the DCT (cheaper than a full decode), others downsample after decoding.
+    [[nodiscard]] virtual tl::expected<void, QString> rgba8_into(const QByteArray& bytes, RasterView<glm::u8vec4> target) const = 0;
+};
+
+[[nodiscard]] std::shared_ptr<const ImageDecoder> stb_image_decoder();
+/// nullptr if nucleus was built without libjpeg-turbo
+[[nodiscard]] std::shared_ptr<const ImageDecoder> turbojpeg_decoder();
+
+/// decoder used by image_loader for the given format. defaults to libjpeg-turbo for jpeg (if available) and stb_image otherwise.
+[[nodiscard]] std::shared_ptr<const ImageDecoder> image_decoder(ImageFormat format);
+/// overrides the decoder for format. nullptr restores the default.
+void set_image_decoder(ImageFormat format, std::shared_ptr<const ImageDecoder> decoder);
+
+} // namespace nucleus::utils
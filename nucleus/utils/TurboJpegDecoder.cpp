@@ -0,0 +1,104 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include "ImageDecoder.h"
+
+#include <turbojpeg.h>
+
+namespace nucleus::utils {
+
+namespace {
+    // A tjhandle must not be used by several threads at once, so every thread gets its own.
+    tjhandle thread_handle()
+    {
+        struct Handle {
+            tjhandle handle = tjInitDecompress();
+            ~Handle()
+            {
+                if (handle)
+                    tjDestroy(handle);
+            }
+        };
+        thread_local Handle h;
+        return h.handle;
+    }
+
+    class TurboJpegDecoder : public ImageDecoder {
+    public:
+        QString name() const override { return "libjpeg-turbo"; }
+
+        tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QByteArray& bytes) const override
+        {
+            const auto size = header(bytes);
+            if (!size.has_value())
+                return tl::unexpected(size.error());
+            Raster<glm::u8vec4> raster(size.value());
+            const auto decoded = decode(bytes, raster.view());
+            if (!decoded.has_value())
+                return tl::unexpected(decoded.error());
+            return raster;
+        }
+
+        tl::expected<void, QString> rgba8_into(const QByteArray& bytes, RasterView<glm::u8vec4> target) const override
+        {
+            const auto size = header(bytes);
+            if (!size.has_value())
+                return tl::unexpected(size.error());
+            // tjDecompress2 picks the largest DCT scaling factor (1/2, 1/4, 1/8, ..) that fits the target
+            if (downscale_factor(size.value(), target.size()) == 0)
+                return tl::unexpected(QString("nucleus image_loader: Image size %1x%2 doesn't match target size %3x%4.").arg(size->x).arg(size->y).arg(target.width()).arg(target.height()));
+            return decode(bytes, target);
+        }
+
+    private:
+        static QString error(tjhandle handle) { return QString("nucleus image_loader (libjpeg-turbo): %1").arg(tjGetErrorStr2(handle)); }
+
+        static tl::expected<glm::uvec2, QString> header(const QByteArray& bytes)
+        {
+            tjhandle handle = thread_handle();
+            if (!handle)
+                return tl::unexpected(QString("nucleus image_loader: Couldn't initialise libjpeg-turbo."));
+            int width = 0, height = 0, subsampling = 0, colourspace = 0;
+            const auto* data = reinterpret_cast<const unsigned char*>(bytes.constData());
+            if (tjDecompressHeader3(handle, data, (unsigned long)bytes.size(), &width, &height, &subsampling, &colourspace) != 0)
+                return tl::unexpected(error(handle));
+            return glm::uvec2(width, height);
+        }
+
+        // decodes directly into target, honouring its stride (e.g. a quadrant of a quad texture) and scaling to its size
+        static tl::expected<void, QString> decode(const QByteArray& bytes, RasterView<glm::u8vec4> target)
+        {
+            tjhandle handle = thread_handle();
+            const auto* data = reinterpret_cast<const unsigned char*>(bytes.constData());
+            auto* out = reinterpret_cast<unsigned char*>(target.data());
+            const auto pitch = int(target.stride() * sizeof(glm::u8vec4));
+            if (tjDecompress2(handle, data, (unsigned long)bytes.size(), out, int(target.width()), pitch, int(target.height()), TJPF_RGBA, 0) != 0)
+                return tl::unexpected(error(handle));
+            return {};
+        }
+    };
+} // namespace
+
+std::shared_ptr<const ImageDecoder> turbojpeg_decoder()
+{
+    static const auto decoder = std::make_shared<const TurboJpegDecoder>();
+    return decoder;
+}
+
+} // namespace nucleus::utils
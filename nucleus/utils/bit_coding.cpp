@@ -0,0 +1,66 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include "bit_coding.h"
+
+#include <cassert>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ALP_BIT_CODING_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ALP_BIT_CODING_NEON
+#endif
+
+namespace nucleus::utils::bit_coding {
+
+void pack_red_green(const uint8_t* pixels, unsigned n_channels, size_t n_pixels, uint16_t* out)
+{
+    assert(n_channels == 3 || n_channels == 4);
+    size_t i = 0;
+    if (n_channels == 4) {
+#if defined(ALP_BIT_CODING_SSE2)
+        // 8 pixels per iteration. each 32 bit lane holds r | g << 8 | b << 16 | a << 24 (little endian).
+        const __m128i low_byte = _mm_set1_epi32(0xff);
+        const auto pack4 = [&](__m128i v) {
+            const __m128i red = _mm_slli_epi32(_mm_and_si128(v, low_byte), 8);
+            const __m128i green = _mm_and_si128(_mm_srli_epi32(v, 8), low_byte);
+            // sign extend from 16 bit, so that the saturating pack below keeps all bits.
+            return _mm_srai_epi32(_mm_slli_epi32(_mm_or_si128(red, green), 16), 16);
+        };
+        for (; i + 8 <= n_pixels; i += 8) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i * 4));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i * 4 + 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(pack4(a), pack4(b)));
+        }
+#elif defined(ALP_BIT_CODING_NEON)
+        for (; i + 8 <= n_pixels; i += 8) {
+            const uint8x8x4_t rgba = vld4_u8(pixels + i * 4);
+            vst1q_u16(out + i, vorrq_u16(vshll_n_u8(rgba.val[0], 8), vmovl_u8(rgba.val[1])));
+        }
+#endif
+    }
+    for (; i < n_pixels; ++i) {
+        const uint8_t* p = pixels + i * n_channels;
+        out[i] = uint16_t(p[0] << 8) | uint16_t(p[1]);
+    }
+}
+
+} // namespace nucleus::utils::bit_coding
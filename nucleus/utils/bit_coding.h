@@ -20,6 +20,7 @@
 
 #include <array>
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 
 #include <glm/glm.hpp>
@@ -44,4 +45,23 @@ inline uint32_t f8_4_to_u32(const glm::vec4& v)
     return (int(round(v[0] * 255.0f)) << 24) | (int(round(v[1] * 255.0f)) << 16) | (int(round(v[2] * 255.0f)) << 8) | int(round(v[3] * 255.0f));
 }
 
+/// interleaves the bits of x (even bits) and y (odd bits), which gives the position along the z-order (morton) curve
+inline uint64_t z_order(const glm::uvec2& v)
+{
+    const auto spread = [](uint32_t value) {
+        uint64_t x = value;
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+        x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+        x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+        x = (x | (x << 2)) & 0x3333333333333333ull;
+        x = (x | (x << 1)) & 0x5555555555555555ull;
+        return x;
+    };
+    return spread(v.x) | (spread(v.y) << 1);
+}
+
+/// packs red and green of interleaved 8 bit pixels into (red << 8 | green), skipping all other channels (alpine height encoding).
+/// n_channels must be 3 (RGB) or 4 (RGBA). Uses SSE2 / NEON for the RGBA case where available.
+void pack_red_green(const uint8_t* pixels, unsigned n_channels, size_t n_pixels, uint16_t* out);
+
 } // namespace nucleus::utils::bit_coding
@@ -19,6 +19,10 @@
 
 #include "image_loader.h"
 
+#include "BufferPool.h"
+#include "ImageDecoder.h"
+#include "bit_coding.h"
+
 // Limit the dimensions of images to 8192x8192. This is already quite restricting
 // in terms of that a lot of GPUs don't support textures that large. Make sure
 // you know what you are doing, before you change this value.
@@ -39,33 +43,75 @@
 #include <QFile>
 #include <tl/expected.hpp>
 
-namespace nucleus::utils::image_loader {
-
-tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QByteArray& byteArray)
+namespace nucleus::utils {
+
+namespace {
+    class StbImageDecoder : public ImageDecoder {
+    public:
+        QString name() const override { return "stb_image"; }
+
+        tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QByteArray& byteArray) const override
+        {
+            int width, height, channels;
+            const int requested_channels = 4; // Request 4 channels to always get RGBA8 images
+            const stbi_uc* source_data = reinterpret_cast<const stbi_uc*>(byteArray.constData());
+            unsigned char* data = stbi_load_from_memory(source_data, byteArray.size(), &width, &height, &channels, requested_channels);
+
+            if (data == nullptr) {
+                return tl::make_unexpected(QString("nucleus image_loader: Failed to decode image bytes."));
+            }
+
+            // The raster adopts stb's buffer, no copy is made. It is freed once the raster is destroyed.
+            return Raster<glm::u8vec4>(glm::uvec2(width, height), reinterpret_cast<glm::u8vec4*>(data), [](glm::u8vec4* p) { stbi_image_free(p); });
+        }
+
+        tl::expected<void, QString> rgba8_into(const QByteArray& byteArray, RasterView<glm::u8vec4> target) const override
+        {
+            int width, height, channels;
+            const stbi_uc* source_data = reinterpret_cast<const stbi_uc*>(byteArray.constData());
+            unsigned char* data = stbi_load_from_memory(source_data, byteArray.size(), &width, &height, &channels, 4);
+
+            if (data == nullptr) {
+                return tl::make_unexpected(QString("nucleus image_loader: Failed to decode image bytes."));
+            }
+            const auto size = glm::uvec2(width, height);
+            const auto factor = downscale_factor(size, target.size());
+            if (factor == 0) {
+                stbi_image_free(data);
+                return tl::make_unexpected(QString("nucleus image_loader: Image size %1x%2 doesn't match target size %3x%4.").arg(width).arg(height).arg(target.width()).arg(target.height()));
+            }
+            RasterView<const glm::u8vec4> level(reinterpret_cast<const glm::u8vec4*>(data), size);
+            if (factor == 1) {
+                nucleus::copy<glm::u8vec4>(level, target);
+            } else {
+                // no DCT scaling in stb, box filter the full decode instead
+                Raster<glm::u8vec4> scratch;
+                for (unsigned f = factor; f > 2; f /= 2) {
+                    Raster<glm::u8vec4> next(level.size() / 2u);
+                    nucleus::downsample<glm::u8vec4>(level, next.view());
+                    scratch = std::move(next);
+                    level = scratch.view();
+                }
+                nucleus::downsample<glm::u8vec4>(level, target);
+            }
+            stbi_image_free(data);
+
+            return {};
+        }
+    };
+} // namespace
+
+std::shared_ptr<const ImageDecoder> stb_image_decoder()
 {
-    int width, height, channels;
-    const int requested_channels = 4; // Request 4 channels to always get RGBA8 images
-    const stbi_uc* source_data = reinterpret_cast<const stbi_uc*>(byteArray.constData());
-    unsigned char* data = stbi_load_from_memory(
-        source_data,
-        byteArray.size(),
-        &width, &height, &channels,
-        requested_channels
-        );
+    static const auto decoder = std::make_shared<const StbImageDecoder>();
+    return decoder;
+}
 
-    if (data == nullptr) {
-        return tl::make_unexpected(QString("nucleus image_loader: Failed to decode image bytes."));
-    }
+} // namespace nucleus::utils
 
-    // NOTE: We copy the contents of the data pointer into a Raster object. Sadly
-    // we can't use the allocated memory directly, because for that we would need a custom
-    // allocator for the std::vector class.
-    Raster<glm::u8vec4> raster(glm::uvec2(width, height));
-    memcpy(raster.data(), data, raster.size_in_bytes());
-    stbi_image_free(data);
+namespace nucleus::utils::image_loader {
 
-    return raster;
-}
+tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QByteArray& byteArray) { return image_decoder(detect_image_format(byteArray))->rgba8(byteArray); }
 
 tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QString& filename)
 {
@@ -83,4 +129,34 @@ tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QString& filename)
 
 tl::expected<Raster<glm::u8vec4>, QString> rgba8(const char* filename) { return rgba8(QString(filename)); }
 
+tl::expected<void, QString> rgba8_into(const QByteArray& byteArray, RasterView<glm::u8vec4> target)
+{
+    return image_decoder(detect_image_format(byteArray))->rgba8_into(byteArray, target);
+}
+
+tl::expected<Raster<uint16_t>, QString> height_u16(const QByteArray& byteArray)
+{
+    int width, height, channels;
+    const stbi_uc* source_data = reinterpret_cast<const stbi_uc*>(byteArray.constData());
+    // Request the native channel count: height tiles are usually RGB, and forcing 4 channels would make stb
+    // run an additional expansion pass into a second buffer.
+    unsigned char* data = stbi_load_from_memory(source_data, byteArray.size(), &width, &height, &channels, 0);
+
+    if (data != nullptr && channels < 3) {
+        // grey (+ alpha) images are expanded by stb, so that red and green both hold the grey value (as with rgba8()).
+        stbi_image_free(data);
+        data = stbi_load_from_memory(source_data, byteArray.size(), &width, &height, &channels, 4);
+        channels = 4;
+    }
+    if (data == nullptr) {
+        return tl::make_unexpected(QString("nucleus image_loader: Failed to decode image bytes."));
+    }
+
+    auto raster = pooled_raster<uint16_t>(glm::uvec2(width, height));
+    bit_coding::pack_red_green(data, unsigned(channels), raster.buffer_length(), raster.data());
+    stbi_image_free(data);
+
+    return raster;
+}
+
 } // namespace nucleus::utils::image_loader
@@ -30,4 +30,14 @@ tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QByteArray& byteArray);
 tl::expected<Raster<glm::u8vec4>, QString> rgba8(const QString& filename);
 tl::expected<Raster<glm::u8vec4>, QString> rgba8(const char* filename);
 
+/// Decodes into target (e.g. a quadrant of a larger raster). The view may be the image size divided by 2, 4 or 8 for a
+/// reduced resolution decode (see ImageDecoder::rgba8_into), fails for any other size.
+tl::expected<void, QString> rgba8_into(const QByteArray& byteArray, RasterView<glm::u8vec4> target);
+
+/// Decodes an alpine height tile (red / green encoded PNG) directly into a uint16_t raster.
+/// Skips the RGBA8 raster (and the copy into it), the decoder's channel expansion for RGB PNGs
+/// and the separate conversion pass of rgba8() followed by tile::conversion::to_u16raster().
+/// Always decodes with stb_image (height tiles are png).
+tl::expected<Raster<uint16_t>, QString> height_u16(const QByteArray& byteArray);
+
 } // namespace nucleus::utils::image_loader
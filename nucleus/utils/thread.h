@@ -20,7 +20,14 @@
 
 #include <QMetaObject>
 #include <QObject>
+#include <QRunnable>
+#include <QSemaphore>
 #include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 namespace nucleus::utils::thread {
 
@@ -56,4 +63,43 @@ auto sync_call(QObject* context, Function&& fun) -> std::invoke_result_t<Functio
     return retval;
 }
 
+/// Calls fun(i) for every i in [0, n_items) on the global thread pool and returns once all calls finished.
+/// The calling thread takes items as well, and helpers that didn't start by then are taken back from the pool.
+/// A busy pool therefore only costs parallelism. fun must be safe to call concurrently for different items.
+template <typename Function> void parallel_for(unsigned n_items, const Function& fun)
+{
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+    auto* pool = QThreadPool::globalInstance();
+    const auto n_helpers = std::min(n_items, unsigned(std::max(pool->maxThreadCount(), 1))) - 1;
+    if (n_items > 1 && n_helpers > 0) {
+        std::atomic<unsigned> next_item = 0;
+        QSemaphore n_finished;
+        const auto work = [&]() {
+            for (unsigned i = next_item++; i < n_items; i = next_item++)
+                fun(i);
+        };
+        std::vector<std::unique_ptr<QRunnable>> helpers;
+        helpers.reserve(n_helpers);
+        for (unsigned h = 0; h < n_helpers; ++h) {
+            helpers.emplace_back(QRunnable::create([&]() {
+                work();
+                n_finished.release();
+            }));
+            helpers.back()->setAutoDelete(false);
+            pool->start(helpers.back().get());
+        }
+        work();
+        int n_started = 0;
+        for (const auto& helper : helpers) {
+            if (!pool->tryTake(helper.get()))
+                ++n_started;
+        }
+        n_finished.acquire(n_started);
+        return;
+    }
+#endif
+    for (unsigned i = 0; i < n_items; ++i)
+        fun(i);
+}
+
 } // namespace nucleus::utils::thread
@@ -69,18 +69,7 @@ nucleus::vector_tile::PointOfInterestCollection nucleus::vector_tile::parse::poi
             if (holds_alternative<double>(props["importance"]))
                 poi.importance = get<double>(props["importance"]);
 
-            double altitude = 0;
-            if (data_querier) {
-                const auto r = data_querier->get_altitude(lat_long);
-                if (r) {
-                    altitude = r.value();
-                } else {
-                    qWarning() << r.error() << QString(" (name: %1, id: %2, type: %3).").arg(poi.name).arg(poi.id).arg(unsigned(poi.type));
-                }
-            }
-
-            poi.lat_long_alt = glm::dvec3(lat_long.x, lat_long.y, altitude);
-            poi.world_space_pos = nucleus::srs::lat_long_alt_to_world(poi.lat_long_alt);
+            poi.lat_long_alt = glm::dvec3(lat_long.x, lat_long.y, 0.0);
 
             for (const auto& property : props) {
                 const auto name = property.first;
@@ -95,5 +84,25 @@ nucleus::vector_tile::PointOfInterestCollection nucleus::vector_tile::parse::poi
         }
     }
 
+    std::vector<glm::dvec2> lat_longs;
+    lat_longs.reserve(pois.size());
+    for (const auto& poi : pois)
+        lat_longs.emplace_back(poi.lat_long_alt.x, poi.lat_long_alt.y);
+    const auto altitudes = data_querier ? data_querier->get_altitudes(lat_longs) : std::vector<std::optional<float>>(pois.size());
+    for (size_t i = 0; i < pois.size(); ++i) {
+        auto& poi = pois[i];
+        if (altitudes[i]) {
+            poi.lat_long_alt.z = altitudes[i].value();
+        } else if (data_querier) {
+            qWarning() << QString("Couldn't find altitude for %1/%2 (name: %3, id: %4, type: %5).")
+                              .arg(poi.lat_long_alt.x)
+                              .arg(poi.lat_long_alt.y)
+                              .arg(poi.name)
+                              .arg(poi.id)
+                              .arg(unsigned(poi.type));
+        }
+        poi.world_space_pos = nucleus::srs::lat_long_alt_to_world(poi.lat_long_alt);
+    }
+
     return pois;
 }
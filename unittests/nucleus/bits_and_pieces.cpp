@@ -21,6 +21,10 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include "test_helpers.h"
+#include <QStandardPaths>
+#include <future>
+#include <nucleus/utils/ColourTexture.h>
+#include <nucleus/utils/FileLock.h>
 #include <nucleus/utils/image_loader.h>
 #include <nucleus/utils/thread.h>
 
@@ -68,12 +72,28 @@ TEST_CASE("nucleus/bits_and_pieces: image loading")
 
     const auto expected_black = nucleus::utils::image_loader::rgba8(test_helpers::black_png_tile(8));
     REQUIRE(expected_black);
+    CHECK(expected_black->is_adopted()); // stb_image's buffer is used without a copy
     const auto black = expected_black.value();
     REQUIRE(black.width() == 8);
     REQUIRE(black.height() == 8);
     for (const auto p : black.buffer()) {
         CHECK(p == glm::u8vec4(0, 0, 0, 255));
     }
+
+    nucleus::Raster<glm::u8vec4> quad(glm::uvec2(16, 16), glm::u8vec4(1, 2, 3, 4));
+    CHECK(nucleus::utils::image_loader::rgba8_into(test_helpers::black_png_tile(8), quad.view().sub_view({ 8, 0 }, { 8, 8 })));
+    CHECK(quad.pixel({ 7, 0 }) == glm::u8vec4(1, 2, 3, 4));
+    CHECK(quad.pixel({ 8, 0 }) == glm::u8vec4(0, 0, 0, 255));
+    CHECK(quad.pixel({ 15, 7 }) == glm::u8vec4(0, 0, 0, 255));
+    CHECK(quad.pixel({ 15, 8 }) == glm::u8vec4(1, 2, 3, 4));
+    CHECK(!nucleus::utils::image_loader::rgba8_into(test_helpers::black_png_tile(8), quad.view()));
+
+    // uncompressed colour textures keep the decoded storage
+    auto decoded = nucleus::utils::image_loader::rgba8(test_helpers::white_jpeg_tile(16)).value();
+    const auto* pixels = decoded.bytes();
+    const nucleus::utils::ColourTexture texture(std::move(decoded), nucleus::utils::ColourTexture::Format::Uncompressed_RGBA);
+    CHECK(texture.data() == pixels);
+    CHECK(texture.n_bytes() == 16 * 16 * 4);
 }
 
 TEST_CASE("nucleus/bits_and_pieces: nucleus::utils::thread::async_call")
@@ -140,3 +160,52 @@ TEST_CASE("nucleus/bits_and_pieces: nucleus::utils::thread::sync_call int")
     bg_thread.quit();
     bg_thread.wait(500); // msec
 }
+
+TEST_CASE("nucleus/bits_and_pieces: nucleus::utils::thread::parallel_for")
+{
+    for (const unsigned n : { 0u, 1u, 7u, 1000u }) {
+        std::vector<std::atomic<int>> calls(n);
+        nucleus::utils::thread::parallel_for(n, [&](unsigned i) { calls[i]++; });
+        for (const auto& c : calls)
+            CHECK(c == 1);
+    }
+
+    // blocked pool: the calling thread does all the work
+    auto* pool = QThreadPool::globalInstance();
+    std::promise<void> unblock;
+    auto blocker = unblock.get_future().share();
+    for (int i = 0; i < pool->maxThreadCount(); ++i)
+        pool->start([blocker]() { blocker.wait(); });
+    std::atomic<unsigned> sum = 0;
+    nucleus::utils::thread::parallel_for(100, [&](unsigned i) { sum += i; });
+    CHECK(sum == 4950);
+    unblock.set_value();
+    pool->waitForDone();
+}
+
+TEST_CASE("nucleus/bits_and_pieces: nucleus::utils::FileLock")
+{
+    using nucleus::utils::FileLock;
+    const auto path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_file_lock" / "lock";
+    SECTION("shared locks don't block each other")
+    {
+        auto a = FileLock::acquire(path, FileLock::Mode::Shared);
+        auto b = FileLock::acquire(path, FileLock::Mode::Shared);
+        REQUIRE(a.has_value());
+        REQUIRE(b.has_value());
+        CHECK(a->mode() == FileLock::Mode::Shared);
+    }
+#ifndef __EMSCRIPTEN__
+    SECTION("exclusive lock waits for shared locks to be released")
+    {
+        auto shared = std::make_optional(FileLock::acquire(path, FileLock::Mode::Shared));
+        REQUIRE(shared->has_value());
+        auto exclusive = std::async(std::launch::async, [&path]() { return FileLock::acquire(path, FileLock::Mode::Exclusive).has_value(); });
+        CHECK(exclusive.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout);
+        shared.reset();
+        REQUIRE(exclusive.wait_for(std::chrono::seconds(5)) == std::future_status::ready);
+        CHECK(exclusive.get());
+    }
+#endif
+    std::filesystem::remove_all(path.parent_path());
+}
@@ -16,12 +16,17 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *****************************************************************************/
 
+#include "nucleus/DataQuerier.h"
+#include "nucleus/srs.h"
 #include "nucleus/tile/Cache.h"
 #include "nucleus/tile/cache_quieries.h"
 #include "nucleus/tile/types.h"
 #include "radix/height_encoding.h"
 
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
+#include <random>
 
 #include <QBuffer>
 #include <QImage>
@@ -42,6 +47,22 @@ QByteArray png_tile(unsigned size, float altitude)
     return arr;
 }
 
+// altitude rises linearly from west to east, one column per step
+QByteArray png_tile_with_west_east_gradient(unsigned size, float west_altitude, float step)
+{
+    QImage tile(QSize { int(size), int(size) }, QImage::Format_ARGB32);
+    for (unsigned x = 0; x < size; ++x) {
+        const auto rgb = radix::height_encoding::to_rgb(west_altitude + float(x) * step);
+        for (unsigned y = 0; y < size; ++y)
+            tile.setPixelColor(int(x), int(y), QColor(rgb.x, rgb.y, rgb.z));
+    }
+    QByteArray arr;
+    QBuffer buffer(&arr);
+    buffer.open(QIODevice::WriteOnly);
+    tile.save(&buffer, "PNG");
+    return arr;
+}
+
 DataQuad example_tile_quad_for(const Id& id, float altitude)
 {
     const auto children = id.children();
@@ -75,3 +96,203 @@ TEST_CASE("cache_queries")
     CHECK(cache_queries::query_altitude(&cache, {-47.5587933, -12.3450985}) == 3000);
     CHECK(cache_queries::query_altitude(&cache, {47.5587933, 12.3450985}) == 2000);
 }
+
+TEST_CASE("DataQuerier")
+{
+    MemoryCache cache;
+    cache.insert(example_tile_quad_for(Id { 0, { 0, 0 } }, 1000.0f));
+    cache.insert(example_tile_quad_for(Id { 1, { 0, 0 } }, 3000.0f));
+
+    SECTION("matches uncached query")
+    {
+        nucleus::DataQuerier querier(&cache);
+        for (const auto lat_long : { glm::dvec2 { 47.5587933, -12.3450985 }, glm::dvec2 { -47.5587933, -12.3450985 }, glm::dvec2 { 47.5, 12.3 } }) {
+            CHECK(querier.get_altitude(lat_long) == cache_queries::query_altitude(&cache, lat_long));
+        }
+        CHECK(!querier.get_altitude({ 90.0, 0.0 }).has_value());
+    }
+
+    SECTION("repeated queries within a tile decode once")
+    {
+        nucleus::DataQuerier querier(&cache);
+        CHECK(querier.get_altitude({ -47.5587933, -12.3450985 }) == 3000);
+        CHECK(querier.get_altitude({ -47.6, -12.4 }) == 3000);
+        CHECK(querier.get_altitude({ -47.5, -12.3 }) == 3000);
+        CHECK(querier.statistics().n_misses == 1);
+        CHECK(querier.statistics().n_hits == 2);
+        CHECK(querier.n_decoded_tiles() == 1);
+    }
+
+    SECTION("replaced quads are decoded again")
+    {
+        nucleus::DataQuerier querier(&cache);
+        CHECK(querier.get_altitude({ -47.5587933, -12.3450985 }) == 3000);
+        cache.insert(example_tile_quad_for(Id { 1, { 0, 0 } }, 2000.0f));
+        CHECK(querier.get_altitude({ -47.5587933, -12.3450985 }) == 2000);
+        CHECK(querier.statistics().n_misses == 2);
+        CHECK(querier.n_decoded_tiles() == 1);
+    }
+
+    SECTION("least recently used tiles are evicted")
+    {
+        nucleus::DataQuerier querier(&cache, {}, 2);
+        const auto a = glm::dvec2 { -47.5587933, -12.3450985 };
+        const auto b = glm::dvec2 { -47.5587933, 12.3450985 };
+        const auto c = glm::dvec2 { 47.5587933, 12.3450985 };
+        CHECK(querier.get_altitude(a) == 3000);
+        CHECK(querier.get_altitude(b) == 1000);
+        CHECK(querier.get_altitude(a) == 3000); // b is now least recently used
+        CHECK(querier.get_altitude(c) == 1000);
+        CHECK(querier.n_decoded_tiles() == 2);
+        CHECK(querier.statistics().n_misses == 3);
+        CHECK(querier.get_altitude(a) == 3000);
+        CHECK(querier.statistics().n_hits == 2);
+        CHECK(querier.get_altitude(b) == 1000);
+        CHECK(querier.statistics().n_misses == 4);
+    }
+}
+
+TEST_CASE("DataQuerier batch queries")
+{
+    MemoryCache cache;
+    cache.insert(example_tile_quad_for(Id { 0, { 0, 0 } }, 1000.0f));
+    cache.insert(example_tile_quad_for(Id { 1, { 0, 0 } }, 3000.0f));
+    cache.insert(example_tile_quad_for(Id { 1, { 1, 1 } }, 1000.0f));
+    cache.insert(example_tile_quad_for(Id { 2, { 2, 2 } }, 1000.0f));
+    cache.insert(example_tile_quad_for(Id { 3, { 4, 5 } }, 1000.0f));
+    cache.insert(example_tile_quad_for(Id { 4, { 8, 10 } }, 2000.0f));
+    nucleus::DataQuerier querier(&cache);
+
+    SECTION("results are in input order and equal single queries")
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<double> lat(-80, 80);
+        std::uniform_real_distribution<double> lon(-179, 179);
+        std::vector<glm::dvec2> lat_longs;
+        for (unsigned i = 0; i < 500; ++i)
+            lat_longs.emplace_back(lat(rng), lon(rng));
+        lat_longs.emplace_back(47.5587933, 12.3450985);
+        lat_longs.emplace_back(90.0, 0.0);
+
+        const auto altitudes = querier.get_altitudes(lat_longs);
+        REQUIRE(altitudes.size() == lat_longs.size());
+        for (size_t i = 0; i < lat_longs.size(); ++i) {
+            const auto single = querier.get_altitude(lat_longs[i]);
+            REQUIRE(altitudes[i].has_value() == single.has_value());
+            if (single)
+                CHECK(altitudes[i].value() == single.value());
+        }
+        CHECK(altitudes[500] == 2000.0f);
+        CHECK(!altitudes[501].has_value());
+        CHECK(querier.get_altitudes({}).empty());
+    }
+
+    SECTION("every tile is decoded once per batch")
+    {
+        const auto lat_longs = std::vector<glm::dvec2> { { -47.5, -12.3 }, { 47.5587933, 12.3450985 }, { -47.6, -12.4 }, { 47.56, 12.35 } };
+        const auto altitudes = querier.get_altitudes(lat_longs);
+        CHECK(altitudes[0] == 3000.0f);
+        CHECK(altitudes[1] == 2000.0f);
+        CHECK(altitudes[2] == 3000.0f);
+        CHECK(altitudes[3] == 2000.0f);
+        CHECK(querier.statistics().n_misses == 2);
+        CHECK(querier.statistics().n_hits == 0);
+    }
+
+    SECTION("bilinear interpolation")
+    {
+        DataQuad quad = example_tile_quad_for(Id { 2, { 0, 0 } }, 0.0f);
+        const auto id = quad.tiles[3].id;
+        const auto gradient_tile = std::make_shared<QByteArray>(png_tile_with_west_east_gradient(65, 1000.0f, 10.0f));
+        for (auto& tile : quad.tiles)
+            tile.data = gradient_tile;
+        cache.insert(quad);
+
+        const auto bounds = nucleus::srs::tile_bounds(id);
+        const auto at = [&](double u, double v) { return bounds.min + glm::dvec2(u, v) * bounds.size(); };
+        const auto altitudes = querier.get_altitudes_world(std::vector { at(0, 0.5), at(1, 0.5), at(0.5, 0.1), at(1.5 / 64, 0.7) });
+        CHECK(altitudes[0].value() == Catch::Approx(1000.0f).margin(0.2));
+        CHECK(altitudes[1].value() == Catch::Approx(1640.0f).margin(0.2));
+        CHECK(altitudes[2].value() == Catch::Approx(1320.0f).margin(0.2));
+        CHECK(altitudes[3].value() == Catch::Approx(1015.0f).margin(0.2)); // between two columns
+    }
+
+    SECTION("benchmark")
+    {
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<double> lat(-60, 60);
+        std::uniform_real_distribution<double> lon(-170, 170);
+        std::vector<glm::dvec2> lat_longs;
+        for (unsigned i = 0; i < 100'000; ++i)
+            lat_longs.emplace_back(lat(rng), lon(rng));
+        BENCHMARK("get_altitudes (100k points)") { return querier.get_altitudes(lat_longs); };
+        BENCHMARK("get_altitude (1k points)")
+        {
+            float sum = 0;
+            for (unsigned i = 0; i < 1000; ++i)
+                sum += querier.get_altitude(lat_longs[i]).value_or(0);
+            return sum;
+        };
+    }
+}
+
+TEST_CASE("HeightSurfaceRegistry")
+{
+    const auto id = Id { 1, { 0, 0 } };
+    const auto data = std::make_shared<QByteArray>(png_tile(65, 1000.0f));
+    HeightSurfaceRegistry registry;
+
+    SECTION("decodes once and shares")
+    {
+        const auto a = registry.get_or_decode(id, data);
+        const auto b = registry.get_or_decode(id, data);
+        REQUIRE(a);
+        CHECK(a == b);
+        CHECK(a->size() == glm::uvec2(65, 65));
+        CHECK(registry.statistics().n_decoded == 1);
+        CHECK(registry.statistics().n_shared == 1);
+        CHECK(registry.find(id, data) == a);
+        CHECK(registry.n_alive() == 1);
+    }
+
+    SECTION("replaced data is decoded again")
+    {
+        const auto a = registry.get_or_decode(id, data);
+        const auto replacement = std::make_shared<QByteArray>(png_tile(65, 2000.0f));
+        CHECK(!registry.find(id, replacement));
+        const auto b = registry.get_or_decode(id, replacement);
+        CHECK(a != b);
+        CHECK(registry.statistics().n_decoded == 2);
+    }
+
+    SECTION("entries die with the last consumer")
+    {
+        auto a = registry.get_or_decode(id, data);
+        a.reset();
+        CHECK(registry.n_alive() == 0);
+        CHECK(!registry.find(id, data));
+    }
+
+    SECTION("a faster consumer wins")
+    {
+        const auto a = registry.get_or_decode(id, data);
+        const auto b = registry.insert(id, data, std::make_shared<const nucleus::Raster<uint16_t>>(glm::uvec2(65, 65), uint16_t(0)));
+        CHECK(a == b);
+    }
+
+    SECTION("DataQuerier uses surfaces decoded by other consumers")
+    {
+        MemoryCache cache;
+        cache.insert(example_tile_quad_for(Id { 0, { 0, 0 } }, 1000.0f));
+        const auto shared_registry = std::make_shared<HeightSurfaceRegistry>();
+        const auto quad = cache.peak_at(Id { 0, { 0, 0 } });
+        std::vector<HeightSurfaceRegistry::Surface> surfaces; // e.g. held by GeometryScheduler
+        for (const auto& tile : quad.tiles)
+            surfaces.push_back(shared_registry->get_or_decode(tile.id, tile.data));
+
+        nucleus::DataQuerier querier(&cache, shared_registry);
+        CHECK(querier.get_altitude({ -47.5, -12.3 }) == 1000);
+        CHECK(shared_registry->statistics().n_decoded == 4);
+        CHECK(shared_registry->statistics().n_shared == 1);
+    }
+}
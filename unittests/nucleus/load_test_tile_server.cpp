@@ -0,0 +1,87 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include <QImage>
+#include <QSignalSpy>
+#include <catch2/catch_test_macros.hpp>
+
+#include "TileServer.h"
+#include "nucleus/tile/TileLoadService.h"
+
+using namespace nucleus::tile;
+
+namespace {
+Data load(TileLoadService& service, const Id& id)
+{
+    QSignalSpy spy(&service, &TileLoadService::load_finished);
+    service.load(id);
+    spy.wait(10000);
+    REQUIRE(spy.count() == 1);
+    return spy.takeFirst().at(0).value<Data>();
+}
+} // namespace
+
+TEST_CASE("load_test/TileServer")
+{
+    load_test::TileServer::Settings settings;
+    settings.max_zoom_level = 10;
+
+    SECTION("serves generated height and ortho tiles")
+    {
+        load_test::TileServer server(settings);
+        REQUIRE(server.listen());
+        TileLoadService geometry(server.base_url() + "geometry/", TileLoadService::UrlPattern::ZXY, ".png");
+        TileLoadService ortho(server.base_url() + "ortho/", TileLoadService::UrlPattern::ZYX_yPointingSouth, ".jpeg");
+
+        const auto height_tile = load(geometry, { 5, { 17, 20 } });
+        CHECK(height_tile.network_info.status == NetworkInfo::Status::Good);
+        CHECK(QImage::fromData(*height_tile.data).size() == QSize(65, 65));
+
+        const auto ortho_tile = load(ortho, { 5, { 17, 20 } });
+        CHECK(ortho_tile.network_info.status == NetworkInfo::Status::Good);
+        CHECK(QImage::fromData(*ortho_tile.data).size() == QSize(256, 256));
+
+        // generated tiles are deterministic
+        CHECK(*load(geometry, { 5, { 17, 20 } }).data == *height_tile.data);
+
+        CHECK(server.statistics().n_requests == 3);
+        CHECK(server.statistics().n_good == 3);
+    }
+
+    SECTION("answers tiles beyond the max zoom level with 404")
+    {
+        load_test::TileServer server(settings);
+        REQUIRE(server.listen());
+        TileLoadService geometry(server.base_url() + "geometry/", TileLoadService::UrlPattern::ZXY, ".png");
+        const auto tile = load(geometry, { 11, { 0, 0 } });
+        CHECK(tile.network_info.status == NetworkInfo::Status::NotFound);
+        CHECK(server.statistics().n_not_found == 1);
+    }
+
+    SECTION("injects errors")
+    {
+        settings.error_rate = 1;
+        load_test::TileServer server(settings);
+        REQUIRE(server.listen());
+        TileLoadService geometry(server.base_url() + "geometry/", TileLoadService::UrlPattern::ZXY, ".png");
+        const auto tile = load(geometry, { 3, { 1, 1 } });
+        CHECK(tile.network_info.status == NetworkInfo::Status::NetworkError);
+        CHECK(server.statistics().n_errors == 1);
+    }
+}
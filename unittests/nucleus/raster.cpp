@@ -18,6 +18,9 @@
 
 #include "catch2_helpers.h"
 
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <random>
+
 #include <glm/glm.hpp>
 
 #include "nucleus/Raster.h"
@@ -67,6 +70,91 @@ TEST_CASE("nucleus/Raster")
         CHECK(raster.height() == 1);
     }
 
+    SECTION("adopted storage")
+    {
+        int n_deleted = 0;
+        {
+            auto* buffer = new uint16_t[6] { 1, 2, 3, 4, 5, 6 };
+            Raster<uint16_t> raster(glm::uvec2(3, 2), buffer, [&n_deleted](uint16_t* p) {
+                delete[] p;
+                ++n_deleted;
+            });
+            CHECK(raster.is_adopted());
+            CHECK(raster.data() == buffer);
+            CHECK(raster.buffer_length() == 6);
+            CHECK(raster.pixel({ 2, 1 }) == 6);
+
+            const Raster<uint16_t> copy = raster;
+            CHECK(!copy.is_adopted());
+            CHECK(copy.data() != buffer);
+            CHECK(std::ranges::equal(copy.buffer(), raster.buffer()));
+
+            const Raster<uint16_t> moved = std::move(raster);
+            CHECK(moved.data() == buffer);
+            CHECK(raster.buffer_length() == 0);
+            CHECK(n_deleted == 0);
+
+            Raster<uint16_t> appended = Raster<uint16_t>(glm::uvec2(3, 1), new uint16_t[3] { 7, 8, 9 }, [&n_deleted](uint16_t* p) {
+                delete[] p;
+                ++n_deleted;
+            });
+            appended.append_vertically(copy);
+            CHECK(!appended.is_adopted());
+            CHECK(n_deleted == 1);
+            CHECK(appended.size() == glm::uvec2(3, 3));
+            CHECK(appended.pixel({ 0, 0 }) == 7);
+            CHECK(appended.pixel({ 2, 2 }) == 6);
+        }
+        CHECK(n_deleted == 2);
+    }
+
+    SECTION("copy_into")
+    {
+        Raster<int> target(glm::uvec2(4, 4), 0);
+        const Raster<int> source(glm::uvec2(2, 2), 1);
+        copy_into(target, source, { 2, 1 });
+        CHECK(target.pixel({ 1, 1 }) == 0);
+        CHECK(target.pixel({ 2, 1 }) == 1);
+        CHECK(target.pixel({ 3, 2 }) == 1);
+        CHECK(target.pixel({ 3, 3 }) == 0);
+    }
+
+    SECTION("view")
+    {
+        Raster<int> raster(glm::uvec2(4, 3), 0);
+        const auto view = raster.view().sub_view({ 1, 1 }, { 2, 2 });
+        CHECK(view.size() == glm::uvec2(2, 2));
+        CHECK(view.stride() == 4);
+        CHECK(!view.is_contiguous());
+        view.pixel({ 1, 1 }) = 5;
+        CHECK(raster.pixel({ 2, 2 }) == 5);
+        CHECK(view.row(1) == &raster.pixel({ 1, 2 }));
+
+        const nucleus::RasterView<const int> const_view = view;
+        CHECK(const_view.pixel({ 1, 1 }) == 5);
+
+        const Raster<int> ones(glm::uvec2(2, 2), 1);
+        nucleus::copy<int>(ones.view(), view);
+        CHECK(raster.pixel({ 0, 0 }) == 0);
+        CHECK(raster.pixel({ 1, 1 }) == 1);
+        CHECK(raster.pixel({ 2, 2 }) == 1);
+        CHECK(raster.pixel({ 3, 2 }) == 0);
+    }
+
+    SECTION("downsample into a sub view")
+    {
+        Raster<int> source(glm::uvec2(4, 2), 0);
+        source.pixel({ 2, 0 }) = 4;
+        source.pixel({ 3, 1 }) = 8;
+        Raster<int> target(glm::uvec2(3, 3), -1);
+        nucleus::downsample<int>(source.view(), target.view().sub_view({ 1, 1 }, { 2, 1 }));
+        CHECK(target.pixel({ 0, 1 }) == -1);
+        CHECK(target.pixel({ 1, 1 }) == 0);
+        CHECK(target.pixel({ 2, 1 }) == 3);
+        CHECK(target.pixel({ 1, 0 }) == -1);
+        CHECK(target.pixel({ 1, 2 }) == -1);
+    }
+
     SECTION("write data")
     {
         Raster<int> raster(16);
@@ -178,7 +266,7 @@ TEST_CASE("nucleus/Raster")
         CHECK(mipmap.at(2).size() == glm::uvec2(1, 1));
 
         for (auto i = 0u; i < raster.buffer_length(); ++i) {
-            CHECK(mipmap.at(0).buffer().at(i) == raster.buffer().at(i));
+            CHECK(mipmap.at(0).buffer()[i] == raster.buffer()[i]);
         }
         CHECK(mipmap.at(1).pixel({ 0, 0 }) == glm::u8vec4(100u, 100u, 100u, 100u));
         CHECK(mipmap.at(1).pixel({ 0, 1 }) == glm::u8vec4(10u,   20u,  30u,  40u));
@@ -249,3 +337,82 @@ TEST_CASE("nucleus/Raster")
         CHECK(result.pixel({ 3, 1 }) == 657);
     }
 }
+
+namespace {
+template <typename T> T random_pixel(std::mt19937& rng)
+{
+    if constexpr (std::is_integral_v<T>)
+        return T(rng() & 0xffff);
+    else {
+        T v;
+        for (int i = 0; i < T::length(); ++i)
+            v[i] = uint8_t(rng());
+        return v;
+    }
+}
+
+template <typename T> Raster<T> random_raster(const glm::uvec2& size)
+{
+    std::mt19937 rng(42);
+    Raster<T> raster(size);
+    for (auto& p : raster)
+        p = random_pixel<T>(rng);
+    return raster;
+}
+
+template <typename T> void check_downsample_matches_scalar()
+{
+    // widths cover the vectorised blocks and the scalar tail
+    for (const unsigned width : { 1u, 3u, 8u, 9u, 16u, 21u, 256u }) {
+        auto source = random_raster<T>(glm::uvec2(width * 2, 6));
+        source.pixel({ 0, 0 }) = source.pixel({ 1, 0 }) = source.pixel({ 0, 1 }) = source.pixel({ 1, 1 }) = T(255u * 257u); // overflow check
+        Raster<T> target(glm::uvec2(width, 3));
+        nucleus::downsample<T>(source.view(), target.view());
+        for (unsigned j = 0; j < target.height(); ++j) {
+            for (unsigned i = 0; i < target.width(); ++i) {
+                const auto expected = nucleus::detail::avg(source.pixel({ i * 2, j * 2 }), source.pixel({ i * 2, j * 2 + 1 }), source.pixel({ i * 2 + 1, j * 2 }), source.pixel({ i * 2 + 1, j * 2 + 1 }));
+                REQUIRE(target.pixel({ i, j }) == expected);
+            }
+        }
+    }
+}
+
+template <typename T> std::vector<Raster<T>> scalar_mipmap(Raster<T> raster)
+{
+    std::vector<Raster<T>> mipmap;
+    mipmap.push_back(std::move(raster));
+    while (mipmap.back().width() > 1) {
+        const auto& u = mipmap.back();
+        Raster<T> r(u.size() / 2u);
+        for (unsigned i = 0u; i < r.width(); ++i) {
+            for (unsigned j = 0u; j < r.height(); ++j) {
+                r.pixel({ i, j }) = nucleus::detail::avg(u.pixel({ i * 2, j * 2 }), u.pixel({ i * 2, j * 2 + 1 }), u.pixel({ i * 2 + 1, j * 2 }), u.pixel({ i * 2 + 1, j * 2 + 1 }));
+            }
+        }
+        mipmap.push_back(std::move(r));
+    }
+    return mipmap;
+}
+} // namespace
+
+TEST_CASE("nucleus/Raster downsample kernels")
+{
+    SECTION("u8vec4") { check_downsample_matches_scalar<glm::u8vec4>(); }
+    SECTION("u8vec2") { check_downsample_matches_scalar<glm::u8vec2>(); }
+    SECTION("uint16_t") { check_downsample_matches_scalar<uint16_t>(); }
+    SECTION("int (scalar only)") { check_downsample_matches_scalar<int>(); }
+}
+
+TEST_CASE("nucleus/Raster benchmarks")
+{
+    const auto rgba = random_raster<glm::u8vec4>({ 512, 512 });
+    const auto rg = random_raster<glm::u8vec2>({ 512, 512 });
+    const auto height = random_raster<uint16_t>({ 512, 512 });
+
+    BENCHMARK("generate_mipmap u8vec4 512 (scalar, column major reference)") { return scalar_mipmap(rgba); };
+    BENCHMARK("generate_mipmap u8vec4 512") { return generate_mipmap(rgba); };
+    BENCHMARK("generate_mipmap u8vec2 512 (scalar, column major reference)") { return scalar_mipmap(rg); };
+    BENCHMARK("generate_mipmap u8vec2 512") { return generate_mipmap(rg); };
+    BENCHMARK("generate_mipmap uint16_t 512 (scalar, column major reference)") { return scalar_mipmap(height); };
+    BENCHMARK("generate_mipmap uint16_t 512") { return generate_mipmap(height); };
+}
@@ -479,4 +479,84 @@ TEST_CASE("nucleus/tile/cache")
         }
         std::filesystem::remove_all(path);
     }
+
+    SECTION("disk cache is shared between caches of several processes") {
+        const auto path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_tile_cache";
+        std::filesystem::remove_all(path);
+        {
+            Cache<DiskWriteTestTile> process_a;
+            Cache<DiskWriteTestTile> process_b;
+            process_a.insert(create_test_tile({ 0, { 0, 0 } }));
+            process_a.insert(create_test_tile({ 1, { 0, 0 } }));
+            CHECK(process_a.write_to_disk(path).has_value());
+
+            process_b.insert(create_test_tile({ 2, { 0, 0 } }));
+            CHECK(process_b.write_to_disk(path).has_value());
+
+            // tiles of a are not dropped from the index by b
+            Cache<DiskWriteTestTile> process_c;
+            CHECK(process_c.read_from_disk(path).has_value());
+            CHECK(process_c.n_cached_objects() == 3);
+
+            // tiles written by a become cache hits for b
+            const auto loaded = process_b.load_from_disk(path, { Id { 0, { 0, 0 } }, Id { 2, { 0, 0 } }, Id { 5, { 0, 0 } } });
+            REQUIRE(loaded.has_value());
+            REQUIRE(loaded->size() == 1);
+            CHECK(loaded->front() == Id { 0, { 0, 0 } });
+            verify_tile(process_b, { 0, { 0, 0 } });
+            CHECK(process_b.n_cached_objects() == 2);
+
+            // b writes again, tiles of a stay
+            CHECK(process_b.write_to_disk(path).has_value());
+            Cache<DiskWriteTestTile> process_d;
+            CHECK(process_d.read_from_disk(path).has_value());
+            CHECK(process_d.n_cached_objects() == 3);
+            verify_tile(process_d, { 1, { 0, 0 } });
+        }
+        std::filesystem::remove_all(path);
+    }
+
+    SECTION("disk cache keeps the most recently visited tiles up to the capacity") {
+        const auto path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_tile_cache";
+        std::filesystem::remove_all(path);
+        {
+            Cache<DiskWriteTestTile> process_a;
+            process_a.insert(create_test_tile({ 3, { 0, 0 } }));
+            process_a.insert(create_test_tile({ 2, { 0, 0 } }));
+            CHECK(process_a.write_to_disk(path, 3).has_value());
+
+            Cache<DiskWriteTestTile> process_b;
+            process_b.insert(create_test_tile({ 1, { 0, 0 } }));
+            process_b.insert(create_test_tile({ 0, { 0, 0 } }));
+            CHECK(process_b.write_to_disk(path, 3).has_value());
+
+            Cache<DiskWriteTestTile> process_c;
+            CHECK(process_c.read_from_disk(path).has_value());
+            CHECK(process_c.n_cached_objects() == 3);
+            CHECK(!process_c.contains({ 3, { 0, 0 } }));
+            CHECK(!std::filesystem::exists(path / "3_0_0.alp_tile"));
+
+            Cache<DiskWriteTestTile> process_d;
+            CHECK(process_d.read_from_disk(path, 2).has_value());
+            CHECK(process_d.n_cached_objects() == 2);
+            verify_tile(process_d, { 0, { 0, 0 } });
+            verify_tile(process_d, { 1, { 0, 0 } });
+
+            // tiles that were not read back are not removed from disk on the next write
+            CHECK(process_d.write_to_disk(path, 3).has_value());
+            Cache<DiskWriteTestTile> process_e;
+            CHECK(process_e.read_from_disk(path).has_value());
+            CHECK(process_e.n_cached_objects() == 3);
+        }
+        std::filesystem::remove_all(path);
+    }
+
+    SECTION("loading from a missing disk cache is not an error") {
+        const auto path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_tile_cache";
+        std::filesystem::remove_all(path);
+        Cache<DiskWriteTestTile> cache;
+        const auto loaded = cache.load_from_disk(path, { Id { 0, { 0, 0 } } });
+        REQUIRE(loaded.has_value());
+        CHECK(loaded->empty());
+    }
 }
@@ -17,10 +17,14 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  *****************************************************************************/
 
+#include <QBuffer>
 #include <QFile>
+#include <QImage>
+#include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 
 #include "nucleus/tile/conversion.h"
+#include "nucleus/utils/bit_coding.h"
 #include "nucleus/utils/image_loader.h"
 
 namespace {
@@ -112,4 +116,67 @@ TEST_CASE("nucleus/utils/tile_conversion")
         CHECK(u16_raster.buffer()[0] == 3744);
         CHECK(u16_raster.buffer()[1] == 3718);
     }
+
+    SECTION("pack red green (rgba and rgb, including non multiple of 8 tails)")
+    {
+        for (const unsigned n_channels : { 3u, 4u }) {
+            for (const size_t n_pixels : { size_t(0), size_t(1), size_t(7), size_t(8), size_t(17), size_t(65 * 65) }) {
+                std::vector<uint8_t> pixels(n_pixels * n_channels);
+                for (size_t i = 0; i < pixels.size(); ++i)
+                    pixels[i] = uint8_t(i * 37 + 11);
+                std::vector<uint16_t> packed(n_pixels);
+                nucleus::utils::bit_coding::pack_red_green(pixels.data(), n_channels, n_pixels, packed.data());
+                for (size_t i = 0; i < n_pixels; ++i) {
+                    const uint8_t* p = pixels.data() + i * n_channels;
+                    REQUIRE(packed[i] == nucleus::tile::conversion::alppineRedGreen2uint16(p[0], p[1]));
+                }
+            }
+        }
+    }
+
+    SECTION("direct height decode equals rgba8 + to_u16raster")
+    {
+        QFile file(QString("%1%2").arg(ALP_TEST_DATA_DIR, "test-tile.png"));
+        REQUIRE(file.open(QIODevice::ReadOnly));
+        const auto bytes = file.readAll();
+        const auto reference = nucleus::tile::conversion::to_u16raster(nucleus::utils::image_loader::rgba8(bytes).value());
+        const auto direct = nucleus::utils::image_loader::height_u16(bytes);
+        REQUIRE(direct.has_value());
+        CHECK(direct->size() == reference.size());
+        CHECK(std::ranges::equal(direct->buffer(), reference.buffer()));
+
+        CHECK(!nucleus::utils::image_loader::height_u16(QByteArray("not an image")).has_value());
+
+        // grey images (no red and green channels) decode as with rgba8 + to_u16raster
+        QImage image(7, 5, QImage::Format_Grayscale8);
+        for (int y = 0; y < image.height(); ++y) {
+            for (int x = 0; x < image.width(); ++x)
+                image.setPixel(x, y, qRgb(x * 30 + y, x * 30 + y, x * 30 + y));
+        }
+        QByteArray grey_bytes;
+        QBuffer buffer(&grey_bytes);
+        REQUIRE(buffer.open(QIODevice::WriteOnly));
+        REQUIRE(image.save(&buffer, "PNG"));
+        const auto grey_reference = nucleus::tile::conversion::to_u16raster(nucleus::utils::image_loader::rgba8(grey_bytes).value());
+        const auto grey_direct = nucleus::utils::image_loader::height_u16(grey_bytes);
+        REQUIRE(grey_direct.has_value());
+        CHECK(grey_direct->size() == glm::uvec2(7, 5));
+        CHECK(std::ranges::equal(grey_direct->buffer(), grey_reference.buffer()));
+    }
+}
+
+TEST_CASE("nucleus/tile/conversion benchmarks")
+{
+    QFile file(QString("%1%2").arg(ALP_TEST_DATA_DIR, "test-tile.png"));
+    REQUIRE(file.open(QIODevice::ReadOnly));
+    const auto bytes = file.readAll();
+
+    BENCHMARK("height tile: rgba8 + to_u16raster")
+    {
+        return nucleus::utils::image_loader::rgba8(bytes).map(nucleus::tile::conversion::to_u16raster);
+    };
+    BENCHMARK("height tile: height_u16") { return nucleus::utils::image_loader::height_u16(bytes); };
+
+    const auto rgba = nucleus::utils::image_loader::rgba8(bytes).value();
+    BENCHMARK("to_u16raster only") { return nucleus::tile::conversion::to_u16raster(rgba); };
 }
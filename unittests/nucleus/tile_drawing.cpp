@@ -17,11 +17,19 @@
  *****************************************************************************/
 
 #include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_approx.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <nucleus/camera/PositionStorage.h>
+#include <nucleus/tile/DrawListCache.h>
+#include <nucleus/tile/FrustumCuller.h>
+#include <nucleus/tile/GeometryScheduler.h>
 #include <nucleus/tile/drawing.h>
 #include <nucleus/tile/utils.h>
 #include <radix/TileHeights.h>
+#include <radix/height_encoding.h>
+#include <radix/quad_tree.h>
+#include <random>
+#include <unordered_set>
 
 using namespace radix;
 using namespace nucleus::tile;
@@ -44,6 +52,22 @@ TEST_CASE("tile/drawing")
             const auto limited = drawing::limit(list, 1024u);
             CHECK(limited.size() <= 1024u);
 
+            // every tile of the full list is covered by exactly one tile of the limited list
+            const auto limited_by_error = drawing::limit(list, 1024u, camera, aabb_decorator);
+            CHECK(limited_by_error.size() <= 1024u);
+            const std::unordered_set<tile::Id, tile::Id::Hasher> limited_set(limited_by_error.begin(), limited_by_error.end());
+            CHECK(limited_set.size() == limited_by_error.size());
+            unsigned n_not_covered_once = 0;
+            for (auto t : list) {
+                unsigned n_covering = unsigned(limited_set.contains(t));
+                while (t.zoom_level > 0) {
+                    t = t.parent();
+                    n_covering += unsigned(limited_set.contains(t));
+                }
+                n_not_covered_once += n_covering != 1;
+            }
+            CHECK(n_not_covered_once == 0);
+
             const auto tiles_with_bounds = drawing::compute_bounds(limited, aabb_decorator);
             tile_bound_lists.emplace_back(camera, tiles_with_bounds);
             // qDebug() << "list.size(): " << list.size();
@@ -76,6 +100,16 @@ TEST_CASE("tile/drawing")
         return tmp;
     };
 
+    BENCHMARK("limit (screen space error)")
+    {
+        std::vector<std::vector<tile::Id>> tmp;
+        tmp.reserve(lists.size());
+        for (const auto& [camera, list] : lists) {
+            tmp.push_back(drawing::limit(list, 1024u, camera, aabb_decorator));
+        }
+        return tmp;
+    };
+
     BENCHMARK("compute_aabbs")
     {
         std::vector<std::vector<TileBounds>> tmp;
@@ -106,3 +140,334 @@ TEST_CASE("tile/drawing")
         return tmp;
     };
 }
+
+TEST_CASE("tile/DrawListCache")
+{
+    TileHeights h;
+    h.emplace({ 0, { 0, 0 } }, { 100, 4000 });
+    const auto aabb_decorator = AabbDecorator::make(std::move(h));
+    auto camera = nucleus::camera::stored_positions::grossglockner();
+    camera.set_viewport_size({ 1920, 1080 });
+
+    DrawListCache cache(19, 1024);
+    const auto first = cache.get(camera, aabb_decorator, 0);
+    CHECK(cache.statistics().n_misses == 1);
+    CHECK(cache.statistics().n_hits == 0);
+    const auto reference = drawing::compute_bounds(drawing::limit(drawing::generate_list(camera, aabb_decorator, 19), 1024u, camera, aabb_decorator), aabb_decorator);
+    REQUIRE(first.tiles.size() == reference.size());
+    CHECK(first.visible.size() == drawing::cull(reference, camera).size());
+
+    SECTION("unchanged frames reuse the list")
+    {
+        const auto& second = cache.get(camera, aabb_decorator, 0);
+        CHECK(cache.statistics().n_hits == 1);
+        CHECK(second.visible.size() == first.visible.size());
+        cache.get(camera, aabb_decorator, 0);
+        CHECK(cache.statistics().hit_rate() == Catch::Approx(2.f / 3.f));
+    }
+    SECTION("camera, error threshold, decorator and tile set changes regenerate it")
+    {
+        cache.get(camera, aabb_decorator, 1);
+        CHECK(cache.statistics().n_misses == 2);
+        camera.move({ 0, 0, 100 });
+        cache.get(camera, aabb_decorator, 1);
+        CHECK(cache.statistics().n_misses == 3);
+        camera.set_pixel_error_threshold(camera.pixel_error_threshold() * 2);
+        const auto& coarser = cache.get(camera, aabb_decorator, 1);
+        CHECK(cache.statistics().n_misses == 4);
+        CHECK(coarser.tiles.size() <= first.tiles.size());
+        TileHeights other_heights;
+        other_heights.emplace({ 0, { 0, 0 } }, { 100, 4000 });
+        cache.get(camera, AabbDecorator::make(std::move(other_heights)), 1);
+        CHECK(cache.statistics().n_misses == 5);
+        cache.invalidate();
+        cache.get(camera, aabb_decorator, 1);
+        CHECK(cache.statistics().n_misses == 6);
+        CHECK(cache.statistics().n_hits == 0);
+    }
+}
+
+TEST_CASE("tile/FrustumCuller")
+{
+    TileHeights h;
+    h.emplace({ 0, { 0, 0 } }, { 100, 4000 });
+    const auto aabb_decorator = AabbDecorator::make(std::move(h));
+
+    std::vector<nucleus::camera::Definition> cameras;
+    std::vector<std::pair<nucleus::camera::Definition, std::vector<TileBounds>>> lists;
+    std::vector<TileBounds> all_bounds;
+    for (auto [name, camera] : nucleus::camera::PositionStorage::instance()->positions()) {
+        camera.set_viewport_size({ 1920, 1080 });
+        cameras.push_back(camera);
+        const auto bounds = drawing::compute_bounds(drawing::limit(drawing::generate_list(camera, aabb_decorator, 20), 1000u), aabb_decorator);
+        all_bounds.insert(all_bounds.end(), bounds.begin(), bounds.end());
+        lists.emplace_back(camera, bounds);
+    }
+    REQUIRE(!cameras.empty());
+
+    SECTION("gives the same result as the exact test")
+    {
+        // tiles of all cameras, so that there are boxes inside, outside and crossing each frustum
+        for (const auto& camera : cameras) {
+            const auto frustum = camera.frustum();
+            for (const auto& culler : { FrustumCuller(camera), FrustumCuller(frustum) }) {
+                CameraRelativeBounds relative_bounds(culler.origin());
+                for (const auto& t : all_bounds)
+                    relative_bounds.push_back(t.bounds);
+                std::vector<FrustumCuller::Result> results;
+                culler.classify(relative_bounds, &results);
+                REQUIRE(results.size() == all_bounds.size());
+
+                unsigned n_mismatches = 0;
+                for (size_t i = 0; i < all_bounds.size(); ++i) {
+                    const auto exact = utils::camera_frustum_contains_tile(frustum, all_bounds[i].bounds);
+                    n_mismatches += culler.resolve(results[i], all_bounds[i].bounds) != exact;
+                    if (results[i] != FrustumCuller::Result::Ambiguous)
+                        n_mismatches += (results[i] == FrustumCuller::Result::Inside) != exact;
+                }
+                CHECK(n_mismatches == 0);
+            }
+            const auto culled = drawing::cull(all_bounds, camera);
+            const auto n_visible = std::count_if(all_bounds.begin(), all_bounds.end(), [&](const TileBounds& t) { return utils::camera_frustum_contains_tile(frustum, t.bounds); });
+            CHECK(culled.size() == size_t(n_visible));
+        }
+    }
+
+    SECTION("boxes far away from the planes are decided without the exact test")
+    {
+        const auto camera = cameras.front();
+        const FrustumCuller culler(camera);
+        const auto p = camera.position();
+        const auto forward = -camera.z_axis();
+        CameraRelativeBounds relative_bounds(culler.origin());
+        relative_bounds.push_back({ p + forward * 1000.0 - glm::dvec3(1, 1, 1), p + forward * 1000.0 + glm::dvec3(1, 1, 1) });
+        relative_bounds.push_back({ p - forward * 1000.0 - glm::dvec3(1, 1, 1), p - forward * 1000.0 + glm::dvec3(1, 1, 1) });
+        std::vector<FrustumCuller::Result> results;
+        culler.classify(relative_bounds, &results);
+        CHECK(results[0] == FrustumCuller::Result::Inside);
+        CHECK(results[1] == FrustumCuller::Result::Outside);
+    }
+
+    BENCHMARK("cull 1000 tiles (exact)")
+    {
+        size_t n = 0;
+        for (const auto& [camera, list] : lists) {
+            const auto frustum = camera.frustum();
+            for (const auto& t : list)
+                n += utils::camera_frustum_contains_tile(frustum, t.bounds);
+        }
+        return n;
+    };
+
+    BENCHMARK("cull 1000 tiles (batched)")
+    {
+        size_t n = 0;
+        for (const auto& [camera, list] : lists)
+            n += drawing::cull(list, camera).size();
+        return n;
+    };
+}
+
+TEST_CASE("tile/utils/AabbTable")
+{
+    // complete pyramid down to {7, {68, 90}} (all siblings stored, like the generated height data)
+    TileHeights h;
+    h.emplace({ 0, { 0, 0 } }, { 100, 4000 });
+    const auto deepest = tile::Id { 7, { 68, 90 } };
+    for (unsigned z = 1; z <= deepest.zoom_level; ++z) {
+        const auto parent_coords = deepest.coords / (1u << (deepest.zoom_level - z + 1));
+        for (unsigned i = 0; i < 4; ++i) {
+            const auto coords = parent_coords * 2u + glm::uvec2(i % 2, i / 2);
+            h.emplace({ z, coords }, { 100.f + float(z * 50 + i * 10), 4000.f - float(z * 200 + i * 10) });
+        }
+    }
+    const auto aabb_decorator = AabbDecorator::make(std::move(h));
+
+    std::vector<tile::Id> ids;
+    for (unsigned z = 0; z < 6; ++z) {
+        for (unsigned x = 0; x < (1u << z); ++x) {
+            for (unsigned y = 0; y < (1u << z); ++y)
+                ids.push_back({ z, { x, y } });
+        }
+    }
+    std::mt19937 rng(42);
+    for (unsigned i = 0; i < 20000; ++i) {
+        const auto z = std::uniform_int_distribution<unsigned>(6, 24)(rng);
+        auto coords = glm::uvec2(std::uniform_int_distribution<unsigned>(0, (1u << z) - 1)(rng), std::uniform_int_distribution<unsigned>(0, (1u << z) - 1)(rng));
+        if (i % 2) // at or below the stored tiles
+            coords = (deepest.coords / 2u) * (1u << (z - 6)) + coords % (1u << (z - 6));
+        ids.push_back({ z, coords });
+    }
+    for (auto [name, camera] : nucleus::camera::PositionStorage::instance()->positions()) {
+        camera.set_viewport_size({ 1920, 1080 });
+        const auto list = drawing::generate_list(camera, aabb_decorator, 20);
+        ids.insert(ids.end(), list.begin(), list.end());
+    }
+
+    SECTION("matches TileHeights")
+    {
+        for (const auto& id : ids) {
+            CAPTURE(id);
+            const auto table = aabb_decorator->aabb(id);
+            const auto reference = aabb_decorator->aabb_uncached(id);
+            CHECK(table.min == reference.min);
+            CHECK(table.max == reference.max);
+        }
+    }
+
+    SECTION("sparse height data gives conservative bounds")
+    {
+        TileHeights sparse;
+        sparse.emplace({ 0, { 0, 0 } }, { 100, 4000 });
+        sparse.emplace({ 5, { 17, 22 } }, { 500, 2500 }); // no stored ancestors between
+        const auto decorator = AabbDecorator::make(std::move(sparse));
+        for (const auto& id : ids) {
+            CAPTURE(id);
+            const auto table = decorator->aabb(id);
+            const auto reference = decorator->aabb_uncached(id);
+            CHECK(table.min.z <= reference.min.z);
+            CHECK(table.max.z >= reference.max.z);
+        }
+    }
+
+    BENCHMARK("aabb (table)")
+    {
+        float sum = 0;
+        for (const auto& id : ids)
+            sum += float(aabb_decorator->aabb(id).max.z);
+        return sum;
+    };
+
+    BENCHMARK("aabb (TileHeights)")
+    {
+        float sum = 0;
+        for (const auto& id : ids)
+            sum += float(aabb_decorator->aabb_uncached(id).max.z);
+        return sum;
+    };
+}
+
+TEST_CASE("tile/utils/AabbDecorator loaded heights")
+{
+    TileHeights h;
+    h.emplace({ 0, { 0, 0 } }, { 100, 4000 });
+    const auto aabb_decorator = AabbDecorator::make(std::move(h));
+    const auto id = tile::Id { 12, { 2200, 2800 } };
+    const auto reference = aabb_decorator->aabb_uncached(id);
+
+    SECTION("tighten the static bounds")
+    {
+        aabb_decorator->add_loaded_heights(id, 1000, 1500);
+        const auto aabb = aabb_decorator->aabb(id);
+        CHECK(aabb.min.x == reference.min.x);
+        CHECK(aabb.max.y == reference.max.y);
+        CHECK(aabb.min.z == 999.5);
+        CHECK(aabb.max.z < reference.max.z);
+        CHECK(aabb.max.z > 1500);
+        CHECK(aabb_decorator->aabb(tile::Id { 13, { 4400, 5600 } }).max.z == reference.max.z); // only the loaded tile
+
+        aabb_decorator->remove_loaded_heights(id);
+        CHECK(aabb_decorator->aabb(id).max.z == reference.max.z);
+        CHECK(!aabb_decorator->loaded_heights_of(id));
+    }
+
+    SECTION("never exceed the static bounds")
+    {
+        aabb_decorator->add_loaded_heights(id, 50, 5000);
+        CHECK(aabb_decorator->aabb(id).min.z == reference.min.z);
+        CHECK(aabb_decorator->aabb(id).max.z == reference.max.z);
+    }
+
+    SECTION("children replace the heights of their parent")
+    {
+        aabb_decorator->add_loaded_heights(id, 1000, 3000);
+        const auto children = id.children();
+        aabb_decorator->add_loaded_heights(children[0], 1200, 1400);
+        aabb_decorator->add_loaded_heights(children[1], 1100, 1300);
+        aabb_decorator->add_loaded_heights(children[2], 1300, 1500);
+        CHECK(aabb_decorator->loaded_heights_of(id) == std::make_pair(1000.f, 3000.f));
+        aabb_decorator->add_loaded_heights(children[3], 1250, 1350);
+        CHECK(aabb_decorator->loaded_heights_of(id) == std::make_pair(1100.f, 1500.f));
+
+        // propagates further up, once all siblings are known
+        const auto parent = tile::Id { 11, { 1100, 1400 } };
+        CHECK(!aabb_decorator->loaded_heights_of(parent));
+        for (const auto& sibling : parent.children()) {
+            if (sibling != id)
+                aabb_decorator->add_loaded_heights(sibling, 900, 1000);
+        }
+        CHECK(aabb_decorator->loaded_heights_of(parent) == std::make_pair(900.f, 1500.f));
+
+        aabb_decorator->remove_loaded_heights(children[3]);
+        CHECK(aabb_decorator->loaded_heights_of(id) == std::make_pair(1000.f, 3000.f));
+        CHECK(aabb_decorator->loaded_heights_of(parent) == std::make_pair(900.f, 3000.f));
+        aabb_decorator->remove_loaded_heights(id);
+        CHECK(!aabb_decorator->loaded_heights_of(id));
+        CHECK(!aabb_decorator->loaded_heights_of(parent));
+    }
+}
+
+TEST_CASE("tile/utils geometric error refinement")
+{
+    const auto to_altitude = [](uint16_t v) { return radix::height_encoding::to_float(glm::u8vec3(v >> 8, v & 255, 0)); };
+
+    SECTION("surface error")
+    {
+        nucleus::Raster<uint16_t> surface({ 65, 65 }, uint16_t(8000));
+        CHECK(GeometryScheduler::geometric_error(surface) == 0);
+
+        surface.pixel({ 3, 5 }) = 8080; // not a sample of the parent
+        CHECK(GeometryScheduler::geometric_error(surface) == to_altitude(8080) - to_altitude(8000));
+
+        surface.pixel({ 3, 5 }) = 8000;
+        surface.pixel({ 4, 6 }) = 8080; // sample of the parent, the error is on its interpolated neighbours
+        CHECK(GeometryScheduler::geometric_error(surface) == Catch::Approx((to_altitude(8080) - to_altitude(8000)) / 2));
+
+        for (unsigned y = 0; y < 65; ++y) { // slopes are represented exactly by the parent
+            for (unsigned x = 0; x < 65; ++x)
+                surface.pixel({ x, y }) = uint16_t(8000 + 4 * x + 8 * y);
+        }
+        CHECK(GeometryScheduler::geometric_error(surface) < 0.001f);
+    }
+
+    TileHeights h;
+    h.emplace({ 0, { 0, 0 } }, { 100, 4000 });
+    const auto aabb_decorator = AabbDecorator::make(std::move(h));
+
+    SECTION("errors are stored in decimetres, rounded up")
+    {
+        aabb_decorator->set_geometric_error({ 3, { 1, 2 } }, 12.34f);
+        CHECK(aabb_decorator->geometric_error({ 3, { 1, 2 } }) == 12.4f);
+        CHECK(!aabb_decorator->geometric_error({ 3, { 1, 3 } }));
+    }
+
+    SECTION("children errors are estimated from ancestors")
+    {
+        const auto id = tile::Id { 10, { 500, 700 } };
+        CHECK(!aabb_decorator->children_geometric_error(id));
+        aabb_decorator->set_geometric_error({ 8, { 125, 175 } }, 40.f);
+        CHECK(aabb_decorator->children_geometric_error(id) == 5.f);
+        aabb_decorator->set_geometric_error(id, 16.f);
+        CHECK(aabb_decorator->children_geometric_error(id) == 8.f);
+        const auto children = id.children();
+        aabb_decorator->set_geometric_error(children[0], 20.f);
+        CHECK(aabb_decorator->children_geometric_error(id) == 20.f);
+        for (const auto& child : children)
+            aabb_decorator->set_geometric_error(child, 1.f);
+        CHECK(aabb_decorator->children_geometric_error(id) == 1.f);
+    }
+
+    SECTION("flat terrain is not refined")
+    {
+        auto camera = nucleus::camera::stored_positions::grossglockner();
+        camera.set_viewport_size({ 1920, 1080 });
+        const auto count_tiles = [&](RefineCriterion criterion) {
+            return radix::quad_tree::onTheFlyTraverse(tile::Id { 0, { 0, 0 } }, tile::utils::refineFunctor(camera, aabb_decorator, 256, 18, criterion), [](const tile::Id& v) { return v.children(); }).size();
+        };
+        const auto screen_space_tiles = count_tiles(RefineCriterion::ScreenSpaceSize);
+        CHECK(count_tiles(RefineCriterion::GeometricError) == screen_space_tiles); // nothing known
+
+        aabb_decorator->set_geometric_error({ 6, { 34, 41 } }, 0.f); // flat around the camera (grossglockner is in 6/34/41)
+        CHECK(count_tiles(RefineCriterion::GeometricError) < screen_space_tiles);
+    }
+}
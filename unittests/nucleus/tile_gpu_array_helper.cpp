@@ -0,0 +1,69 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include <catch2/catch_test_macros.hpp>
+#include <nucleus/tile/GpuArrayHelper.h>
+
+using nucleus::tile::GpuArrayHelper;
+using nucleus::tile::Id;
+
+TEST_CASE("nucleus/tile/GpuArrayHelper")
+{
+    SECTION("tiles get distinct layers, parents are found")
+    {
+        GpuArrayHelper helper;
+        helper.set_tile_limit(4);
+        const auto a = helper.add_tile({ 0, { 0, 0 } });
+        const auto b = helper.add_tile({ 1, { 1, 1 } });
+        CHECK(a != b);
+        CHECK(helper.layer({ 2, { 2, 2 } }).id == Id { 1, { 1, 1 } });
+        CHECK(helper.layer({ 2, { 2, 2 } }).index == b);
+        helper.remove_tile({ 1, { 1, 1 } });
+        CHECK(helper.layer({ 2, { 2, 2 } }).index == a);
+        CHECK(helper.n_occupied() == 1);
+    }
+
+    SECTION("empty tiles share one layer")
+    {
+        GpuArrayHelper helper;
+        helper.set_tile_limit(3);
+        const auto first = helper.add_empty_tile({ 1, { 0, 0 } });
+        CHECK(first.is_new);
+        const auto second = helper.add_empty_tile({ 1, { 1, 0 } });
+        CHECK(!second.is_new);
+        CHECK(second.index == first.index);
+        CHECK(helper.n_empty() == 2);
+        CHECK(helper.layer({ 5, { 0, 0 } }).index == first.index);
+
+        // the shared layer takes a single slot
+        const auto a = helper.add_tile({ 1, { 0, 1 } });
+        const auto b = helper.add_tile({ 1, { 1, 1 } });
+        CHECK(a != first.index);
+        CHECK(b != first.index);
+
+        helper.remove_tile({ 1, { 0, 0 } });
+        helper.remove_tile({ 1, { 1, 0 } });
+        CHECK(helper.n_empty() == 0);
+        // slot is free again
+        const auto c = helper.add_tile({ 2, { 0, 0 } });
+        CHECK(c == first.index);
+        helper.remove_tile({ 2, { 0, 0 } });
+        CHECK(helper.add_empty_tile({ 1, { 0, 0 } }).is_new);
+    }
+}
@@ -20,6 +20,7 @@
 
 #include <algorithm>
 
+#include <QJsonObject>
 #include <QRegularExpression>
 #include <QSignalSpy>
 #include <catch2/catch_test_macros.hpp>
@@ -120,6 +121,43 @@ TEST_CASE("nucleus/tile/TileLoadService")
         }
     }
 
+    SECTION("statistics")
+    {
+        network::Histogram h;
+        CHECK(h.count() == 0);
+        CHECK(h.quantile(0.5) == 0);
+        for (uint64_t v : { 0u, 1u, 3u, 20u, 100u, 1000u })
+            h.add(v);
+        CHECK(h.count() == 6);
+        CHECK(h.sum() == 1124);
+        CHECK(h.max() == 1000);
+        CHECK(h.buckets()[0] == 1);
+        CHECK(h.buckets()[1] == 1);
+        CHECK(h.buckets()[2] == 1);
+        CHECK(h.quantile(0.5) == 3);
+        CHECK(h.quantile(1.0) == 1000);
+
+        network::Statistics stats;
+        stats.request_started("a.at");
+        stats.request_started("a.at");
+        stats.request_started("b.at");
+        CHECK(stats.total().n_in_flight == 3);
+        stats.request_finished("a.at", { NetworkInfo::Status::Good, 100, 20, 5000, false });
+        stats.request_finished("a.at", { NetworkInfo::Status::NotFound, 50, 40, 0, false });
+        stats.request_finished("b.at", { NetworkInfo::Status::NetworkError, 10, 10, 0, false });
+        CHECK(stats.total().n_in_flight == 0);
+        CHECK(stats.total().n_requests == 3);
+        CHECK(stats.total().n_bytes == 5000);
+        REQUIRE(stats.per_host().size() == 2);
+        CHECK(stats.per_host().at("a.at").n_good == 1);
+        CHECK(stats.per_host().at("a.at").n_not_found == 1);
+        CHECK(stats.per_host().at("b.at").n_network_error == 1);
+        const auto map = stats.to_variant_map();
+        CHECK(map.contains("net_total_latency_p50_ms"));
+        CHECK(map.value("net_b.at_n_network_error").toULongLong() == 1);
+        CHECK(stats.to_json()["hosts"].toObject().contains("a.at"));
+    }
+
     SECTION("download")
     {
         // https://mapsneu.wien.gv.at/basemap/bmaporthofoto30cm/normal/google3857/9/177/273.jpeg => should be a white tile
@@ -199,11 +237,19 @@ TEST_CASE("nucleus/tile/TileLoadService")
         TileLoadService service("https://bad_url_23a9sd25fds87jcs6k43l.at/tiles/alpine_png/",
                                 TileLoadService::UrlPattern::ZYX,
                                 ".png");
+        service.set_stats_interval(0);
         QSignalSpy spy(&service, &TileLoadService::load_finished);
+        QSignalSpy stats_spy(&service, &TileLoadService::stats_ready);
         Id unavailable_tile_id = { .zoom_level = 90, .coords = { 273, 177 } };
         service.load(unavailable_tile_id);
+        CHECK(service.statistics().total().n_in_flight == 1);
         spy.wait(10000);
 
+        CHECK(stats_spy.count() == 1);
+        CHECK(service.statistics().total().n_in_flight == 0);
+        CHECK(service.statistics().total().n_network_error == 1);
+        CHECK(service.statistics().per_host().contains("bad_url_23a9sd25fds87jcs6k43l.at"));
+
         REQUIRE(spy.count() == 1);
         QList<QVariant> arguments = spy.takeFirst();
         REQUIRE(arguments.size() == 1);
@@ -68,6 +68,7 @@ TEST_CASE("nucleus/tile/quad assembler")
         assembler.deliver_tile(good_tile({ 1, { 1, 1 } }, "dta 111"));
         CHECK(spy_loaded.size() == 1);
         CHECK(assembler.n_items_in_flight() == 0);
+        CHECK(assembler.wait_time_ms().count() == 1);
 
         auto loaded_tile = spy_loaded.constFirst().constFirst().value<DataQuad>();
         CHECK(loaded_tile.id == Id { 0, { 0, 0 } });
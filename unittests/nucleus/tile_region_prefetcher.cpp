@@ -0,0 +1,168 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <catch2/catch_test_macros.hpp>
+
+#include <nucleus/srs.h>
+#include <nucleus/tile/RegionPrefetcher.h>
+#include <nucleus/tile/utils.h>
+#include <radix/TileHeights.h>
+
+using namespace nucleus::tile;
+
+namespace {
+utils::AabbDecoratorPtr flat_aabb_decorator()
+{
+    radix::TileHeights h;
+    h.emplace({ 0, { 0, 0 } }, { 100, 4000 });
+    return utils::AabbDecorator::make(std::move(h));
+}
+
+PrefetchRegion grossglockner_region(unsigned max_zoom_level = 12)
+{
+    return PrefetchRegion::from_bounds("grossglockner", { 47.05, 12.65 }, { 47.10, 12.72 }, 0, max_zoom_level);
+}
+
+DataQuad quad_for(const Id& id)
+{
+    DataQuad quad;
+    quad.id = id;
+    quad.n_tiles = 4;
+    const auto children = id.children();
+    for (unsigned i = 0; i < 4; ++i) {
+        quad.tiles[i].id = children[i];
+        quad.tiles[i].network_info = { NetworkInfo::Status::Good, nucleus::utils::time_since_epoch() };
+        quad.tiles[i].data = std::make_shared<QByteArray>(QByteArray::number(i));
+    }
+    return quad;
+}
+} // namespace
+
+TEST_CASE("nucleus/tile/RegionPrefetcher")
+{
+    SECTION("region enumerates overlapping quads coarse to fine")
+    {
+        const auto region = grossglockner_region();
+        const auto quads = region.quads(flat_aabb_decorator(), 18);
+        REQUIRE(!quads.empty());
+        CHECK(quads.front() == Id { 0, { 0, 0 } });
+        for (unsigned i = 1; i < quads.size(); ++i)
+            CHECK(quads[i - 1].zoom_level <= quads[i].zoom_level);
+        CHECK(quads.back().zoom_level == 11);
+
+        const auto centre = nucleus::srs::lat_long_to_world({ 47.075, 12.685 });
+        for (const auto& id : quads) {
+            const auto bounds = nucleus::srs::tile_bounds(id);
+            // the region is small, so all quads up to level 7 contain it, and there are only few quads per level
+            if (id.zoom_level <= 7)
+                CHECK(bounds.contains(centre));
+        }
+        // the scheduler's max zoom level limits the region
+        CHECK(region.quads(flat_aabb_decorator(), 9).back().zoom_level == 8);
+    }
+
+    SECTION("region json round trip")
+    {
+        const auto region = grossglockner_region();
+        const auto copy = PrefetchRegion::from_json(region.to_json());
+        REQUIRE(copy.has_value());
+        CHECK(copy->name == region.name);
+        CHECK(copy->min_zoom_level == region.min_zoom_level);
+        CHECK(copy->max_zoom_level == region.max_zoom_level);
+        CHECK(copy->lat_long_polygon == region.lat_long_polygon);
+        CHECK(!PrefetchRegion::from_json(QJsonObject {}).has_value());
+    }
+
+    SECTION("store, load and progress")
+    {
+        QTemporaryDir dir;
+        RegionPrefetcher p(dir.path().toStdString());
+        QSignalSpy spy(&p, &RegionPrefetcher::progress_changed);
+        p.add(grossglockner_region(6), flat_aabb_decorator(), 18);
+        REQUIRE(spy.size() == 1);
+        const auto n_total = p.progress("grossglockner")->n_total;
+        CHECK(n_total == 6);
+        CHECK(p.progress("grossglockner")->n_done == 0);
+
+        const auto batch = p.next_batch(2, [](const Id&) { return false; });
+        REQUIRE(batch.size() == 2);
+        CHECK(batch[0] == Id { 0, { 0, 0 } });
+        CHECK(p.is_pending(batch[0]));
+
+        REQUIRE(p.store(quad_for(batch[0])).has_value());
+        CHECK(p.contains(batch[0]));
+        CHECK(!p.is_pending(batch[0]));
+        CHECK(p.progress("grossglockner")->n_done == 1);
+        CHECK(spy.size() == 2);
+
+        const auto loaded = p.load(batch[0]);
+        REQUIRE(loaded.has_value());
+        CHECK(loaded->id == batch[0]);
+        CHECK(loaded->n_tiles == 4);
+        CHECK(*loaded->tiles[3].data == QByteArray("3"));
+
+        // skipped quads (e.g., in flight) are not part of the batch
+        const auto next = p.next_batch(10, [&batch](const Id& id) { return id == batch[1]; });
+        CHECK(next.size() == n_total - 2);
+        CHECK(std::ranges::find(next, batch[0]) == next.end());
+        CHECK(std::ranges::find(next, batch[1]) == next.end());
+    }
+
+    SECTION("resumes after restart without the stored quads")
+    {
+        QTemporaryDir dir;
+        std::vector<Id> stored;
+        {
+            RegionPrefetcher p(dir.path().toStdString());
+            p.add(grossglockner_region(6), flat_aabb_decorator(), 18);
+            stored = p.next_batch(3, [](const Id&) { return false; });
+            for (const auto& id : stored)
+                REQUIRE(p.store(quad_for(id)).has_value());
+        }
+        RegionPrefetcher p(dir.path().toStdString());
+        CHECK(!p.progress("grossglockner").has_value());
+        REQUIRE(p.resume(flat_aabb_decorator(), 18).has_value());
+        REQUIRE(p.progress("grossglockner").has_value());
+        CHECK(p.progress("grossglockner")->n_done == 3);
+        for (const auto& id : stored) {
+            CHECK(p.contains(id));
+            CHECK(!p.is_pending(id));
+        }
+        const auto batch = p.next_batch(100, [](const Id&) { return false; });
+        CHECK(batch.size() == 3);
+        for (const auto& id : batch)
+            CHECK(std::ranges::find(stored, id) == stored.end());
+    }
+
+    SECTION("cancel forgets the region")
+    {
+        QTemporaryDir dir;
+        {
+            RegionPrefetcher p(dir.path().toStdString());
+            p.add(grossglockner_region(6), flat_aabb_decorator(), 18);
+            p.cancel("grossglockner");
+            CHECK(!p.progress("grossglockner").has_value());
+            CHECK(p.next_batch(100, [](const Id&) { return false; }).empty());
+        }
+        RegionPrefetcher p(dir.path().toStdString());
+        REQUIRE(p.resume(flat_aabb_decorator(), 18).has_value());
+        CHECK(!p.progress("grossglockner").has_value());
+    }
+}
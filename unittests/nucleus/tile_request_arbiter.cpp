@@ -0,0 +1,242 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#include <QSignalSpy>
+#include <QThread>
+#include <catch2/catch_test_macros.hpp>
+
+#include "nucleus/tile/RequestArbiter.h"
+#include "nucleus/tile/SlotLimiter.h"
+#include "nucleus/tile/types.h"
+#include "radix/tile.h"
+
+using namespace nucleus::tile;
+
+TEST_CASE("nucleus/tile/request arbiter")
+{
+    const auto by_zoom = [](const Id& id) { return 1.0f / float(1 + id.zoom_level); };
+
+    SECTION("slot budget is shared between layers")
+    {
+        RequestArbiter arbiter({ .slot_limit = 3 });
+        SlotLimiter geometry;
+        SlotLimiter ortho;
+        arbiter.attach("geometry", &geometry, 0, by_zoom);
+        arbiter.attach("ortho", &ortho, 0, by_zoom);
+        QSignalSpy geometry_spy(&geometry, &SlotLimiter::quad_requested);
+        QSignalSpy ortho_spy(&ortho, &SlotLimiter::quad_requested);
+
+        geometry.request_quads({ Id { 1, { 0, 0 } }, Id { 1, { 1, 0 } } });
+        ortho.request_quads({ Id { 1, { 0, 0 } }, Id { 1, { 1, 0 } } });
+        CHECK(geometry_spy.size() + ortho_spy.size() == 3);
+        CHECK(arbiter.statistics().n_in_flight == 3);
+        CHECK(arbiter.statistics().n_queued == 1);
+    }
+
+    SECTION("the per layer slot limit still applies")
+    {
+        RequestArbiter arbiter({ .slot_limit = 10 });
+        SlotLimiter geometry;
+        geometry.set_limit(2);
+        arbiter.attach("geometry", &geometry, 0, by_zoom);
+        QSignalSpy spy(&geometry, &SlotLimiter::quad_requested);
+        geometry.request_quads({ Id { 1, { 0, 0 } }, Id { 1, { 1, 0 } }, Id { 1, { 0, 1 } } });
+        CHECK(spy.size() == 2);
+        CHECK(geometry.slots_taken() == 2);
+    }
+
+    SECTION("higher layer rank goes first")
+    {
+        RequestArbiter arbiter({ .slot_limit = 2 });
+        SlotLimiter geometry;
+        SlotLimiter ortho;
+        arbiter.attach("ortho", &ortho, 0, by_zoom);
+        arbiter.attach("geometry", &geometry, 2, by_zoom);
+        QSignalSpy geometry_spy(&geometry, &SlotLimiter::quad_requested);
+        QSignalSpy ortho_spy(&ortho, &SlotLimiter::quad_requested);
+
+        // fill all slots, so that both queues are evaluated together after release
+        ortho.request_quads({ Id { 2, { 0, 0 } }, Id { 2, { 1, 0 } }, Id { 2, { 0, 1 } } });
+        REQUIRE(ortho_spy.size() == 2);
+        geometry.request_quads({ Id { 2, { 0, 0 } } });
+        CHECK(geometry_spy.size() == 0);
+
+        ortho.deliver_quad(DataQuad { Id { 2, { 0, 0 } } });
+        REQUIRE(geometry_spy.size() == 1);
+        CHECK(geometry_spy[0][0].value<Id>() == Id { 2, { 0, 0 } });
+        CHECK(ortho_spy.size() == 2);
+
+        geometry.deliver_quad(DataQuad { Id { 2, { 0, 0 } } });
+        REQUIRE(ortho_spy.size() == 3);
+        CHECK(ortho_spy[2][0].value<Id>() == Id { 2, { 0, 1 } });
+    }
+
+    SECTION("layer rank wins over importance, importance decides within equal rank")
+    {
+        RequestArbiter arbiter({ .slot_limit = 1 });
+        SlotLimiter geometry;
+        SlotLimiter ortho;
+        SlotLimiter labels;
+        arbiter.attach("geometry", &geometry, 2, [](const Id&) { return 0.001f; }); // small, far away quad
+        arbiter.attach("ortho", &ortho, 0, [](const Id& id) { return float(id.coords.x); }); // large, near quads
+        arbiter.attach("labels", &labels, 0, [](const Id& id) { return float(id.coords.x); });
+        QSignalSpy geometry_spy(&geometry, &SlotLimiter::quad_requested);
+        QSignalSpy ortho_spy(&ortho, &SlotLimiter::quad_requested);
+        QSignalSpy labels_spy(&labels, &SlotLimiter::quad_requested);
+
+        // occupy the only slot, so that all queues are evaluated together on release
+        ortho.request_quads({ Id { 3, { 100, 0 } } });
+        REQUIRE(ortho_spy.size() == 1);
+        ortho.request_quads({ Id { 3, { 100, 0 } }, Id { 3, { 50, 0 } } });
+        labels.request_quads({ Id { 3, { 60, 0 } } });
+        geometry.request_quads({ Id { 3, { 0, 0 } } });
+
+        ortho.deliver_quad(DataQuad { Id { 3, { 100, 0 } } });
+        REQUIRE(geometry_spy.size() == 1);
+        CHECK(ortho_spy.size() == 1);
+        CHECK(labels_spy.size() == 0);
+
+        geometry.deliver_quad(DataQuad { Id { 3, { 0, 0 } } });
+        REQUIRE(labels_spy.size() == 1);
+        CHECK(ortho_spy.size() == 1);
+
+        labels.deliver_quad(DataQuad { Id { 3, { 60, 0 } } });
+        REQUIRE(ortho_spy.size() == 2);
+        CHECK(ortho_spy[1][0].value<Id>() == Id { 3, { 50, 0 } });
+    }
+
+    SECTION("background requests of any layer go after all other requests")
+    {
+        RequestArbiter arbiter({ .slot_limit = 1, .starvation_timeout_msecs = 10 });
+        SlotLimiter geometry;
+        SlotLimiter ortho;
+        const auto prefetch = [](const Id& id) { return id.zoom_level == 10 ? RequestArbiter::background_importance : 1.0f; };
+        arbiter.attach("geometry", &geometry, 2, prefetch);
+        arbiter.attach("ortho", &ortho, 0, by_zoom);
+        QSignalSpy geometry_spy(&geometry, &SlotLimiter::quad_requested);
+        QSignalSpy ortho_spy(&ortho, &SlotLimiter::quad_requested);
+
+        // occupy the only slot, so that both queues are evaluated together on release
+        ortho.request_quads({ Id { 3, { 0, 0 } } });
+        REQUIRE(ortho_spy.size() == 1);
+        ortho.request_quads({ Id { 3, { 0, 0 } }, Id { 3, { 1, 0 } } });
+        geometry.request_quads({ Id { 10, { 0, 0 } }, Id { 10, { 1, 0 } } });
+        QThread::msleep(20); // background requests don't get starvation grants either
+
+        ortho.deliver_quad(DataQuad { Id { 3, { 0, 0 } } });
+        REQUIRE(ortho_spy.size() == 2);
+        CHECK(ortho_spy[1][0].value<Id>() == Id { 3, { 1, 0 } });
+        CHECK(geometry_spy.size() == 0);
+
+        // camera quads of the geometry layer still beat the background ones
+        geometry.request_quads({ Id { 10, { 0, 0 } }, Id { 10, { 1, 0 } }, Id { 4, { 0, 0 } } });
+        ortho.deliver_quad(DataQuad { Id { 3, { 1, 0 } } });
+        REQUIRE(geometry_spy.size() == 1);
+        CHECK(geometry_spy[0][0].value<Id>() == Id { 4, { 0, 0 } });
+
+        geometry.deliver_quad(DataQuad { Id { 4, { 0, 0 } } });
+        REQUIRE(geometry_spy.size() == 2);
+        CHECK(geometry_spy[1][0].value<Id>().zoom_level == 10);
+    }
+
+    SECTION("within a layer, more important quads go first")
+    {
+        RequestArbiter arbiter({ .slot_limit = 1 });
+        SlotLimiter ortho;
+        arbiter.attach("ortho", &ortho, 0, [](const Id& id) { return float(id.coords.x); });
+        QSignalSpy spy(&ortho, &SlotLimiter::quad_requested);
+        ortho.request_quads({ Id { 3, { 1, 0 } }, Id { 3, { 5, 0 } }, Id { 3, { 3, 0 } } });
+        REQUIRE(spy.size() == 1);
+        CHECK(spy[0][0].value<Id>() == Id { 3, { 5, 0 } });
+        ortho.deliver_quad(DataQuad { Id { 3, { 5, 0 } } });
+        REQUIRE(spy.size() == 2);
+        CHECK(spy[1][0].value<Id>() == Id { 3, { 3, 0 } });
+        ortho.deliver_quad(DataQuad { Id { 3, { 3, 0 } } });
+        REQUIRE(spy.size() == 3);
+        CHECK(spy[2][0].value<Id>() == Id { 3, { 1, 0 } });
+    }
+
+    SECTION("updated requests replace the queue and skip quads in flight")
+    {
+        RequestArbiter arbiter({ .slot_limit = 1 });
+        SlotLimiter ortho;
+        arbiter.attach("ortho", &ortho, 0, by_zoom);
+        QSignalSpy spy(&ortho, &SlotLimiter::quad_requested);
+        ortho.request_quads({ Id { 1, { 0, 0 } }, Id { 2, { 0, 0 } } });
+        REQUIRE(spy.size() == 1);
+        ortho.request_quads({ Id { 1, { 0, 0 } }, Id { 3, { 0, 0 } } });
+        CHECK(arbiter.statistics().n_queued == 1);
+        ortho.deliver_quad(DataQuad { Id { 1, { 0, 0 } } });
+        REQUIRE(spy.size() == 2);
+        CHECK(spy[1][0].value<Id>() == Id { 3, { 0, 0 } });
+    }
+
+    SECTION("starving layers are served")
+    {
+        RequestArbiter arbiter({ .slot_limit = 1, .starvation_timeout_msecs = 10 });
+        SlotLimiter geometry;
+        SlotLimiter ortho;
+        arbiter.attach("geometry", &geometry, 2, by_zoom);
+        arbiter.attach("ortho", &ortho, 0, by_zoom);
+        QSignalSpy geometry_spy(&geometry, &SlotLimiter::quad_requested);
+        QSignalSpy ortho_spy(&ortho, &SlotLimiter::quad_requested);
+
+        geometry.request_quads({ Id { 1, { 0, 0 } }, Id { 1, { 1, 0 } }, Id { 1, { 0, 1 } } });
+        ortho.request_quads({ Id { 1, { 0, 0 } } });
+        REQUIRE(geometry_spy.size() == 1);
+        QThread::msleep(20);
+        geometry.deliver_quad(DataQuad { Id { 1, { 0, 0 } } });
+        REQUIRE(ortho_spy.size() == 1);
+        CHECK(geometry_spy.size() == 1);
+        CHECK(arbiter.statistics().n_starvation_grants >= 1);
+    }
+
+    SECTION("rate budget is shared between layers")
+    {
+        RequestArbiter arbiter({ .slot_limit = 100, .rate = 3, .rate_period_msecs = 100'000 });
+        SlotLimiter geometry;
+        SlotLimiter ortho;
+        arbiter.attach("geometry", &geometry, 0, by_zoom);
+        arbiter.attach("ortho", &ortho, 0, by_zoom);
+        QSignalSpy geometry_spy(&geometry, &SlotLimiter::quad_requested);
+        QSignalSpy ortho_spy(&ortho, &SlotLimiter::quad_requested);
+        geometry.request_quads({ Id { 1, { 0, 0 } }, Id { 1, { 1, 0 } } });
+        ortho.request_quads({ Id { 1, { 0, 0 } }, Id { 1, { 1, 0 } } });
+        CHECK(geometry_spy.size() + ortho_spy.size() == 3);
+    }
+
+    SECTION("bandwidth is accounted on delivery")
+    {
+        RequestArbiter arbiter({ .slot_limit = 100, .bandwidth_bytes_per_second = 1000 });
+        SlotLimiter ortho;
+        arbiter.attach("ortho", &ortho, 0, by_zoom);
+        QSignalSpy spy(&ortho, &SlotLimiter::quad_requested);
+        ortho.request_quads({ Id { 1, { 0, 0 } } });
+        REQUIRE(spy.size() == 1);
+
+        DataQuad quad { Id { 1, { 0, 0 } }, 1, {} };
+        quad.tiles[0].data = std::make_shared<QByteArray>(5000, 'x');
+        ortho.deliver_quad(quad);
+        CHECK(arbiter.statistics().n_bytes == 5000);
+
+        // budget is used up for several seconds
+        ortho.request_quads({ Id { 2, { 0, 0 } } });
+        CHECK(spy.size() == 1);
+        CHECK(arbiter.statistics().n_queued == 1);
+    }
+}
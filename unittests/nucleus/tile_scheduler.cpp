@@ -27,7 +27,10 @@
 #include <catch2/benchmark/catch_benchmark.hpp>
 #include <catch2/catch_test_macros.hpp>
 #include <nucleus/camera/PositionStorage.h>
+#include <nucleus/tile/RegionPrefetcher.h>
+#include <nucleus/tile/RequestArbiter.h>
 #include <nucleus/tile/SchedulerDirector.h>
+#include <nucleus/tile/SlotLimiter.h>
 #include <nucleus/tile/TextureScheduler.h>
 #include <nucleus/tile/conversion.h>
 #include <nucleus/tile/types.h>
@@ -766,6 +769,49 @@ TEST_CASE("nucleus/tile/Scheduler")
         CHECK(spy[0][0].value<Id>() == Id { 0, { 0, 0 } });
         CHECK(spy[1][0].value<Id>() == Id { 1, { 1, 1 } });
     }
+
+    SECTION("offline regions are requested after the camera quads and served without network")
+    {
+        const auto region = PrefetchRegion::from_bounds("grossglockner", { 47.05, 12.65 }, { 47.10, 12.72 }, 0, 12);
+        const auto gg_quad = Id { 7, { 68, 83 } };
+        {
+            auto scheduler = default_scheduler();
+            std::filesystem::remove_all(scheduler->offline_store_path());
+            QSignalSpy spy(scheduler.get(), &Scheduler::quads_requested);
+            scheduler->update_camera(nucleus::camera::stored_positions::stephansdom());
+            scheduler->send_quad_requests();
+            scheduler->prefetch_region(region);
+            scheduler->send_quad_requests();
+            REQUIRE(spy.size() == 2);
+            const auto camera_quads = spy[0][0].value<std::vector<Id>>();
+            const auto quads = spy[1][0].value<std::vector<Id>>();
+            REQUIRE(quads.size() > camera_quads.size());
+            CHECK(quads.size() <= camera_quads.size() + Scheduler::Settings {}.prefetch_batch_size);
+            CHECK(std::equal(camera_quads.cbegin(), camera_quads.cend(), quads.cbegin()));
+            CHECK(std::find(quads.cbegin() + long(camera_quads.size()), quads.cend(), gg_quad) != quads.cend());
+            CHECK(scheduler->screen_space_importance(gg_quad) == RequestArbiter::background_importance);
+
+            QSignalSpy progress_spy(scheduler.get(), &Scheduler::prefetch_progress);
+            scheduler->receive_quad(example_tile_quad_for(gg_quad));
+            REQUIRE(progress_spy.size() == 1);
+            CHECK(progress_spy[0][0].toString() == "grossglockner");
+            CHECK(progress_spy[0][1].toUInt() == 1);
+            REQUIRE(scheduler->region_prefetcher());
+            CHECK(scheduler->region_prefetcher()->contains(gg_quad));
+        }
+        {
+            auto scheduler = default_scheduler();
+            REQUIRE(scheduler->resume_prefetch().has_value());
+            REQUIRE(scheduler->region_prefetcher());
+            CHECK(scheduler->region_prefetcher()->progress("grossglockner")->n_done == 1);
+            scheduler->set_network_reachability(QNetworkInformation::Reachability::Disconnected);
+            scheduler->update_camera(nucleus::camera::stored_positions::grossglockner());
+            CHECK(!scheduler->ram_cache().contains(gg_quad));
+            scheduler->send_quad_requests();
+            CHECK(scheduler->ram_cache().contains(gg_quad));
+            std::filesystem::remove_all(scheduler->offline_store_path());
+        }
+    }
 }
 
 TEST_CASE("nucleus/tile/Scheduler benchmarks")
@@ -864,6 +910,30 @@ TEST_CASE("nucleus/tile/TextureScheduler")
         const auto qimage = nucleus::tile::conversion::to_QImage(joined);
         qimage.save("merged.png");
     }
+
+    SECTION("quads without data share one texture")
+    {
+        auto scheduler = default_scheduler();
+        QSignalSpy spy(scheduler.get(), &TextureScheduler::gpu_tiles_updated);
+        for (const auto& id : { Id { 0, { 0, 0 } }, Id { 1, { 1, 1 } }, Id { 2, { 2, 2 } } }) {
+            auto quad = example_tile_quad_for(id);
+            if (id.zoom_level > 0) {
+                for (auto& tile : quad.tiles)
+                    tile.data->resize(0);
+            }
+            scheduler->receive_quad(quad);
+        }
+        scheduler->update_camera(nucleus::camera::stored_positions::stephansdom());
+        scheduler->update_gpu_quads();
+        REQUIRE(spy.size() == 1);
+        const auto gpu_tiles = spy[0][1].value<std::vector<nucleus::tile::GpuTextureTile>>();
+        REQUIRE(gpu_tiles.size() == 3);
+        CHECK(!gpu_tiles[0].empty);
+        CHECK(gpu_tiles[1].empty);
+        CHECK(gpu_tiles[2].empty);
+        CHECK(gpu_tiles[1].texture == gpu_tiles[2].texture);
+        CHECK(gpu_tiles[1].texture->front().width() == 512);
+    }
 }
 
 TEST_CASE("nucleus/tile/SchedulerDirector")
@@ -889,4 +959,23 @@ TEST_CASE("nucleus/tile/SchedulerDirector")
         CHECK(reg.check_in("name", default_scheduler()));
         CHECK(!reg.check_in("name", default_scheduler()));
     }
+    SECTION("loading pipelines are attached to the shared request arbiter")
+    {
+        std::shared_ptr<Scheduler> geometry = default_scheduler();
+        std::shared_ptr<Scheduler> ortho = default_scheduler();
+        auto* geometry_limiter = new SlotLimiter(geometry.get());
+        auto* ortho_limiter = new SlotLimiter(ortho.get());
+        SchedulerDirector d;
+        d.check_in("geometry", geometry);
+        d.check_in("ortho", ortho);
+        CHECK(d.request_arbiter()->layer_rank("geometry") > d.request_arbiter()->layer_rank("ortho"));
+
+        QSignalSpy geometry_spy(geometry_limiter, &SlotLimiter::quad_requested);
+        QSignalSpy ortho_spy(ortho_limiter, &SlotLimiter::quad_requested);
+        geometry_limiter->request_quads({ Id { 0, { 0, 0 } } });
+        ortho_limiter->request_quads({ Id { 0, { 0, 0 } } });
+        CHECK(geometry_spy.size() == 1);
+        CHECK(ortho_spy.size() == 1);
+        CHECK(d.request_arbiter()->statistics().n_in_flight == 2);
+    }
 }
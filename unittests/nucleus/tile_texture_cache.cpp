@@ -0,0 +1,167 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include <QFile>
+#include <QStandardPaths>
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <nucleus/tile/TextureCache.h>
+
+using nucleus::tile::TextureCache;
+using Format = nucleus::utils::ColourTexture::Format;
+
+namespace {
+TextureCache::TexturePtr make_texture(unsigned size, uint8_t value, Format format = Format::DXT1)
+{
+    auto texture = std::make_shared<nucleus::utils::MipmappedColourTexture>();
+    if (format == Format::Uncompressed_RGBA) {
+        texture->emplace_back(nucleus::Raster<glm::u8vec4>(glm::uvec2(size), glm::u8vec4(value)), format);
+    } else {
+        texture->emplace_back(std::vector<uint8_t>(size * size / 2, value), glm::uvec2(size), format);
+        texture->emplace_back(std::vector<uint8_t>(8, value), glm::uvec2(4), format);
+    }
+    return texture;
+}
+
+std::filesystem::path test_directory()
+{
+    const auto path = std::filesystem::path(QStandardPaths::writableLocation(QStandardPaths::CacheLocation).toStdString()) / "test_texture_cache";
+    std::filesystem::remove_all(path);
+    return path;
+}
+} // namespace
+
+TEST_CASE("nucleus/tile/TextureCache")
+{
+    const auto id_a = nucleus::tile::Id { 5, { 1, 2 } };
+    const auto id_b = nucleus::tile::Id { 5, { 1, 3 } };
+    const auto id_c = nucleus::tile::Id { 5, { 1, 4 } };
+
+    SECTION("ram hit, miss and source stamp")
+    {
+        TextureCache cache({});
+        CHECK(!cache.get(id_a, Format::DXT1, 1));
+        const auto texture = make_texture(16, 7);
+        cache.insert(id_a, Format::DXT1, 1, texture);
+        CHECK(cache.get(id_a, Format::DXT1, 1) == texture);
+        CHECK(!cache.get(id_a, Format::ETC1, 1)); // keyed by format
+        CHECK(!cache.get(id_a, Format::DXT1, 2)); // source data changed
+        CHECK(cache.n_ram_entries() == 0); // stale entry was dropped
+        CHECK(cache.statistics().n_ram_hits == 1);
+        CHECK(cache.statistics().n_misses == 3);
+    }
+
+    SECTION("source stamp of a quad")
+    {
+        nucleus::tile::DataQuad quad;
+        quad.n_tiles = 4;
+        quad.tiles[0].network_info.timestamp = 10;
+        quad.tiles[2].network_info.timestamp = 30;
+        CHECK(TextureCache::source_stamp(quad) == 30);
+    }
+
+    SECTION("least recently used entries are evicted once over budget")
+    {
+        const auto texture_bytes = TextureCache::n_bytes(*make_texture(16, 0));
+        TextureCache::Settings settings;
+        settings.ram_budget_bytes = texture_bytes * 2;
+        TextureCache cache(settings);
+        cache.insert(id_a, Format::DXT1, 0, make_texture(16, 1));
+        cache.insert(id_b, Format::DXT1, 0, make_texture(16, 2));
+        CHECK(cache.get(id_a, Format::DXT1, 0)); // a is now more recent than b
+        cache.insert(id_c, Format::DXT1, 0, make_texture(16, 3));
+        CHECK(cache.n_ram_entries() == 2);
+        CHECK(cache.statistics().n_ram_bytes == texture_bytes * 2);
+        CHECK(cache.get(id_a, Format::DXT1, 0));
+        CHECK(!cache.get(id_b, Format::DXT1, 0));
+        CHECK(cache.get(id_c, Format::DXT1, 0));
+    }
+
+    SECTION("disk round trip")
+    {
+        TextureCache::Settings settings;
+        settings.disk_path = test_directory();
+        {
+            TextureCache cache(settings);
+            cache.insert(id_a, Format::DXT1, 5, make_texture(16, 9));
+            cache.insert(id_b, Format::Uncompressed_RGBA, 5, make_texture(4, 3, Format::Uncompressed_RGBA));
+        }
+        TextureCache cache(settings);
+        CHECK(cache.n_ram_entries() == 0);
+        CHECK(cache.statistics().n_disk_bytes > 0);
+
+        const auto a = cache.get(id_a, Format::DXT1, 5);
+        REQUIRE(a);
+        REQUIRE(a->size() == 2);
+        CHECK(a->at(0).width() == 16);
+        CHECK(a->at(0).n_bytes() == 128);
+        CHECK(a->at(0).data()[17] == 9);
+        CHECK(a->at(1).width() == 4);
+
+        const auto b = cache.get(id_b, Format::Uncompressed_RGBA, 5);
+        REQUIRE(b);
+        CHECK(b->at(0).format() == Format::Uncompressed_RGBA);
+        CHECK(b->at(0).n_bytes() == 4 * 4 * 4);
+        CHECK(b->at(0).data()[5] == 3);
+
+        CHECK(cache.statistics().n_disk_hits == 2);
+        CHECK(cache.n_ram_entries() == 2);
+
+        // stale on disk -> removed
+        TextureCache other(settings);
+        CHECK(!other.get(id_a, Format::DXT1, 6));
+        CHECK(!std::filesystem::exists(settings.disk_path / "1_5_1_2.alp_tex"));
+        std::filesystem::remove_all(settings.disk_path);
+    }
+
+    SECTION("an unusable disk path is not fatal")
+    {
+        const auto base = test_directory();
+        std::filesystem::create_directories(base);
+        QFile blocker(base / "not_a_directory");
+        REQUIRE(blocker.open(QIODeviceBase::WriteOnly));
+        blocker.close();
+
+        TextureCache::Settings settings;
+        settings.disk_path = base / "not_a_directory" / "textures";
+        TextureCache cache(settings);
+        const auto texture = make_texture(16, 1);
+        CHECK_NOTHROW(cache.insert(id_a, Format::DXT1, 0, texture));
+        CHECK(cache.get(id_a, Format::DXT1, 0) == texture);
+        CHECK(cache.statistics().n_disk_bytes == 0);
+        std::filesystem::remove_all(base);
+    }
+
+    SECTION("disk budget")
+    {
+        TextureCache::Settings settings;
+        settings.disk_path = test_directory();
+        settings.disk_budget_bytes = 1000; // a 16x16 dxt1 texture with 2 levels is ~150 bytes on disk
+        TextureCache cache(settings);
+        for (unsigned i = 0; i < 20; ++i)
+            cache.insert(nucleus::tile::Id { 10, { i, 0 } }, Format::DXT1, 0, make_texture(16, uint8_t(i)));
+        CHECK(cache.statistics().n_disk_bytes <= 1000);
+        unsigned n_files = 0;
+        for ([[maybe_unused]] const auto& f : std::filesystem::directory_iterator(settings.disk_path))
+            ++n_files;
+        CHECK(n_files < 20);
+        CHECK(n_files > 2);
+        std::filesystem::remove_all(settings.disk_path);
+    }
+}
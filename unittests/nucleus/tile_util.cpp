@@ -26,8 +26,10 @@
 #include <nucleus/camera/Definition.h>
 
 #include "nucleus/camera/PositionStorage.h"
+#include "nucleus/tile/traversal.h"
 #include "nucleus/tile/utils.h"
 #include "radix/quad_tree.h"
+#include <unordered_set>
 
 using Catch::Approx;
 using namespace nucleus::tile;
@@ -199,3 +201,60 @@ TEST_CASE("tile/utils/camera_frustum_contains_tile")
         };
     }
 }
+
+TEST_CASE("tile/parallel_traverse")
+{
+    QFile file(":/map/height_data.atb");
+    const auto open = file.open(QIODeviceBase::OpenModeFlag::ReadOnly);
+    assert(open);
+    Q_UNUSED(open);
+    const auto decorator = AabbDecorator::make(TileHeights::deserialise(file.readAll()));
+
+    auto camera = nucleus::camera::stored_positions::grossglockner();
+    camera.set_viewport_size({ 3840, 2160 });
+    camera.set_pixel_error_threshold(1);
+    const auto refine = utils::refineFunctor(camera, decorator, 256, 18);
+
+    std::vector<Id> sequential_inner_nodes;
+    const auto sequential_leaves = quad_tree::onTheFlyTraverse(Id { 0, { 0, 0 } }, refine, [&](const Id& v) {
+        sequential_inner_nodes.push_back(v);
+        return v.children();
+    });
+
+    SECTION("same tiles as the sequential traversal, in depth-first order for every split depth")
+    {
+        std::vector<Id> leaves;
+        std::vector<Id> inner_nodes;
+        const auto recurse = [&](const Id& id, const auto& recurse) -> void {
+            if (!refine(id)) {
+                leaves.push_back(id);
+                return;
+            }
+            inner_nodes.push_back(id);
+            for (const auto& child : id.children())
+                recurse(child, recurse);
+        };
+        recurse(Id { 0, { 0, 0 } }, recurse);
+
+        const auto as_set = [](const std::vector<Id>& ids) { return std::unordered_set<Id, Id::Hasher>(ids.begin(), ids.end()); };
+        CHECK(as_set(leaves) == as_set(sequential_leaves));
+        CHECK(as_set(inner_nodes) == as_set(sequential_inner_nodes));
+
+        for (const auto split_depth : { 0u, 1u, 3u, 6u, 30u }) {
+            CAPTURE(split_depth);
+            const auto result = parallel_traverse(Id { 0, { 0, 0 } }, refine, split_depth);
+            CHECK(result.leaves == leaves);
+            CHECK(result.inner_nodes == inner_nodes);
+        }
+    }
+
+    BENCHMARK("traverse 4k, 1px (sequential)")
+    {
+        return quad_tree::onTheFlyTraverse(Id { 0, { 0, 0 } }, refine, [](const Id& v) { return v.children(); });
+    };
+
+    BENCHMARK("traverse 4k, 1px (parallel)")
+    {
+        return parallel_traverse(Id { 0, { 0, 0 } }, refine);
+    };
+}
@@ -0,0 +1,143 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <nucleus/utils/BufferPool.h>
+#include <nucleus/utils/ColourTexture.h>
+#include <thread>
+
+using nucleus::utils::BufferPool;
+using nucleus::utils::pooled_raster;
+
+TEST_CASE("nucleus/utils/BufferPool")
+{
+    SECTION("size classes")
+    {
+        CHECK(BufferPool::size_class_bytes(1) == 64);
+        CHECK(BufferPool::size_class_bytes(64) == 64);
+        CHECK(BufferPool::size_class_bytes(65) == 80);
+        CHECK(BufferPool::size_class_bytes(1024) == 1024);
+        CHECK(BufferPool::size_class_bytes(1025) == 1280);
+        CHECK(BufferPool::size_class_bytes(1536) == 1536);
+        CHECK(BufferPool::size_class_bytes(65 * 65 * 2) == 10240); // height raster
+        CHECK(BufferPool::size_class_bytes(512 * 512 * 4) == 512 * 512 * 4);
+    }
+
+    SECTION("buffers are reused and aligned")
+    {
+        BufferPool pool;
+        void* a = pool.acquire(1000);
+        REQUIRE(a);
+        CHECK(reinterpret_cast<std::uintptr_t>(a) % BufferPool::alignment == 0);
+        pool.release(a, 1000);
+        CHECK(pool.statistics().n_pooled_bytes == 1024);
+        void* b = pool.acquire(1024); // same class
+        CHECK(b == a);
+        pool.release(b, 1024);
+
+        const auto stats = pool.statistics();
+        CHECK(stats.n_acquired == 2);
+        CHECK(stats.n_allocated == 1);
+        CHECK(stats.n_released == 2);
+        CHECK(stats.n_live_bytes == 0);
+        CHECK(pool.acquire(0) == nullptr);
+    }
+
+    SECTION("budget")
+    {
+        BufferPool pool(4096);
+        void* a = pool.acquire(4096);
+        void* b = pool.acquire(4096);
+        pool.release(a, 4096);
+        pool.release(b, 4096); // over budget, freed
+        CHECK(pool.statistics().n_freed == 1);
+        CHECK(pool.statistics().n_pooled_bytes == 4096);
+        pool.set_max_pooled_bytes(0);
+        CHECK(pool.statistics().n_pooled_bytes == 0);
+    }
+
+    SECTION("rasters return their storage when dropped")
+    {
+        BufferPool pool;
+        {
+            auto raster = pooled_raster<glm::u8vec4>({ 512, 512 }, pool);
+            CHECK(raster.is_adopted());
+            CHECK(pool.statistics().n_live_bytes == 512 * 512 * 4);
+            raster.pixel({ 511, 511 }) = glm::u8vec4(1, 2, 3, 4);
+            const auto copy = raster; // copies own a vector
+            CHECK(!copy.is_adopted());
+            CHECK(copy.pixel({ 511, 511 }) == glm::u8vec4(1, 2, 3, 4));
+        }
+        CHECK(pool.statistics().n_live_bytes == 0);
+        CHECK(pool.statistics().n_pooled_bytes == 512 * 512 * 4);
+
+        const auto mipmap = nucleus::generate_mipmap(pooled_raster<uint16_t>({ 64, 64 }, pool), [&pool](const glm::uvec2& size) { return pooled_raster<uint16_t>(size, pool); });
+        CHECK(mipmap.size() == 7);
+        CHECK(pool.statistics().n_allocated == 8); // the 512² buffer doesn't fit any of the levels
+    }
+
+    SECTION("pooled vector")
+    {
+        BufferPool pool;
+        {
+            nucleus::utils::PooledBytes bytes(100, 7, nucleus::utils::PoolAllocator<uint8_t>(pool));
+            CHECK(pool.statistics().n_live_bytes == 112);
+        }
+        CHECK(pool.statistics().n_live_bytes == 0);
+    }
+
+    SECTION("thread safety")
+    {
+        BufferPool pool;
+        std::vector<std::thread> threads;
+        for (unsigned t = 0; t < 8; ++t) {
+            threads.emplace_back([&pool, t]() {
+                for (unsigned i = 0; i < 1000; ++i) {
+                    auto raster = pooled_raster<uint16_t>(glm::uvec2(16u << ((i + t) % 4)), pool);
+                    raster.pixel({ 0, 0 }) = uint16_t(i);
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        const auto stats = pool.statistics();
+        CHECK(stats.n_acquired == 8000);
+        CHECK(stats.n_released == 8000);
+        CHECK(stats.n_live_bytes == 0);
+        CHECK(stats.n_allocated <= 32);
+    }
+
+    SECTION("textures are built from the global pool")
+    {
+        auto& pool = BufferPool::instance();
+        const auto live_before = pool.statistics().n_live_bytes;
+        {
+            const auto texture = nucleus::utils::generate_mipmapped_colour_texture(pooled_raster<glm::u8vec4>({ 256, 256 }), nucleus::utils::ColourTexture::Format::DXT1);
+            CHECK(pool.statistics().n_live_bytes > live_before);
+        }
+        CHECK(pool.statistics().n_live_bytes == live_before);
+    }
+}
+
+TEST_CASE("nucleus/utils/BufferPool benchmarks")
+{
+    BENCHMARK("512² raster, std::vector") { return nucleus::Raster<glm::u8vec4>(glm::uvec2(512)).size_in_bytes(); };
+    BENCHMARK("512² raster, pooled") { return pooled_raster<glm::u8vec4>(glm::uvec2(512)).size_in_bytes(); };
+}
@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include <GoofyTC/goofy_tc.h>
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <nucleus/tile/TextureScheduler.h>
+#include <nucleus/utils/ColourTexture.h>
+#include <nucleus/utils/image_loader.h>
+
+#include "test_helpers.h"
+
+using nucleus::Raster;
+using nucleus::utils::ColourTexture;
+
+namespace {
+Raster<glm::u8vec4> ortho_quad()
+{
+    nucleus::tile::DataQuad quad;
+    quad.id = radix::tile::Id { 6, { 34, 41 } };
+    unsigned i = 0;
+    for (const auto& c : quad.id.children()) {
+        quad.tiles[i].id = c;
+        quad.tiles[i].data = std::make_shared<QByteArray>(test_helpers::load_test_file(QString("quad/%1_%2_%3.jpg").arg(c.zoom_level).arg(c.coords.x).arg(c.coords.y)));
+        ++i;
+    }
+    quad.n_tiles = 4;
+    return nucleus::tile::TextureScheduler::to_raster(quad, { { 256, 256 }, glm::u8vec4 { 255, 255, 255, 255 } });
+}
+
+std::vector<uint8_t> goofy_reference(const Raster<glm::u8vec4>& image, ColourTexture::Format format)
+{
+    std::vector<uint8_t> out(image.width() * image.height() / 2);
+    if (format == ColourTexture::Format::DXT1)
+        goofy::compressDXT1(out.data(), image.bytes(), image.width(), image.height(), image.width() * 4);
+    else
+        goofy::compressETC1(out.data(), image.bytes(), image.width(), image.height(), image.width() * 4);
+    return out;
+}
+
+std::vector<uint8_t> bytes_of(const ColourTexture& texture) { return { texture.data(), texture.data() + texture.n_bytes() }; }
+} // namespace
+
+TEST_CASE("nucleus/utils/ColourTexture")
+{
+    const auto quad = ortho_quad();
+    REQUIRE(quad.size() == glm::uvec2(512, 512));
+
+    for (const auto format : { ColourTexture::Format::DXT1, ColourTexture::Format::ETC1 }) {
+        DYNAMIC_SECTION("band parallel compression equals a single encode, format " << int(format))
+        {
+            CHECK(bytes_of(ColourTexture(quad, format)) == goofy_reference(quad, format));
+        }
+
+        DYNAMIC_SECTION("small levels match the padded 16x16 encode, format " << int(format))
+        {
+            const auto mipmap = nucleus::generate_mipmap(quad);
+            const auto& level_8 = mipmap.at(6);
+            REQUIRE(level_8.width() == 8);
+            const auto padded = goofy_reference(nucleus::resize(level_8, { 16, 16 }, glm::u8vec4(0)), format);
+            std::vector<uint8_t> expected(padded.begin(), padded.begin() + 16);
+            expected.insert(expected.end(), padded.begin() + 32, padded.begin() + 48);
+            CHECK(bytes_of(ColourTexture(level_8, format)) == expected);
+
+            const auto& level_4 = mipmap.at(7);
+            const auto padded_4 = goofy_reference(nucleus::resize(level_4, { 16, 16 }, glm::u8vec4(0)), format);
+            CHECK(bytes_of(ColourTexture(level_4, format)) == std::vector<uint8_t>(padded_4.begin(), padded_4.begin() + 8));
+
+            CHECK(ColourTexture(mipmap.at(8), format).n_bytes() == 8);
+            CHECK(ColourTexture(mipmap.at(9), format).n_bytes() == 8);
+        }
+
+        DYNAMIC_SECTION("mipmapped texture equals per level textures, format " << int(format))
+        {
+            const auto mipmap = nucleus::generate_mipmap(quad);
+            const auto textures = nucleus::utils::generate_mipmapped_colour_texture(quad, format);
+            REQUIRE(textures.size() == mipmap.size());
+            for (size_t i = 0; i < mipmap.size(); ++i) {
+                CHECK(textures[i].width() == mipmap[i].width());
+                CHECK(bytes_of(textures[i]) == bytes_of(ColourTexture(mipmap[i], format)));
+            }
+        }
+    }
+}
+
+TEST_CASE("nucleus/utils/ColourTexture benchmarks")
+{
+    const auto quad = ortho_quad();
+    BENCHMARK("generate_mipmapped_colour_texture 512 DXT1") { return nucleus::utils::generate_mipmapped_colour_texture(quad, ColourTexture::Format::DXT1); };
+    BENCHMARK("generate_mipmapped_colour_texture 512 ETC1") { return nucleus::utils::generate_mipmapped_colour_texture(quad, ColourTexture::Format::ETC1); };
+    BENCHMARK("single encode 512 DXT1 (reference)") { return goofy_reference(quad, ColourTexture::Format::DXT1); };
+}
@@ -0,0 +1,162 @@
+/*****************************************************************************
+ * AlpineMaps.org
+ * Copyright (C) 2025 alpinemaps.org
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <nucleus/utils/ImageDecoder.h>
+#include <nucleus/utils/image_loader.h>
+
+#include "test_helpers.h"
+
+using namespace nucleus::utils;
+
+namespace {
+class FailingDecoder : public ImageDecoder {
+public:
+    QString name() const override { return "failing"; }
+    tl::expected<nucleus::Raster<glm::u8vec4>, QString> rgba8(const QByteArray&) const override { return tl::unexpected(QString("failing")); }
+    tl::expected<void, QString> rgba8_into(const QByteArray&, nucleus::RasterView<glm::u8vec4>) const override { return tl::unexpected(QString("failing")); }
+};
+
+double rmse(const nucleus::Raster<glm::u8vec4>& a, const nucleus::Raster<glm::u8vec4>& b)
+{
+    double sum = 0;
+    for (size_t i = 0; i < size_t(a.width()) * a.height(); ++i) {
+        for (int c = 0; c < 4; ++c) {
+            const double d = double(a.buffer()[i][c]) - double(b.buffer()[i][c]);
+            sum += d * d;
+        }
+    }
+    return std::sqrt(sum / double(size_t(a.width()) * a.height() * 4));
+}
+} // namespace
+
+TEST_CASE("nucleus/utils/ImageDecoder")
+{
+    SECTION("format detection")
+    {
+        CHECK(detect_image_format(test_helpers::white_jpeg_tile(4)) == ImageFormat::Jpeg);
+        CHECK(detect_image_format(test_helpers::black_png_tile(4)) == ImageFormat::Png);
+        CHECK(detect_image_format(QByteArray("not an image")) == ImageFormat::Unknown);
+        CHECK(detect_image_format(QByteArray()) == ImageFormat::Unknown);
+    }
+
+    SECTION("default decoders")
+    {
+        REQUIRE(image_decoder(ImageFormat::Png));
+        CHECK(image_decoder(ImageFormat::Png)->name() == stb_image_decoder()->name());
+        CHECK(image_decoder(ImageFormat::Unknown)->name() == stb_image_decoder()->name());
+#ifdef ALP_ENABLE_TURBOJPEG
+        REQUIRE(turbojpeg_decoder());
+        CHECK(image_decoder(ImageFormat::Jpeg)->name() == turbojpeg_decoder()->name());
+#else
+        CHECK(!turbojpeg_decoder());
+        CHECK(image_decoder(ImageFormat::Jpeg)->name() == stb_image_decoder()->name());
+#endif
+    }
+
+    SECTION("override and restore")
+    {
+        const auto jpeg = test_helpers::white_jpeg_tile(4);
+        set_image_decoder(ImageFormat::Jpeg, std::make_shared<FailingDecoder>());
+        CHECK(!image_loader::rgba8(jpeg).has_value());
+        CHECK(image_loader::rgba8(test_helpers::black_png_tile(4)).has_value()); // png unaffected
+        set_image_decoder(ImageFormat::Jpeg, nullptr);
+        CHECK(image_loader::rgba8(jpeg).has_value());
+    }
+
+    SECTION("all backends decode the same jpeg")
+    {
+        const auto bytes = test_helpers::load_test_file("test-tile_ortho.jpeg");
+        const auto reference = stb_image_decoder()->rgba8(bytes);
+        REQUIRE(reference.has_value());
+        for (const auto& decoder : { stb_image_decoder(), turbojpeg_decoder() }) {
+            if (!decoder)
+                continue;
+            CAPTURE(decoder->name());
+            const auto decoded = decoder->rgba8(bytes);
+            REQUIRE(decoded.has_value());
+            REQUIRE(decoded->size() == reference->size());
+            CHECK(rmse(*decoded, *reference) < 2.0); // idct implementations differ slightly
+            CHECK(decoded->buffer()[0].a == 255);
+
+            nucleus::Raster<glm::u8vec4> quad(reference->size() * 2u, glm::u8vec4(1, 2, 3, 4));
+            REQUIRE(decoder->rgba8_into(bytes, quad.view().sub_view({ reference->width(), 0 }, reference->size())));
+            CHECK(quad.pixel({ 0, 0 }) == glm::u8vec4(1, 2, 3, 4));
+            CHECK(quad.pixel({ reference->width(), 0 }) == decoded->buffer()[0]);
+            CHECK(quad.pixel({ reference->width(), reference->height() }) == glm::u8vec4(1, 2, 3, 4));
+            CHECK(!decoder->rgba8_into(bytes, quad.view()));
+            CHECK(!decoder->rgba8(QByteArray("broken")).has_value());
+        }
+    }
+
+    SECTION("reduced resolution decode")
+    {
+        CHECK(downscale_factor({ 256, 256 }, { 256, 256 }) == 1);
+        CHECK(downscale_factor({ 256, 256 }, { 64, 64 }) == 4);
+        CHECK(downscale_factor({ 256, 256 }, { 32, 32 }) == 8);
+        CHECK(downscale_factor({ 256, 256 }, { 16, 16 }) == 0);
+        CHECK(downscale_factor({ 256, 256 }, { 100, 100 }) == 0);
+        CHECK(downscale_factor({ 256, 256 }, { 128, 64 }) == 0);
+
+        const auto bytes = test_helpers::load_test_file("test-tile_ortho.jpeg");
+        auto reference = stb_image_decoder()->rgba8(bytes).value();
+        for (unsigned divisor = 2; divisor <= 8; divisor *= 2) {
+            nucleus::Raster<glm::u8vec4> half(reference.size() / 2u);
+            nucleus::downsample<glm::u8vec4>(reference.view(), half.view());
+            reference = std::move(half);
+            for (const auto& decoder : { stb_image_decoder(), turbojpeg_decoder() }) {
+                if (!decoder)
+                    continue;
+                CAPTURE(decoder->name(), divisor);
+                nucleus::Raster<glm::u8vec4> reduced(reference.size());
+                REQUIRE(decoder->rgba8_into(bytes, reduced.view()));
+                CHECK(rmse(reduced, reference) < 6.0); // DCT scaling is not a box filter
+            }
+        }
+    }
+}
+
+TEST_CASE("nucleus/utils/ImageDecoder benchmarks")
+{
+    std::vector<QByteArray> tiles;
+    for (const auto* name : { "quad/7_68_82.jpg", "quad/7_68_83.jpg", "quad/7_69_82.jpg", "quad/7_69_83.jpg" })
+        tiles.push_back(test_helpers::load_test_file(name));
+
+    for (const auto& decoder : { stb_image_decoder(), turbojpeg_decoder() }) {
+        if (!decoder)
+            continue;
+        BENCHMARK(QString("decode 4 ortho tiles (%1)").arg(decoder->name()).toStdString())
+        {
+            size_t n = 0;
+            for (const auto& tile : tiles)
+                n += decoder->rgba8(tile)->width();
+            return n;
+        };
+        nucleus::Raster<glm::u8vec4> reduced(glm::uvec2(64, 64));
+        BENCHMARK(QString("decode 4 ortho tiles at 1/4 resolution (%1)").arg(decoder->name()).toStdString())
+        {
+            bool ok = true;
+            for (const auto& tile : tiles)
+                ok = ok && decoder->rgba8_into(tile, reduced.view()).has_value();
+            return ok;
+        };
+    }
+}